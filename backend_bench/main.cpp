@@ -0,0 +1,128 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include "argparse.hpp"
+#include <inference_backend.hpp>
+#include <backend_benchmark.hpp>
+#ifdef USE_ONNXRUNTIME
+#include <onnx_backend.hpp>
+#endif
+#ifdef USE_TORCH
+#include <torch_backend.hpp>
+#endif
+
+// Runs every requested backend on the same feature windows and prints per-backend latency distributions.
+// The first backend is the reference the others' predictions are compared against.
+int main(int argc, char** argv) {
+    argparse::ArgumentParser program("Inference Backend Benchmark");
+
+    program.add_argument("-f", "--file_path")
+        .help("Path to the CSV file containing feature records")
+        .default_value(std::string("data/demo/feature_model/0.csv"));
+
+    program.add_argument("-s", "--sequence_length")
+        .help("Window length fed to the models")
+        .default_value(30)
+        .scan<'i', int>();
+
+    program.add_argument("--feature_dim")
+        .help("Feature dimension")
+        .default_value(32)
+        .scan<'i', int>();
+
+    program.add_argument("-b", "--batch_size")
+        .help("Windows per inference call")
+        .default_value(1)
+        .scan<'i', int>();
+
+    program.add_argument("--onnx_model")
+        .help("ONNX model to benchmark (repeatable)")
+        .append();
+
+    program.add_argument("--torch_model")
+        .help("TorchScript model to benchmark (repeatable)")
+        .append();
+
+    program.add_argument("--cvm")
+        .help("Also benchmark the native constant-velocity backend")
+        .flag();
+
+    program.add_argument("--intra_op_threads")
+        .help("Intra-op threads of the ONNX Runtime sessions")
+        .default_value(1)
+        .scan<'i', int>();
+
+    program.add_argument("--warmup")
+        .help("Untimed passes over the windows")
+        .default_value(1)
+        .scan<'i', int>();
+
+    program.add_argument("--repeats")
+        .help("Timed passes over the windows")
+        .default_value(5)
+        .scan<'i', int>();
+
+    try {
+        program.parse_args(argc, argv);
+    } catch (const std::runtime_error& err) {
+        std::cout << err.what() << std::endl;
+        std::cout << program;
+        exit(0);
+    }
+
+    size_t sequence_length = program.get<int>("--sequence_length");
+    size_t feature_dim = program.get<int>("--feature_dim");
+
+    std::vector<std::unique_ptr<InferenceBackend>> backends;
+    try {
+#ifdef USE_ONNXRUNTIME
+        OnnxSessionOptions options;
+        options.intra_op_threads = program.get<int>("--intra_op_threads");
+        for (const auto& path : program.get<std::vector<std::string>>("--onnx_model")) {
+            backends.push_back(std::make_unique<OnnxBackend>(path, options));
+        }
+#else
+        if (!program.get<std::vector<std::string>>("--onnx_model").empty()) {
+            std::cerr << "Built without ONNX Runtime, ignoring --onnx_model" << std::endl;
+        }
+#endif
+#ifdef USE_TORCH
+        for (const auto& path : program.get<std::vector<std::string>>("--torch_model")) {
+            backends.push_back(std::make_unique<TorchBackend>(path));
+        }
+#else
+        if (!program.get<std::vector<std::string>>("--torch_model").empty()) {
+            std::cerr << "Built without libtorch, ignoring --torch_model" << std::endl;
+        }
+#endif
+    } catch (const std::exception& err) {
+        std::cerr << "Error loading the model: " << err.what() << std::endl;
+        exit(-1);
+    }
+    if (program.get<bool>("--cvm")) {
+        backends.push_back(std::make_unique<CvmBackend>());
+    }
+    if (backends.empty()) {
+        std::cerr << "No backend selected" << std::endl;
+        std::cout << program;
+        exit(-1);
+    }
+
+    std::string file_path = program.get<std::string>("-f");
+    std::vector<float> windows;
+    try {
+        windows = loadFeatureWindows(file_path, sequence_length, feature_dim);
+    } catch (const std::runtime_error& err) {
+        std::cerr << err.what() << std::endl;
+        exit(-1);
+    }
+    size_t num_windows = windows.size() / (sequence_length * feature_dim);
+    std::cout << "Benchmarking " << backends.size() << " backends on " << num_windows << " windows of " << sequence_length
+              << "x" << feature_dim << " from " << file_path << std::endl;
+
+    auto reports = benchmarkBackends(backends, windows, sequence_length, feature_dim, program.get<int>("--batch_size"),
+                                     program.get<int>("--warmup"), program.get<int>("--repeats"));
+    printBackendReports(reports);
+    return 0;
+}
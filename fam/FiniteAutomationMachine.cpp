@@ -85,11 +85,11 @@ void ErrorState::initializeMLE() {
 
     std::pair<FiniteAutomationState*, double> AtStationState::transition(){
         // AtStation -> ApproachingSidewalkState or WaitingState
-        if (std::abs(features.User_speed) > WALK_STAY_THRESHOLD &&
+        if (std::abs(features.User_speed) > fam_params.walk_stay_threshold &&
             (features.On_sidewalks || features.facing_along_sidewalk)) {
             next_state = new ApproachingSidewalkState(features);  // Assuming this state is properly defined elsewhere
             return {next_state, 1.0};
-        } else if (std::abs(features.User_speed) <= WALK_STAY_THRESHOLD &&
+        } else if (std::abs(features.User_speed) <= fam_params.walk_stay_threshold &&
                    features.intent_to_cross && features.possible_interaction) { //TODO: How is possible interaction defined?
             next_state = new WaitingState(features);  // Assuming this state is properly defined elsewhere
             return {next_state, 1.0};
@@ -109,7 +109,7 @@ void ErrorState::initializeMLE() {
 
     bool WaitingState::check(const Features& features) {
         // Check based on the speed and various interaction possibilities
-        bool is_stationary = std::abs(features.User_speed) <= WALK_STAY_THRESHOLD;
+        bool is_stationary = std::abs(features.User_speed) <= fam_params.walk_stay_threshold;
         // TODO: The third condition... In my old code, I see facing_to_road instead of On_road. 
         // Waiting while facing the road makes more sense than when being on the road...
         bool is_interactive = features.possible_interaction || features.looking_at_AGV || features.On_road;
@@ -124,20 +124,20 @@ void ErrorState::initializeMLE() {
         // WaitingState -> CrossingState
         // TODO: In my old code, I was using User_speed_Y to check whether the user was moving across the road
         // TODO: Which one would be better?
-        if (std::abs(features.User_speed) > 0.8 * WALK_STAY_THRESHOLD &&
+        if (std::abs(features.User_speed) > 0.8 * fam_params.walk_stay_threshold &&
             features.On_road && features.facing_to_road) {
             next_state = new CrossingState(features);  // Assuming this state is properly defined elsewhere
             return {next_state, 1.0};
         }
 
         // WaitingState -> ApproachingSidewalkState
-        if (std::abs(features.User_speed) > WALK_STAY_THRESHOLD && features.On_sidewalks) {
+        if (std::abs(features.User_speed) > fam_params.walk_stay_threshold && features.On_sidewalks) {
             next_state = new ApproachingSidewalkState(features);  // Assuming this state is properly defined elsewhere
             return {next_state, 1.0};
         }
 
         // WaitingState -> MovingAlongSidewalkState
-        if (std::abs(features.User_speed_X) > 0.8 * WALK_STAY_THRESHOLD &&
+        if (std::abs(features.User_speed_X) > 0.8 * fam_params.walk_stay_threshold &&
             (features.On_sidewalks || features.facing_along_sidewalk)) {
             next_state = new MovingAlongSidewalkState(features);  // Assuming this state is properly defined elsewhere
             return {next_state, 1.0};
@@ -157,7 +157,7 @@ void ErrorState::initializeMLE() {
 
     bool CrossingState::check(const Features& features) {
         // Check for movement in the Y direction and if on the road, including gazing considerations
-        bool moving = std::abs(features.User_speed_Y) > WALK_STAY_THRESHOLD;
+        bool moving = std::abs(features.User_speed_Y) > fam_params.walk_stay_threshold;
         bool on_road = features.On_road;
         bool looking_at_road = features.facing_to_road;
         bool looking_at_agv = features.looking_at_AGV;
@@ -176,7 +176,7 @@ void ErrorState::initializeMLE() {
         // for example, to check the location of the AGV
         if (features.On_sidewalks &&
             (std::abs(features.User_speed_X) > 1.5 * std::abs(features.User_speed_Y) ||
-             (features.facing_along_sidewalk && std::abs(features.User_speed_X) > 0.5 * WALK_STAY_THRESHOLD))) {
+             (features.facing_along_sidewalk && std::abs(features.User_speed_X) > 0.5 * fam_params.walk_stay_threshold))) {
             next_state = new MovingAlongSidewalkState(features);  // Assuming this state is properly defined elsewhere
             return {next_state, 1.0};
         }
@@ -185,7 +185,7 @@ void ErrorState::initializeMLE() {
         // TODO: According to your feature generator, the closest station is always the gazing station, i.e. the second
         // condition is always true
         // I understand what you are trying to do here, but you need to check your computations of the closest station once more
-        if (std::abs(features.User_speed) > WALK_STAY_THRESHOLD &&
+        if (std::abs(features.User_speed) > fam_params.walk_stay_threshold &&
             features.closest_station == features.Gazing_station &&
             !features.On_road) {
             next_state = new ApproachingStationState(features);  // Assuming this state is properly defined elsewhere
@@ -193,7 +193,7 @@ void ErrorState::initializeMLE() {
         }
 
         // CrossingState -> WaitingState (wait for AGV)
-        if (std::abs(features.User_speed) < WALK_STAY_THRESHOLD &&
+        if (std::abs(features.User_speed) < fam_params.walk_stay_threshold &&
             features.possible_interaction &&
             features.looking_at_AGV &&
             features.On_road) {
@@ -202,9 +202,9 @@ void ErrorState::initializeMLE() {
         }
 
         // CrossingState -> AtStationState (previously ArrivedState, but simplified for C++)
-        if (std::abs(features.User_speed) < WALK_STAY_THRESHOLD &&
+        if (std::abs(features.User_speed) < fam_params.walk_stay_threshold &&
             !features.facing_to_road &&
-            features.distance_to_closest_station <= CLOSE_TO_STATION_THRESHOLD * 100) {
+            features.distance_to_closest_station <= fam_params.close_to_station_threshold * 100) {
             next_state = new AtStationState(features);  // Assuming this state is properly defined elsewhere
             return {next_state, 1.0};
         }
@@ -224,8 +224,8 @@ void ErrorState::initializeMLE() {
 
     bool ApproachingSidewalkState::check(const Features& features) {
         // Check for proximity to station and movement constraints
-        bool near_start_station = std::abs(features.distance_to_closest_station_Y) <= CLOSE_TO_STATION_THRESHOLD_Y * 100 * 2;
-        bool moving = features.User_speed_Y > WALK_STAY_THRESHOLD * 0.3;
+        bool near_start_station = std::abs(features.distance_to_closest_station_Y) <= fam_params.close_to_station_threshold_y * 100 * 2;
+        bool moving = features.User_speed_Y > fam_params.walk_stay_threshold * fam_params.approach_sidewalk_speed_scale;
 
         return near_start_station && moving && !features.On_road;
     }
@@ -233,21 +233,21 @@ void ErrorState::initializeMLE() {
     std::pair<FiniteAutomationState*, double> ApproachingSidewalkState::transition()  {
         // Determine the next state based on the current features
 
-        bool near_station_X = features.distance_to_closest_station_X < CLOSE_TO_STATION_THRESHOLD_X * 100;
-        bool near_station_Y = features.distance_to_closest_station_Y < CLOSE_TO_STATION_THRESHOLD_Y * 100;
+        bool near_station_X = features.distance_to_closest_station_X < fam_params.close_to_station_threshold_x * 100;
+        bool near_station_Y = features.distance_to_closest_station_Y < fam_params.close_to_station_threshold_y * 100;
         bool near_station = near_station_X && near_station_Y;
 
         // ApproachingSidewalkState -> CrossingState
         // TODO: In my old code, I only had two conditions: the user should be moving and facing the road
         // TODO: I guess being on the road is also a condition we should check
-        if (std::abs(features.User_speed_Y) > 0.5 * WALK_STAY_THRESHOLD &&
+        if (std::abs(features.User_speed_Y) > 0.5 * fam_params.walk_stay_threshold &&
             features.facing_to_road && features.On_road) {
             next_state = new CrossingState(features);  // Assuming this state is properly defined elsewhere
             return {next_state, 1.0};
         }
 
         // ApproachingSidewalkState -> WaitingState
-        if (std::abs(features.User_speed) < WALK_STAY_THRESHOLD &&
+        if (std::abs(features.User_speed) < fam_params.walk_stay_threshold &&
             features.intent_to_cross && features.possible_interaction) {
             next_state = new WaitingState(features);  // Assuming this state is properly defined elsewhere
             return {next_state, 1.0};
@@ -256,7 +256,7 @@ void ErrorState::initializeMLE() {
         // ApproachingSidewalkState -> MovingAlongSidewalkState
         // TODO: Can you explain the last condition?
         if ((std::abs(features.User_speed_X) > 1.5 * std::abs(features.User_speed_Y) ||
-             (features.facing_along_sidewalk && std::abs(features.User_speed_X) > WALK_STAY_THRESHOLD)) &&
+             (features.facing_along_sidewalk && std::abs(features.User_speed_X) > fam_params.walk_stay_threshold)) &&
             (!near_station || features.facing_along_sidewalk)) {
             next_state = new MovingAlongSidewalkState(features);  // Assuming this state is properly defined elsewhere
             return {next_state, 1.0};
@@ -276,7 +276,7 @@ void ErrorState::initializeMLE() {
 
     bool MovingAlongSidewalkState::check(const Features& features) {
         // Check for movement along the sidewalk within constraints
-        bool moving = features.User_speed_X > WALK_STAY_THRESHOLD * 0.8;
+        bool moving = features.User_speed_X > fam_params.walk_stay_threshold * 0.8;
 
         // TODO: Here, you are using the start and end station information.
         // TODO: You can rewrite it to use the on_sidewalks feature
@@ -293,7 +293,7 @@ void ErrorState::initializeMLE() {
 
         // MovingAlongSidewalkState -> CrossingState
         if ((std::abs(features.User_speed_Y) > 1.5 * std::abs(features.User_speed_X) ||
-             (std::abs(features.User_speed_Y) > WALK_STAY_THRESHOLD && features.facing_to_road)) &&
+             (std::abs(features.User_speed_Y) > fam_params.walk_stay_threshold && features.facing_to_road)) &&
             (features.intent_to_cross || features.On_road)) {
             next_state = new CrossingState(features);  // Assuming this state is properly defined elsewhere
             return {next_state, 1.0};
@@ -301,7 +301,7 @@ void ErrorState::initializeMLE() {
 
         // MovingAlongSidewalkState -> WaitingState
         // TODO: possible_interaction
-        if (std::abs(features.User_speed) < WALK_STAY_THRESHOLD &&
+        if (std::abs(features.User_speed) < fam_params.walk_stay_threshold &&
             features.intent_to_cross && features.possible_interaction) {
             next_state = new WaitingState(features);  // Assuming this state is properly defined elsewhere
             return {next_state, 1.0};
@@ -312,9 +312,9 @@ void ErrorState::initializeMLE() {
         // They should be moving if they are approaching the station. So the first condition seems a bit dubious
         // Looking at closest station is fine, I am not sure if it is necessary, but its fine
         // The main condition to check for is the distance from closest station being less than the threshold
-        if ((std::abs(features.User_speed) < WALK_STAY_THRESHOLD || features.looking_at_closest_station) &&
+        if ((std::abs(features.User_speed) < fam_params.walk_stay_threshold || features.looking_at_closest_station) &&
             !features.facing_to_road &&
-            features.distance_to_closest_station <= CLOSE_TO_STATION_THRESHOLD * 200) {
+            features.distance_to_closest_station <= fam_params.close_to_station_threshold * 200) {
             next_state = new ApproachingStationState(features);  // Assuming this state is properly defined elsewhere
             return {next_state, 1.0};
         }
@@ -333,24 +333,24 @@ void ErrorState::initializeMLE() {
     bool ApproachingStationState::check(const Features& features) {
         // Check for proximity to the station and other conditions
         // TODO: You are using the end station information here. You can change the logic to not use that info
-        bool near_station_X = features.distance_from_end_station_X < STATION_LENGTH * 200;
-        bool near_station_Y = features.distance_from_end_station_Y < CLOSE_TO_STATION_THRESHOLD * 150;
+        bool near_station_X = features.distance_from_end_station_X < STATION_LENGTH * fam_params.approach_station_x_scale;
+        bool near_station_Y = features.distance_from_end_station_Y < fam_params.close_to_station_threshold * fam_params.approach_station_y_scale;
 
         // TODO: You are not even using the below value
         bool looking_at_station = features.facing_end_station;
         bool on_road = features.On_road;
 
         // TODO: Is the last condition because they slow down near the station?
-        return !on_road && near_station_X && near_station_Y && (features.User_speed > WALK_STAY_THRESHOLD * 0.2);
+        return !on_road && near_station_X && near_station_Y && (features.User_speed > fam_params.walk_stay_threshold * 0.2);
     }
 
     std::pair<FiniteAutomationState*, double> ApproachingStationState::transition()  {
         // Determine the next state based on the current features
         // TODO: Do we need all these conditions? We can say that if a user stops moving once they are in the
         // Approaching Station State, they transition to the At Station state? 
-        if (std::abs(features.User_speed) < WALK_STAY_THRESHOLD &&
+        if (std::abs(features.User_speed) < fam_params.walk_stay_threshold &&
             !features.facing_to_road &&
-            features.distance_to_closest_station <= CLOSE_TO_STATION_THRESHOLD * 300 /*This distance is very large*/) {
+            features.distance_to_closest_station <= fam_params.close_to_station_threshold * 300 /*This distance is very large*/) {
             next_state = new AtStationState(features);  // Assuming AtStationState is properly defined elsewhere
             return {next_state, 1.0};
         }
@@ -409,6 +409,29 @@ void ErrorState::initializeMLE() {
     return "Unknown";  // Return a default value if the current state is not set
     }
 
+    FamSnapshot FiniteAutomationMachine::snapshot() const {
+        FamSnapshot snapshot;
+        snapshot.current_state = getCurrentStateName();
+        snapshot.S_prev = S_prev;
+        snapshot.errorFlag = errorFlag;
+        return snapshot;
+    }
+
+    void FiniteAutomationMachine::restore(const FamSnapshot& snapshot) {
+        S_prev = snapshot.S_prev;
+        // An ErrorState picks its transition table from the state it was entered from
+        if (snapshot.current_state == "Error") {
+            current_state = std::make_unique<ErrorState>(Features(), S_prev);
+        } else {
+            setCurrentStateByName(snapshot.current_state);
+        }
+        if (snapshot.errorFlag.size() == default_error_flag.size()) {
+            errorFlag = snapshot.errorFlag;
+        } else {
+            errorFlag = default_error_flag;
+        }
+    }
+
     
     bool FiniteAutomationMachine::anyOf(const std::vector<bool>& flags) {
         for (bool flag : flags) {
@@ -12,6 +12,8 @@
 #include <functional>
 #include <config.hpp>
 #include <constant.hpp>
+#include <fam_params.hpp>
+#include <session_snapshot.hpp>
 
 // Base class for finite automation states
 class FiniteAutomationState {
@@ -56,10 +58,10 @@ public:
     AtStationState(const Features& features);
     bool check(const Features& features){
         // Constraint 1: Be stationary
-        bool stationary = std::abs(features.User_speed) <= WALK_STAY_THRESHOLD * 2;
+        bool stationary = std::abs(features.User_speed) <= fam_params.walk_stay_threshold * 2;
         // Constraint 2: Be within a small distance of the station
-        bool near_station_X = features.distance_to_closest_station_X < CLOSE_TO_STATION_THRESHOLD_X * 200;
-        bool near_station_Y = features.distance_to_closest_station_Y < CLOSE_TO_STATION_THRESHOLD_Y * 200;
+        bool near_station_X = features.distance_to_closest_station_X < fam_params.close_to_station_threshold_x * fam_params.at_station_scale;
+        bool near_station_Y = features.distance_to_closest_station_Y < fam_params.close_to_station_threshold_y * fam_params.at_station_scale;
         bool near_station = near_station_X && near_station_Y;
         // Constraint 3: Not be on the road
         bool on_road = features.On_road;
@@ -68,10 +70,10 @@ public:
 
     static bool mycheck(const Features& features){
         // Constraint 1: Be stationary
-        bool stationary = std::abs(features.User_speed) <= WALK_STAY_THRESHOLD * 2;
+        bool stationary = std::abs(features.User_speed) <= fam_params.walk_stay_threshold * 2;
         // Constraint 2: Be within a small distance of the station
-        bool near_station_X = features.distance_to_closest_station_X < CLOSE_TO_STATION_THRESHOLD_X * 200;
-        bool near_station_Y = features.distance_to_closest_station_Y < CLOSE_TO_STATION_THRESHOLD_Y * 200;
+        bool near_station_X = features.distance_to_closest_station_X < fam_params.close_to_station_threshold_x * fam_params.at_station_scale;
+        bool near_station_Y = features.distance_to_closest_station_Y < fam_params.close_to_station_threshold_y * fam_params.at_station_scale;
         bool near_station = near_station_X && near_station_Y;
         // Constraint 3: Not be on the road
         bool on_road = features.On_road;
@@ -86,7 +88,7 @@ public:
     bool check(const Features& features);
     static bool mycheck(const Features& features){
         // Check based on the speed and various interaction possibilities
-        bool is_stationary = std::abs(features.User_speed) <= WALK_STAY_THRESHOLD;
+        bool is_stationary = std::abs(features.User_speed) <= fam_params.walk_stay_threshold;
         bool is_interactive = features.possible_interaction || features.looking_at_AGV || features.On_road;
         return is_stationary && is_interactive;
     };
@@ -99,7 +101,7 @@ public:
     bool check(const Features& features);
     static bool mycheck(const Features& features){
         // Check for movement in the Y direction and if on the road, including gazing considerations
-        bool moving = std::abs(features.User_speed_Y) > WALK_STAY_THRESHOLD;
+        bool moving = std::abs(features.User_speed_Y) > fam_params.walk_stay_threshold;
         bool on_road = features.On_road;
         bool looking_at_road = features.facing_to_road;
         bool looking_at_agv = features.looking_at_AGV;
@@ -115,8 +117,8 @@ public:
     bool check(const Features& features);
     static bool mycheck(const Features& features){
         // Check for proximity to station and movement constraints
-        bool near_start_station = std::abs(features.distance_to_closest_station_Y) <= CLOSE_TO_STATION_THRESHOLD_Y * 100 * 2;
-        bool moving = features.User_speed_Y > WALK_STAY_THRESHOLD * 0.3;
+        bool near_start_station = std::abs(features.distance_to_closest_station_Y) <= fam_params.close_to_station_threshold_y * 100 * 2;
+        bool moving = features.User_speed_Y > fam_params.walk_stay_threshold * fam_params.approach_sidewalk_speed_scale;
 
         return near_start_station && moving && !features.On_road;
     };
@@ -129,7 +131,7 @@ public:
     bool check(const Features& features);
     static bool mycheck(const Features& features){
         // Check for movement along the sidewalk within constraints
-        bool moving = features.User_speed_X > WALK_STAY_THRESHOLD * 0.8;
+        bool moving = features.User_speed_X > fam_params.walk_stay_threshold * 0.8;
         bool within_sidewalk = features.distance_from_start_station_Y < 500 + MARGIN_NEAR_SIDEWALKS * 100;
         within_sidewalk = within_sidewalk || (features.distance_from_end_station_Y < 500 + MARGIN_NEAR_SIDEWALKS * 100);
 
@@ -144,12 +146,12 @@ public:
     bool check(const Features& features);
     static bool mycheck(const Features& features){
         // Check for proximity to the station and other conditions
-        bool near_station_X = features.distance_from_end_station_X < STATION_LENGTH * 200;
-        bool near_station_Y = features.distance_from_end_station_Y < CLOSE_TO_STATION_THRESHOLD * 150;
+        bool near_station_X = features.distance_from_end_station_X < STATION_LENGTH * fam_params.approach_station_x_scale;
+        bool near_station_Y = features.distance_from_end_station_Y < fam_params.close_to_station_threshold * fam_params.approach_station_y_scale;
         bool looking_at_station = features.facing_end_station;
         bool on_road = features.On_road;
 
-        return !on_road && near_station_X && near_station_Y && (features.User_speed > WALK_STAY_THRESHOLD * 0.2);
+        return !on_road && near_station_X && near_station_Y && (features.User_speed > fam_params.walk_stay_threshold * 0.2);
     };
     std::pair<FiniteAutomationState*, double> transition();
 };
@@ -196,6 +198,9 @@ public:
             throw std::runtime_error("No Such State: " + name);
         }
     };
+    // Capture and restore the controller state for session snapshots
+    FamSnapshot snapshot() const;
+    void restore(const FamSnapshot& snapshot);
 private:
     bool anyOf(const std::vector<bool>& flags);
 };
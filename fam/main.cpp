@@ -13,8 +13,10 @@
 #include <unordered_map>
 #include <functional>
 #include <numeric> 
+#include <limits>
 #include <memory>
 #include <argparse.hpp>
+#include <state_timeline.hpp>
 
 
 // Parse CSV line into Features struct
@@ -58,6 +60,30 @@ std::vector<Features> parseCSV(const std::string& filePath) {
     return records;
 }
 
+// Print the dwells of a pedestrian overlapping [from_ts, to_ts] and the time spent in each state
+void queryTimeline(const std::string& path, uint32_t pedestrian, int64_t from_ts, int64_t to_ts) {
+    auto load_start = std::chrono::high_resolution_clock::now();
+    StateIntervalIndex index(readStateTimeline(path));
+    std::chrono::duration<double, std::milli> load_elapsed = std::chrono::high_resolution_clock::now() - load_start;
+
+    auto query_start = std::chrono::high_resolution_clock::now();
+    std::vector<StateInterval> matches = index.query(pedestrian, from_ts, to_ts);
+    std::chrono::duration<double, std::micro> query_elapsed = std::chrono::high_resolution_clock::now() - query_start;
+
+    std::cout << "Pedestrian " << pedestrian << ", frames " << from_ts << " to " << to_ts << ":" << std::endl;
+    for (const auto& interval : matches) {
+        std::cout << "  " << interval.start_ts << " - " << interval.end_ts << ": "
+                  << stateNameFromId(interval.state_id) << std::endl;
+    }
+    std::cout << "Time in state over the whole timeline:" << std::endl;
+    for (size_t id = 0; id < famStateNames().size(); id++) {
+        int64_t dwell = index.dwellTime(pedestrian, static_cast<uint8_t>(id));
+        if (dwell > 0) std::cout << "  " << famStateNames()[id] << ": " << dwell << " frames" << std::endl;
+    }
+    std::cout << matches.size() << " intervals, loaded in " << load_elapsed.count() << " ms, queried in "
+              << query_elapsed.count() << " us" << std::endl;
+}
+
 int main(int argc, char** argv) {
     argparse::ArgumentParser program("FAM Benchmarking Program");
 
@@ -71,6 +97,41 @@ int main(int argc, char** argv) {
         .default_value(40)
         .scan<'i', size_t>(); // Scanning as size_t; 
 
+    program.add_argument("-t", "--timeline")
+        .help("Write state intervals (pedestrian, state, start, end) to this file instead of printing every frame")
+        .default_value(std::string(""));
+
+    program.add_argument("--timeline_format")
+        .help("Timeline file format: csv or binary")
+        .default_value(std::string("csv"));
+
+    program.add_argument("--pedestrian_id")
+        .help("Pedestrian id recorded in the timeline")
+        .default_value(0)
+        .scan<'i', int>();
+
+    program.add_argument("--snapshot_path")
+        .help("Write the FAM state to this session snapshot when done")
+        .default_value(std::string(""));
+
+    program.add_argument("--resume")
+        .help("Restore the FAM state from a session snapshot and continue after its last frame")
+        .default_value(std::string(""));
+
+    program.add_argument("--query_timeline")
+        .help("Look up the states of --pedestrian_id in an existing timeline file between --query_from and --query_to, then exit")
+        .default_value(std::string(""));
+
+    program.add_argument("--query_from")
+        .help("First frame of the timeline query")
+        .default_value(0)
+        .scan<'i', int>();
+
+    program.add_argument("--query_to")
+        .help("Last frame of the timeline query")
+        .default_value(std::numeric_limits<int>::max())
+        .scan<'i', int>();
+
     try {
         program.parse_args(argc, argv);
     } catch (const std::runtime_error& err) {
@@ -83,6 +144,32 @@ int main(int argc, char** argv) {
     std::string file_path = program.get<std::string>("-f");
     const size_t buffer_max_size = program.get<size_t>("-b");
 
+    std::string timeline_path = program.get<std::string>("--timeline");
+    const uint32_t pedestrian_id = program.get<int>("--pedestrian_id");
+
+    std::string query_path = program.get<std::string>("--query_timeline");
+    if (!query_path.empty()) {
+        try {
+            queryTimeline(query_path, pedestrian_id, program.get<int>("--query_from"), program.get<int>("--query_to"));
+        } catch (const std::exception& err) {
+            std::cerr << "Error querying timeline: " << err.what() << std::endl;
+            exit(-1);
+        }
+        return 0;
+    }
+
+    // Frame indices are used as timestamps; TimestampID only has a resolution of one second
+    std::unique_ptr<StateTimelineWriter> timeline;
+    if (!timeline_path.empty()) {
+        try {
+            timeline = std::make_unique<StateTimelineWriter>(
+                timeline_path, parseTimelineFormat(program.get<std::string>("--timeline_format")));
+        } catch (const std::runtime_error& err) {
+            std::cerr << err.what() << std::endl;
+            exit(-1);
+        }
+    }
+
     std::deque<Features> file_buffer;  // Create a deque to hold the buffer
 
     // Initialize the FiniteAutomationMachine with default parameters
@@ -96,8 +183,34 @@ int main(int argc, char** argv) {
 
     std::cout<<records.size()<<std::endl;
 
+    size_t first_frame = 0;
+    bool keep_restored_state = false;  // The first window after a resume continues from the snapshot state
+    std::string resume_path = program.get<std::string>("--resume");
+    if (!resume_path.empty()) {
+        try {
+            auto restore_start = std::chrono::high_resolution_clock::now();
+            SessionSnapshot snapshot = readSessionSnapshot(resume_path);
+            PedestrianSnapshot* ped = snapshot.find(pedestrian_id);
+            if (ped && ped->has_fam) {
+                model.restore(ped->fam);
+                keep_restored_state = true;
+                first_frame = std::min<size_t>(ped->source_offset, records.size());
+            }
+            std::chrono::duration<double, std::micro> restore_elapsed = std::chrono::high_resolution_clock::now() - restore_start;
+            std::cout << "Resumed at frame " << first_frame << " in " << restore_elapsed.count() << " us" << std::endl;
+        } catch (const std::runtime_error& err) {
+            std::cerr << "Error resuming session: " << err.what() << std::endl;
+            exit(-1);
+        }
+        // Refill the window from the frames processed before the snapshot
+        for (size_t frame = first_frame > buffer_max_size ? first_frame - buffer_max_size : 0; frame < first_frame; frame++) {
+            file_buffer.push_back(records[frame]);
+        }
+    }
+
     // // Process each feature record
-    for (const auto& features : records) {
+    for (size_t frame = first_frame; frame < records.size(); frame++) {
+        const auto& features = records[frame];
         file_buffer.push_back(features);
         if (file_buffer.size() > buffer_max_size) {
             file_buffer.pop_front();  // Maintain a fixed-size buffer
@@ -108,27 +221,64 @@ int main(int argc, char** argv) {
             std::vector<std::string> states;
             auto start_time = std::chrono::high_resolution_clock::now();
 
-            model.setCurrentStateByName(file_buffer[0].state);  // Set the initial state
+            size_t first_new = 0;
+            if (keep_restored_state) {
+                // The restored state already covers the frames before the snapshot; only run the ones after it
+                first_new = file_buffer.size() - 1 - std::min(file_buffer.size() - 1, frame - first_frame + 1);
+                keep_restored_state = false;
+            } else {
+                model.setCurrentStateByName(file_buffer[0].state);  // Set the initial state
+            }
             file_buffer.pop_front();
 
             // TODO: This seems like you are running the FAM multiple times on the same features
             //       For example, the state at the 39th feature will be computed 40 times
-            for (const auto& buffered_features : file_buffer) {
+            for (size_t i = first_new; i < file_buffer.size(); i++) {
+                const auto& buffered_features = file_buffer[i];
+                if (timeline) {
+                    model.run(buffered_features);
+                    continue;
+                }
                 std::cout << model.getCurrentStateName() << " Ground Truth:  ";
                 std::cout << buffered_features.state << std::endl;
                 model.run(buffered_features);  // Run the model on each buffered item
                 states.push_back(model.getCurrentStateName());  // Assuming getCurrentStateName() returns the state name
             }
 
+            // The state after the newest frame of the window is the state of that frame
+            if (timeline) {
+                timeline->record(pedestrian_id, model.getCurrentStateName(), static_cast<int64_t>(frame));
+            }
+
             auto end_time = std::chrono::high_resolution_clock::now();
             std::chrono::duration<double> elapsed = end_time - start_time;
             time_list.push_back(elapsed.count());
 
-            std::cout << "Time elapsed: " << elapsed.count() << " seconds\n";
-            std::cout << std::endl;
+            if (!timeline) {
+                std::cout << "Time elapsed: " << elapsed.count() << " seconds\n";
+                std::cout << std::endl;
+            }
         }
     }
 
+    std::string snapshot_path = program.get<std::string>("--snapshot_path");
+    if (!snapshot_path.empty()) {
+        SessionSnapshot snapshot;
+        PedestrianSnapshot ped;
+        ped.pedestrian = pedestrian_id;
+        ped.has_fam = true;
+        ped.fam = model.snapshot();
+        ped.source_offset = records.size();
+        snapshot.pedestrians.push_back(ped);
+        writeSessionSnapshot(snapshot_path, snapshot);
+    }
+
+    if (timeline) {
+        timeline->finish();
+        std::cout << "Wrote " << timeline->intervalsWritten() << " state intervals for "
+                  << timeline->framesRecorded() << " frames to " << timeline_path << std::endl;
+    }
+
     double total_time = std::accumulate(time_list.begin(), time_list.end(), 0.0);
     std::cout << "\n\n\n";
     std::cout << "Elapsed time: " << total_time << " seconds\n";
@@ -0,0 +1,128 @@
+#ifndef BACKEND_BENCHMARK_HPP
+#define BACKEND_BENCHMARK_HPP
+
+// Runs several InferenceBackends on the same windows and reports a latency distribution per backend,
+// plus how far each prediction is from the first (reference) backend.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <inference_backend.hpp>
+#include <latency_stats.hpp>
+#include <sliding_window.hpp>
+
+// Every full window of a feature CSV (header skipped), oldest row first, windows back to back
+inline std::vector<float> loadFeatureWindows(const std::string& path, size_t sequence_length, size_t feature_dim) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot open feature file: " + path);
+    }
+    std::vector<float> windows;
+    SlidingWindow window(sequence_length, feature_dim);
+    std::string line;
+    std::getline(file, line);  // Header
+    while (std::getline(file, line)) {
+        float* row = window.next_row();
+        std::fill(row, row + feature_dim, 0.0f);
+        std::stringstream ss(line);
+        std::string item;
+        size_t index = 0;
+        while (std::getline(ss, item, ',') && index < feature_dim) {
+            try {
+                row[index] = std::stof(item);
+            } catch (const std::exception&) {
+                row[index] = 0.0f;
+            }
+            index++;
+        }
+        window.commit_row();
+        if (window.full()) windows.insert(windows.end(), window.data(), window.data() + window.element_count());
+    }
+    return windows;
+}
+
+struct BackendReport {
+    std::string name;
+    LatencyStats latency;  // Per batch, microseconds
+    size_t windows = 0;
+    double max_abs_diff = 0.0;  // Against the reference backend
+    double mean_abs_diff = 0.0;
+};
+
+// Run each backend over `windows` in batches of `batch_size`, `warmup` untimed passes first, then `repeats`
+// timed passes. Predictions are compared on the last timed pass.
+inline std::vector<BackendReport> benchmarkBackends(const std::vector<std::unique_ptr<InferenceBackend>>& backends,
+                                                    const std::vector<float>& windows, size_t sequence_length,
+                                                    size_t feature_dim, size_t batch_size, size_t warmup = 1,
+                                                    size_t repeats = 5) {
+    std::vector<BackendReport> reports;
+    size_t window_size = sequence_length * feature_dim;
+    size_t num_windows = windows.size() / window_size;
+    batch_size = std::max<size_t>(batch_size, 1);
+    std::vector<float> reference;
+
+    for (const auto& backend : backends) {
+        BackendReport report;
+        report.name = backend->name();
+        std::vector<float> predictions;
+        std::vector<float> output;
+
+        for (size_t pass = 0; pass < warmup + repeats; pass++) {
+            bool timed = pass >= warmup;
+            if (timed) predictions.clear();
+            for (size_t first = 0; first < num_windows; first += batch_size) {
+                WindowShape shape{std::min(batch_size, num_windows - first), sequence_length, feature_dim};
+                output.resize(elementCount(backend->outputShape(shape)));
+                const float* input = windows.data() + first * window_size;
+
+                auto start = std::chrono::high_resolution_clock::now();
+                backend->infer(input, shape, output.data());
+                auto end = std::chrono::high_resolution_clock::now();
+                if (!timed) continue;
+                report.latency.add(std::chrono::duration<double, std::micro>(end - start).count());
+                report.windows += shape.batch;
+                predictions.insert(predictions.end(), output.begin(), output.end());
+            }
+        }
+
+        if (reference.empty()) {
+            reference = predictions;
+        } else {
+            size_t n = std::min(reference.size(), predictions.size());
+            double sum = 0.0;
+            for (size_t i = 0; i < n; i++) {
+                double diff = std::abs(static_cast<double>(reference[i]) - predictions[i]);
+                report.max_abs_diff = std::max(report.max_abs_diff, diff);
+                sum += diff;
+            }
+            report.mean_abs_diff = n ? sum / n : 0.0;
+        }
+        reports.push_back(std::move(report));
+    }
+    return reports;
+}
+
+inline void printBackendReports(const std::vector<BackendReport>& reports, std::ostream& out = std::cout) {
+    for (size_t i = 0; i < reports.size(); i++) {
+        const BackendReport& report = reports[i];
+        double seconds = report.latency.total() / 1e6;
+        out << report.name << ": ";
+        report.latency.print(out);
+        out << " per batch, " << (seconds > 0 ? report.windows / seconds : 0.0) << " windows per second";
+        if (i == 0) {
+            out << " (reference)";
+        } else {
+            out << ", max abs diff " << report.max_abs_diff << ", mean abs diff " << report.mean_abs_diff;
+        }
+        out << std::endl;
+    }
+}
+
+#endif // BACKEND_BENCHMARK_HPP
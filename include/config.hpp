@@ -13,6 +13,7 @@ struct Row {
     double User_Y;
     double GazeDirection_X;
     double GazeDirection_Y;
+    double GazeDirection_Z = 0.0;  // Optional in raw logs, only the model input uses it
     double AGV_X;
     double AGV_Y;
     int TimestampID;
@@ -25,6 +26,7 @@ struct Row {
         setters["User_Y"] = [this](const std::string& val) { User_Y = std::stod(val); };
         setters["GazeDirection_X"] = [this](const std::string& val) { GazeDirection_X = std::stod(val); };
         setters["GazeDirection_Y"] = [this](const std::string& val) { GazeDirection_Y = std::stod(val); };
+        setters["GazeDirection_Z"] = [this](const std::string& val) { GazeDirection_Z = std::stod(val); };
         setters["AGV_X"] = [this](const std::string& val) { AGV_X = std::stod(val); };
         setters["AGV_Y"] = [this](const std::string& val) { AGV_Y = std::stod(val); };
         setters["TimestampID"] = [this](const std::string& val) { TimestampID = std::stoi(val); };
@@ -37,6 +39,7 @@ struct Row {
         setters["User_Y"] = [this](const std::string& val) { User_Y = std::stod(val); };
         setters["GazeDirection_X"] = [this](const std::string& val) { GazeDirection_X = std::stod(val); };
         setters["GazeDirection_Y"] = [this](const std::string& val) { GazeDirection_Y = std::stod(val); };
+        setters["GazeDirection_Z"] = [this](const std::string& val) { GazeDirection_Z = std::stod(val); };
         setters["AGV_X"] = [this](const std::string& val) { AGV_X = std::stod(val); };
         setters["AGV_Y"] = [this](const std::string& val) { AGV_Y = std::stod(val); };
         setters["TimestampID"] = [this](const std::string& val) { TimestampID = std::stoi(val); };
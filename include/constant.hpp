@@ -5,7 +5,7 @@
 #include <cmath>  // Include this for math constants and functions
 #include <map>
 // Define the stations as a map with int keys and pairs of doubles representing coordinates
-std::map<int, std::pair<double, double>> stations = {
+inline std::map<int, std::pair<double, double>> stations = {
     {1, {1580, 8683}},
     {2, {1605, 5800}},
     {3, {5812, 8683}},
@@ -17,7 +17,7 @@ std::map<int, std::pair<double, double>> stations = {
 };
 
 // Define the sidewalks as a map with int keys and tuples representing four coordinates (x1, y1, x2, y2)
-std::map<int, std::tuple<double, double, double, double>> sidewalks = {
+inline std::map<int, std::tuple<double, double, double, double>> sidewalks = {
     {1, {2625, 15000, 2625, 8150}},
     {2, {2425, 15000, 2425, 8400}},
     {3, {2625, 8150, 0, 8150}},
@@ -50,7 +50,7 @@ constexpr double STATION_LENGTH = 5.0;  // Length of a station in meters
 // Constants for angular thresholds
 constexpr double GAZING_ANGLE_THRESHOLD = 40;  // Gazing angle threshold in degrees
 constexpr double GAZING_ANGLE_THRESHOLD_RADIUS = M_PI * GAZING_ANGLE_THRESHOLD / 180.0;  // Convert degrees to radians
-const double GAZING_ANGLE_THRESHOLD_COS = std::cos(GAZING_ANGLE_THRESHOLD_RADIUS);  // Cosine of the gazing angle threshold
+inline const double GAZING_ANGLE_THRESHOLD_COS = std::cos(GAZING_ANGLE_THRESHOLD_RADIUS);  // Cosine of the gazing angle threshold
 
 // Speed thresholds for determining motion state
 constexpr double SPEED_THRESHOLD_LOW = 0.2;  // m/s, below this speed, considered stopped
@@ -0,0 +1,39 @@
+#ifndef CPU_AFFINITY_HPP
+#define CPU_AFFINITY_HPP
+
+// Pin the calling thread to a set of cores. Threads it creates afterwards (e.g. an ORT intra-op pool)
+// inherit the mask on Linux. Other platforms have no hard affinity API, pinning is a no-op there.
+
+#include <vector>
+#include <thread>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+inline unsigned hardwareCores() {
+    unsigned cores = std::thread::hardware_concurrency();
+    return cores == 0 ? 1 : cores;
+}
+
+// Cores [first, first + count), wrapped around the machine
+inline std::vector<int> coreRange(unsigned first, unsigned count) {
+    std::vector<int> cores;
+    for (unsigned i = 0; i < count; i++) cores.push_back(static_cast<int>((first + i) % hardwareCores()));
+    return cores;
+}
+
+// True if the thread is now restricted to `cores`
+inline bool pinCurrentThread(const std::vector<int>& cores) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int core : cores) CPU_SET(core, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cores;
+    return false;
+#endif
+}
+
+#endif // CPU_AFFINITY_HPP
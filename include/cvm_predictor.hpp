@@ -0,0 +1,59 @@
+#ifndef CVM_PREDICTOR_HPP
+#define CVM_PREDICTOR_HPP
+
+// Native constant-velocity model, the same extrapolation as model/model_cvm.onnx without a runtime.
+// The ONNX graph averages the 29 frame-to-frame velocities of User_X/User_Y and extrapolates from the last
+// frame; that mean telescopes to (last - first) / (T - 1), so a prediction is one subtraction, one scale
+// and a fused multiply-add per output value.
+
+#include <vector>
+#include <cstddef>
+#include <stdexcept>
+
+class CvmPredictor {
+private:
+    size_t horizon;
+    std::vector<float> steps;  // 1, 2, ..., horizon
+
+public:
+    static constexpr size_t POSITION_DIM = 2;  // User_X, User_Y, the first two features
+
+    explicit CvmPredictor(size_t horizon = 40) : horizon(horizon), steps(horizon) {
+        for (size_t k = 0; k < horizon; k++) steps[k] = static_cast<float>(k + 1);
+    }
+
+    size_t output_horizon() const { return horizon; }
+    size_t output_size(size_t batch) const { return batch * horizon * POSITION_DIM; }
+
+    // windows: [batch, sequence_length, feature_dim], out: [batch, horizon, 2]
+    void predict(const float* windows, size_t batch, size_t sequence_length, size_t feature_dim, float* out) const {
+        if (sequence_length < 2 || feature_dim < POSITION_DIM) {
+            throw std::invalid_argument("CVM needs at least 2 frames with X and Y");
+        }
+        const size_t window_size = sequence_length * feature_dim;
+        const size_t output_stride = horizon * POSITION_DIM;
+        const float inv_span = 1.0f / static_cast<float>(sequence_length - 1);
+        const float* step = steps.data();
+
+        for (size_t b = 0; b < batch; b++) {
+            const float* first = windows + b * window_size;
+            const float* last = first + (sequence_length - 1) * feature_dim;
+            const float x = last[0], y = last[1];
+            const float vx = (last[0] - first[0]) * inv_span, vy = (last[1] - first[1]) * inv_span;
+            float* __restrict__ dst = out + b * output_stride;
+            // Independent iterations over contiguous (x, y) pairs, vectorized by the compiler
+            for (size_t k = 0; k < horizon; k++) {
+                dst[2 * k] = x + vx * step[k];
+                dst[2 * k + 1] = y + vy * step[k];
+            }
+        }
+    }
+
+    std::vector<float> predict(const float* windows, size_t batch, size_t sequence_length, size_t feature_dim) const {
+        std::vector<float> out(output_size(batch));
+        predict(windows, batch, sequence_length, feature_dim, out.data());
+        return out;
+    }
+};
+
+#endif // CVM_PREDICTOR_HPP
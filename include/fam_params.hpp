@@ -0,0 +1,74 @@
+#ifndef FAM_PARAMS_HPP
+#define FAM_PARAMS_HPP
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <utility>
+#include <constant.hpp>
+
+// Runtime copy of the thresholds in constant.hpp and of the multipliers used by the state checks.
+// The defaults reproduce the compiled-in behaviour; tools such as the parameter sweep override them.
+struct FamParams {
+    double walk_stay_threshold = WALK_STAY_THRESHOLD;
+    double close_to_station_threshold_x = CLOSE_TO_STATION_THRESHOLD_X;
+    double close_to_station_threshold_y = CLOSE_TO_STATION_THRESHOLD_Y;
+    double close_to_station_threshold = CLOSE_TO_STATION_THRESHOLD;
+    double gazing_angle_threshold = GAZING_ANGLE_THRESHOLD;  // degrees
+    double collision_threshold = COLLISION_THRESHOLD;
+
+    // Multipliers of the state checks
+    double at_station_scale = 200;               // AtStation: CLOSE_TO_STATION_THRESHOLD_X/Y * 200
+    double approach_station_x_scale = 200;       // ApproachingStation: STATION_LENGTH * 200
+    double approach_station_y_scale = 150;       // ApproachingStation: CLOSE_TO_STATION_THRESHOLD * 150
+    double approach_sidewalk_speed_scale = 0.3;  // ApproachingSidewalk: WALK_STAY_THRESHOLD * 0.3
+
+    // Derived from gazing_angle_threshold, kept in sync by set()
+    double gazing_angle_threshold_cos = GAZING_ANGLE_THRESHOLD_COS;
+
+    // Name -> member table used by set() and by the sweep reports
+    static const std::vector<std::pair<std::string, double FamParams::*>>& fields() {
+        static const std::vector<std::pair<std::string, double FamParams::*>> table = {
+            {"walk_stay_threshold", &FamParams::walk_stay_threshold},
+            {"close_to_station_threshold_x", &FamParams::close_to_station_threshold_x},
+            {"close_to_station_threshold_y", &FamParams::close_to_station_threshold_y},
+            {"close_to_station_threshold", &FamParams::close_to_station_threshold},
+            {"gazing_angle_threshold", &FamParams::gazing_angle_threshold},
+            {"collision_threshold", &FamParams::collision_threshold},
+            {"at_station_scale", &FamParams::at_station_scale},
+            {"approach_station_x_scale", &FamParams::approach_station_x_scale},
+            {"approach_station_y_scale", &FamParams::approach_station_y_scale},
+            {"approach_sidewalk_speed_scale", &FamParams::approach_sidewalk_speed_scale},
+        };
+        return table;
+    }
+
+    // Set a parameter by name, returns false for unknown names
+    bool set(const std::string& name, double value) {
+        for (const auto& [field_name, member] : fields()) {
+            if (field_name == name) {
+                this->*member = value;
+                gazing_angle_threshold_cos = std::cos(M_PI * gazing_angle_threshold / 180.0);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    double get(const std::string& name) const {
+        for (const auto& [field_name, member] : fields()) {
+            if (field_name == name) return this->*member;
+        }
+        return 0.0;
+    }
+
+    // Parameters that change the generated features (not only the FAM checks)
+    static bool affects_features(const std::string& name) {
+        return name == "walk_stay_threshold" || name == "gazing_angle_threshold" || name == "collision_threshold";
+    }
+};
+
+// Parameters in effect for the calling thread. Each sweep worker installs its own set.
+inline thread_local FamParams fam_params;
+
+#endif // FAM_PARAMS_HPP
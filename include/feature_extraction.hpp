@@ -0,0 +1,224 @@
+#ifndef FEATURE_EXTRACTION_HPP
+#define FEATURE_EXTRACTION_HPP
+
+// Raw Row -> Features extraction shared by the feature generator and the live model input path.
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <deque>
+#include <sstream>
+#include <config.hpp>
+#include <constant.hpp>
+#include <feature_rules.hpp>
+#include <session_snapshot.hpp>
+
+inline double get_angle_between_normalized_vectors(const std::tuple<double, double>& v1, const std::tuple<double, double>& v2) {
+    double dot_product = std::get<0>(v1) * std::get<0>(v2) + std::get<1>(v1) * std::get<1>(v2);
+    return std::acos(dot_product);
+}
+
+// Function to calculate the distance to the closest station
+inline std::tuple<int, double, double, double> generate_distance_to_closest_station_helper(const Row& row) {
+    double mindis = std::numeric_limits<double>::max();
+    int closest_station = -1;
+    double mindis_X = 0.0, mindis_Y = 0.0;
+
+    // Iterate over stations to find the closest one
+    for (const auto& station : stations) {
+        double station_X = station.second.first;
+        double station_Y = station.second.second;
+
+        // Calculate the distance between the user and the station
+        double dis = std::sqrt((row.User_X - station_X) * (row.User_X - station_X) +
+                               (row.User_Y - station_Y) * (row.User_Y - station_Y));
+
+        // Update minimum distance and closest station if a closer one is found
+        if (dis < mindis) {
+            mindis = dis;
+            closest_station = station.first;
+            mindis_X = std::abs(row.User_X - station_X);
+            mindis_Y = std::abs(row.User_Y - station_Y);
+        }
+    }
+
+    // Return the closest station, minimum distance, and X, Y distance components
+    return std::make_tuple(closest_station, mindis, mindis_X, mindis_Y);
+}
+
+// Features of one row; prev_row (nullptr for the first frame of a session) supplies the speeds.
+// Streaming callers keep the previous row themselves and carry it across restarts in a session snapshot.
+inline Features extract_features(const Row& row, const Row* prev_row) {
+    Features features;
+
+    // Copy raw features
+    features.GazeDirection_X = row.GazeDirection_X;
+    features.GazeDirection_Y = row.GazeDirection_Y;
+    features.AGV_X = row.AGV_X;
+    features.AGV_Y = row.AGV_Y;
+    features.User_X = row.User_X;
+    features.User_Y = row.User_Y;
+    features.TimestampID = row.TimestampID;
+    features.Wait_time = 0.0;  // Set by generate_wait_time while the user waits
+
+    // Trip columns are only known to callers that know the pedestrian's start and end station
+    features.start_station_X = features.start_station_Y = 0.0;
+    features.end_station_X = features.end_station_Y = 0.0;
+    features.distance_from_start_station_X = features.distance_from_start_station_Y = 0.0;
+    features.distance_from_end_station_X = features.distance_from_end_station_Y = 0.0;
+    features.facing_start_station = features.facing_end_station = false;
+
+    // Calculate distances
+    features.AGV_distance_X = std::abs(row.User_X - row.AGV_X);
+    features.AGV_distance_Y = std::abs(row.User_Y - row.AGV_Y);
+
+    // Normalized gaze direction
+    double gaze_direction_length = std::sqrt(row.GazeDirection_X * row.GazeDirection_X + row.GazeDirection_Y * row.GazeDirection_Y);
+    features.GazeDirection_X /= gaze_direction_length;
+    features.GazeDirection_Y /= gaze_direction_length;
+
+    // Calculate speeds and velocities using previous row data
+    if (prev_row) {
+        features.AGV_speed_X = (row.AGV_X - prev_row->AGV_X) / (row.TimestampID - prev_row->TimestampID);
+        features.AGV_speed_Y = (row.AGV_Y - prev_row->AGV_Y) / (row.TimestampID - prev_row->TimestampID);
+        features.AGV_speed = std::sqrt(features.AGV_speed_X * features.AGV_speed_X + features.AGV_speed_Y * features.AGV_speed_Y);
+
+        features.User_speed_X = (row.User_X - prev_row->User_X) / (row.TimestampID - prev_row->TimestampID);
+        features.User_speed_Y = (row.User_Y - prev_row->User_Y) / (row.TimestampID - prev_row->TimestampID);
+        features.User_speed = std::sqrt(features.User_speed_X * features.User_speed_X + features.User_speed_Y * features.User_speed_Y);
+
+        features.User_velocity_X = features.User_speed_X;
+        features.User_velocity_Y = features.User_speed_Y;
+    } else {
+        features.AGV_speed_X = 0.0;
+        features.AGV_speed_Y = 0.0;
+        features.AGV_speed = 0.0;
+        features.User_speed_X = 0.0;
+        features.User_speed_Y = 0.0;
+        features.User_speed = 0.0;
+        features.User_velocity_X = 0.0;
+        features.User_velocity_Y = 0.0;
+    }
+    features.user_agv_direction_cos = get_user_agv_direction_cos(row);
+
+    //fixed: Can we use the WALK_STAY_THRESHOLD here instead of the 0.1?
+    // Most close station and intent to cross
+    //fixed: Is this the station that is closest to the user's gaze direction?
+    auto close_station_res = get_most_close_station_direction(row);
+    auto station_direction = std::make_pair(std::get<0>(close_station_res), std::get<1>(close_station_res));
+    features.gazing_station_direction_cos = std::get<0>(close_station_res);
+    features.Gazing_station = station_direction.second;
+    features.closest_station_dir_X = std::get<2>(close_station_res);
+    features.closest_station_dir_Y = std::get<3>(close_station_res);
+
+    // fixed: Is the gazing station always the closest station?
+    auto closest_station_res = generate_distance_to_closest_station_helper(row);
+    features.closest_station = std::get<0>(closest_station_res);
+    features.distance_to_closest_station = std::get<1>(closest_station_res);
+    features.distance_to_closest_station_X = std::get<2>(closest_station_res);
+    features.distance_to_closest_station_Y = std::get<3>(closest_station_res);
+
+    // Threshold-dependent features (intent_to_cross, possible_interaction, facing_*, looking_at_*)
+    update_threshold_features(features);
+
+    return features;
+}
+
+inline Features extract_features(const std::deque<Row>& rows, size_t index) {
+    return extract_features(rows[index], index > 0 ? &rows[index - 1] : nullptr);
+}
+
+
+// Wait time of one frame, in place. The flags live in `state`, so a stream can be processed frame by frame
+// (and resumed from a session snapshot) with the same result as one pass over all frames.
+inline void update_wait_time(Features& row, WaitTimeState& state, double H1 = 0.2, double H2 = 0.1, double THRESHOLD_ANGLE = 30, double frame_rate = 30) {
+
+    // Constants and data
+    const double ERROR_RANGE = 50;  // Replace with actual error range
+    double threshold_COSINE = std::cos(THRESHOLD_ANGLE * M_PI / 180);  // Convert angle to radians and find cosine
+
+    bool& begin_wait_Flag = state.begin_wait_Flag;
+    bool& AGV_passed_Flag = state.AGV_passed_Flag;
+    uint64_t& begin_wait_Timestamp = state.begin_wait_Timestamp;
+    uint64_t index = state.frames_seen++;  // Session-wide frame index
+
+    // If AGV already passed, skip this row
+    if (AGV_passed_Flag) {
+        return;
+    }
+
+    // Check if the user is on the sidewalk
+    bool on_sidewalk = (row.User_Y > 8150 - ERROR_RANGE && row.User_Y < 8400 + ERROR_RANGE) ||
+                       (row.User_Y > 6045 - ERROR_RANGE && row.User_Y < 6295 + ERROR_RANGE);
+
+    // Check if the user is on the road
+    bool on_road = (row.User_Y < 8150 - ERROR_RANGE / 2) && (row.User_Y > 6295 + ERROR_RANGE / 2);
+
+    row.On_sidewalks = on_sidewalk;
+    row.On_road = on_road;
+    // Check if user is looking at AGV using angle and cosine threshold
+    // tuple<double, double> target_station_pos = stations[User_trajectory[stoi(row.AGV_name.substr(3))][1]];
+    // tuple<double, double> user_target_station_dir = get_direction_normalized(make_tuple(row.User_X, row.User_Y), target_station_pos);
+
+    std::pair<double, double> user_agv_dir = get_direction_normalized(std::make_tuple(row.User_X, row.User_Y), std::make_tuple(row.AGV_X, row.AGV_Y));
+
+    double user_target_station_angle = get_angle_between_normalized_vectors(std::make_tuple(row.GazeDirection_X, row.GazeDirection_Y), user_agv_dir);
+    double user_agv_angle = get_angle_between_normalized_vectors(std::make_tuple(row.GazeDirection_X, row.GazeDirection_Y), std::make_tuple(row.closest_station_dir_X, row.closest_station_dir_Y));
+
+    bool looking_at_AGV = (std::cos(user_target_station_angle) > threshold_COSINE || std::cos(user_agv_angle) > threshold_COSINE);
+
+    // Check if user is in a waiting state
+    bool wait_state = (std::sqrt(row.User_speed_X * row.User_speed_X + row.User_speed_Y * row.User_speed_Y) < H1);
+
+    // Begin waiting state
+    if (!begin_wait_Flag) {  // User is walking
+        if (wait_state && on_sidewalk && !looking_at_AGV) {
+            begin_wait_Flag = true;
+            begin_wait_Timestamp = (index > 1) ? index - 1 : 1;  // Use the previous index or first
+            row.Wait_time = (index - begin_wait_Timestamp) / frame_rate;
+        } else {
+            return;
+        }
+    } else {  // User is in a waiting state
+        if (std::sqrt(row.User_speed_X * row.User_speed_X + row.User_speed_Y * row.User_speed_Y) <= H2) {  // Still waiting
+            row.Wait_time = (index - begin_wait_Timestamp) / frame_rate;
+        } else {  // End waiting state
+            begin_wait_Flag = false;
+            begin_wait_Timestamp = 0;
+            row.Wait_time = 0;
+            AGV_passed_Flag = true;  // AGV has passed
+        }
+    }
+}
+
+// Wait time over a batch of frames, in place, carrying the flags in `state` between batches
+inline void generate_wait_time(std::vector<Features>& rows, WaitTimeState& state, double H1 = 0.2, double H2 = 0.1, double THRESHOLD_ANGLE = 30, double frame_rate = 30) {
+    for (Features& row : rows) update_wait_time(row, state, H1, H2, THRESHOLD_ANGLE, frame_rate);
+}
+
+inline std::vector<Features> generate_wait_time(std::vector<Features>& rows, double H1 = 0.2, double H2 = 0.1, double THRESHOLD_ANGLE = 30, double frame_rate = 30) {
+    WaitTimeState state;
+    generate_wait_time(rows, state, H1, H2, THRESHOLD_ANGLE, frame_rate);
+    return rows;
+}
+
+// Parse CSV line into Row struct
+inline Row parseCSVLine(const std::string& line, const std::vector<std::string>& headers) {
+    std::istringstream lineStream(line);
+    std::string cell;
+    Row row;
+    size_t columnIndex = 0;
+
+    while (std::getline(lineStream, cell, ',')) {
+        if (columnIndex < headers.size()) {
+            row.setField(headers[columnIndex], cell);
+        }
+        columnIndex++;
+    }
+
+    return row;
+}
+
+#endif // FEATURE_EXTRACTION_HPP
@@ -0,0 +1,188 @@
+#ifndef FEATURE_RULES_HPP
+#define FEATURE_RULES_HPP
+
+// Per-row feature rules shared by the feature generator and the parameter sweep.
+// Threshold-dependent rules read the runtime parameters in fam_params.hpp.
+
+#include <cmath>
+#include <tuple>
+#include <utility>
+#include <config.hpp>
+#include <constant.hpp>
+#include <fam_params.hpp>
+
+inline std::pair<double, double> get_direction_normalized(const std::tuple<double, double>& start, const std::tuple<double, double>& end) {
+    double x = std::get<0>(end) - std::get<0>(start);
+    double y = std::get<1>(end) - std::get<1>(start);
+    double length = std::sqrt(x * x + y * y);
+    return {x / length, y / length};
+}
+
+// fixed: Does this function compute the closest station or the station that matches the gaze direction most closely?
+inline std::tuple<double, int, double, double> get_most_close_station_direction(const Row& row) {
+    double max_cos = -1;
+    int most_common_station = -1;
+    double closest_station_X;
+    double closest_station_Y;
+    for (const auto& [station, position] : stations) {
+        // Get normalized direction vector
+        std::pair<double, double> direction_normalized = get_direction_normalized({row.User_X, row.User_Y}, position);
+
+        // Calculate cosine of the angle between gaze direction and station direction
+        double cosine_gaze_direction = row.GazeDirection_X * direction_normalized.first + row.GazeDirection_Y * direction_normalized.second;
+
+
+        // Update max cosine and station if current cosine is greater
+        if (cosine_gaze_direction > max_cos) {
+            max_cos = cosine_gaze_direction;
+            most_common_station = station;
+            closest_station_X = direction_normalized.first;
+            closest_station_Y = direction_normalized.second;
+        }
+    }
+
+    return { max_cos, most_common_station, closest_station_X, closest_station_Y };
+}
+
+inline double get_user_agv_direction_cos(const Row& row) {
+    std::pair<double, double> direction_normalized = get_direction_normalized(
+        std::make_tuple(row.User_X, row.User_Y), std::make_tuple(row.AGV_X, row.AGV_Y));
+    return row.GazeDirection_X * std::get<0>(direction_normalized) +
+           row.GazeDirection_Y * std::get<1>(direction_normalized);
+}
+
+inline bool intent_to_cross_helper(const Features& row) {
+    const double THRESHOLD_ANGLE = 30;
+    const double THRESHOLD_COS = std::cos(THRESHOLD_ANGLE * M_PI / 180);  // Convert angle to radians
+    const double walk_stay_threshold = fam_params.walk_stay_threshold;
+
+    bool facing_to_road = true;
+
+    // Check for moving down and above threshold
+    if (row.User_velocity_Y < 0 && row.User_Y > 6295) {
+        // If moving down, should be looking down
+        facing_to_road = -row.GazeDirection_Y > THRESHOLD_COS;
+    } else if (row.User_velocity_Y < -walk_stay_threshold && row.User_Y < 6295) {
+        facing_to_road = false;
+    }
+
+    // Check for moving up and below threshold
+    if (row.User_velocity_Y > 0 && row.User_Y < 8150) {
+        // If moving up, should be looking up
+        facing_to_road = row.GazeDirection_Y > THRESHOLD_COS;
+    } else if (row.User_velocity_Y > walk_stay_threshold && row.User_Y > 8150) {
+        facing_to_road = false;
+    }
+
+    // Determine if the user intends to cross the road
+    if ((row.gazing_station_direction_cos > THRESHOLD_COS &&
+         std::abs(row.User_Y - std::get<1>(stations[row.Gazing_station])) > 300) ||
+        (row.user_agv_direction_cos > THRESHOLD_COS) && facing_to_road) {
+        return true;
+    } else {
+        return false;
+    }
+}
+
+// Helper function to compute the distance between two points (x1, y1) and (x2, y2)
+inline double compute_distance(double x1, double y1, double x2, double y2) {
+    return std::sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
+}
+
+// Possible interaction function to check for collision
+inline bool possible_interaction_helper(const Features& row, double COLLISION_THRESHOLD) {
+    // Relative velocity between the AGV and the user
+    double relative_velocity_X = row.User_speed_X - row.AGV_speed_X;
+    double relative_velocity_Y = row.User_speed_Y - row.AGV_speed_Y;
+
+    // Initial distance between the AGV and the user
+    double initial_distance = compute_distance(row.User_X, row.User_Y, row.AGV_X, row.AGV_Y);
+
+    // If initial distance is less than the threshold, assume possible interaction
+    if (initial_distance < COLLISION_THRESHOLD) {
+        return true;
+    }
+
+    // Time to collision (assuming constant velocity model)
+    double relative_speed_squared = relative_velocity_X * relative_velocity_X + relative_velocity_Y * relative_velocity_Y;
+
+    // If relative speed is zero, no collision can happen (they are moving parallel or stationary)
+    if (relative_speed_squared == 0) {
+        return false;
+    }
+
+    // Projected future positions: Compute the time when they would collide
+    double time_to_collision = -((row.User_X - row.AGV_X) * relative_velocity_X + (row.User_Y - row.AGV_Y) * relative_velocity_Y) / relative_speed_squared;
+
+    // If the collision time is positive and the objects are projected to be within the threshold distance at that time
+    if (time_to_collision > 0) {
+        double future_user_X = row.User_X + row.User_speed_X * time_to_collision;
+        double future_user_Y = row.User_Y + row.User_speed_Y * time_to_collision;
+        double future_agv_X = row.AGV_X + row.AGV_speed_X * time_to_collision;
+        double future_agv_Y = row.AGV_Y + row.AGV_speed_Y * time_to_collision;
+
+        double future_distance = compute_distance(future_user_X, future_user_Y, future_agv_X, future_agv_Y);
+
+        if (future_distance < COLLISION_THRESHOLD) {
+            return true;
+        }
+    }
+
+    return false;  // No collision is expected
+}
+
+inline bool facing_road_helper(const Features& row) {
+    const double gazing_angle_threshold_cos = fam_params.gazing_angle_threshold_cos;
+    const double walk_stay_threshold = fam_params.walk_stay_threshold;
+
+    // If moving down and Y is greater than 6295
+    if (row.User_velocity_Y < 0 && row.User_Y > 6295) {
+        // If moving down, check if gaze is also down
+        return -row.GazeDirection_Y > gazing_angle_threshold_cos;
+    }
+    // If moving down below the threshold and Y is less than 6295
+    else if (row.User_velocity_Y < -walk_stay_threshold && row.User_Y < 6295) {
+        return false;
+    }
+
+    // If moving up and Y is less than 8150
+    if (row.User_velocity_Y > 0 && row.User_Y < 8150) {
+        // If moving up, check if gaze is also up
+        return row.GazeDirection_Y > gazing_angle_threshold_cos;
+    }
+    // If moving up above the threshold and Y is greater than 8150
+    else if (row.User_velocity_Y > walk_stay_threshold && row.User_Y > 8150) {
+        return false;
+    }
+
+    // Assume they are facing the road if they are stationary
+    return true;
+}
+
+// Recompute every feature that depends on a runtime threshold. Expects the raw positions,
+// velocities and the gaze cosines (gazing_station_direction_cos, user_agv_direction_cos) to be set.
+inline void update_threshold_features(Features& features) {
+    const double gazing_angle_threshold_cos = fam_params.gazing_angle_threshold_cos;
+
+    //fixed: Include another constant in constant.hpp for this instead of using a random float here...
+    features.intent_to_cross = intent_to_cross_helper(features);
+
+    // Possible interaction (as an example)
+    //fixed: Include another constant in constant.hpp for this instead of using a random float here...
+    //fixed: Not sure how this corresponds to possible interaction.
+    //fixed: Please explain this feature
+    features.possible_interaction = possible_interaction_helper(features, fam_params.collision_threshold);
+
+    // Example features (need more context to compute correctly)
+    // fixed: These features have not been computed. Are we not using them anymore?
+    features.facing_along_sidewalk = features.GazeDirection_X > gazing_angle_threshold_cos;
+    features.facing_to_road = facing_road_helper(features);
+
+    //TODO: Include another constant in constant.hpp for this instead of using a random float here...
+    features.looking_at_AGV = features.user_agv_direction_cos > gazing_angle_threshold_cos;
+
+    // TODO: This statement also feels dubious
+    features.looking_at_closest_station = features.gazing_station_direction_cos > gazing_angle_threshold_cos;
+}
+
+#endif // FEATURE_RULES_HPP
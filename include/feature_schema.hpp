@@ -0,0 +1,261 @@
+#ifndef FEATURE_SCHEMA_HPP
+#define FEATURE_SCHEMA_HPP
+
+// Model input layout and the column mapping that writes Features straight into a model input row.
+// A FeatureSchema is the ordered list of model columns with an optional (mean, std) per column; it comes from
+// the model's metadata, a schema file or the layout of data/demo/feature_model. A FeatureAssembler resolves
+// every column to an accessor once, then fills float rows with no text in between.
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <config.hpp>
+#include <constant.hpp>
+
+struct FeatureSchema {
+    std::vector<std::string> columns;
+    std::vector<float> mean;   // Subtracted from each column
+    std::vector<float> scale;  // Then multiplied, 1 / std
+
+    size_t size() const { return columns.size(); }
+
+    void add(const std::string& column, float column_mean = 0.0f, float column_std = 1.0f) {
+        if (column_std == 0.0f) {
+            throw std::runtime_error("Feature column " + column + " has a zero std");
+        }
+        columns.push_back(column);
+        mean.push_back(column_mean);
+        scale.push_back(1.0f / column_std);
+    }
+};
+
+// Column order of data/demo/feature_model, what the shipped models were trained on
+inline FeatureSchema defaultFeatureSchema() {
+    FeatureSchema schema;
+    for (const char* column : {"User_X", "User_Y", "AGV_distance_X", "AGV_distance_Y", "AGV_speed_X", "AGV_speed_Y",
+                               "AGV_speed", "User_speed_X", "User_speed_Y", "User_speed", "User_velocity_X",
+                               "User_velocity_Y", "Wait_time", "Gazing_station", "closest_station",
+                               "distance_to_closest_station", "distance_to_closest_station_X",
+                               "distance_to_closest_station_Y", "start_station_X", "start_station_Y", "end_station_X",
+                               "end_station_Y", "distance_from_start_station_X", "distance_from_start_station_Y",
+                               "distance_from_end_station_X", "distance_from_end_station_Y", "GazeDirection_X",
+                               "GazeDirection_Y", "GazeDirection_Z", "AGV_X", "AGV_Y", "rolling_avg"}) {
+        schema.add(column);
+    }
+    return schema;
+}
+
+inline std::vector<std::string> splitSchemaList(const std::string& text) {
+    std::vector<std::string> items;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t first = item.find_first_not_of(" \t\r\n");
+        size_t last = item.find_last_not_of(" \t\r\n");
+        items.push_back(first == std::string::npos ? "" : item.substr(first, last - first + 1));
+    }
+    return items;
+}
+
+// Comma-separated column names with optional comma-separated means and stds, as stored in model metadata
+inline FeatureSchema parseFeatureSchema(const std::string& columns, const std::string& means = "",
+                                        const std::string& stds = "") {
+    std::vector<std::string> names = splitSchemaList(columns);
+    std::vector<std::string> mean_values = splitSchemaList(means);
+    std::vector<std::string> std_values = splitSchemaList(stds);
+    if ((!means.empty() && mean_values.size() != names.size()) || (!stds.empty() && std_values.size() != names.size())) {
+        throw std::runtime_error("Feature normalization does not match the feature columns");
+    }
+    FeatureSchema schema;
+    for (size_t i = 0; i < names.size(); i++) {
+        schema.add(names[i], means.empty() ? 0.0f : std::stof(mean_values[i]), stds.empty() ? 1.0f : std::stof(std_values[i]));
+    }
+    return schema;
+}
+
+// A schema file lists one column per line as `name[,mean,std]` ('#' starts a comment). A .csv file is read
+// as a feature CSV whose header gives the columns, e.g. data/demo/feature_model/0.csv.
+inline FeatureSchema loadFeatureSchema(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot open feature schema: " + path);
+    }
+    std::string line;
+    if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0) {
+        std::getline(file, line);
+        return parseFeatureSchema(line);
+    }
+    FeatureSchema schema;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+        std::vector<std::string> fields = splitSchemaList(line);
+        if (fields.empty() || fields[0].empty()) continue;
+        if (fields.size() != 1 && fields.size() != 3) {
+            throw std::runtime_error("Bad feature schema line: " + line);
+        }
+        schema.add(fields[0], fields.size() == 3 ? std::stof(fields[1]) : 0.0f,
+                   fields.size() == 3 ? std::stof(fields[2]) : 1.0f);
+    }
+    return schema;
+}
+
+// What a column accessor sees: the extracted features, the raw row they came from when there is one,
+// and the assembler's own running values
+struct FeatureFrame {
+    const Features& features;
+    const Row* raw;
+    double rolling_avg;
+};
+
+class FeatureAssembler {
+public:
+    using Accessor = double (*)(const FeatureFrame&);
+
+private:
+    std::vector<Accessor> accessors;
+    std::vector<float> mean;
+    std::vector<float> scale;
+
+    // Trip of the pedestrian, the AGV_name lookup of the Python generator
+    bool has_trip = false;
+    std::pair<double, double> start_station{0.0, 0.0};
+    std::pair<double, double> end_station{0.0, 0.0};
+
+    // Trailing mean of User_speed; offline it is centered, which a live stream cannot do
+    std::vector<double> speeds;
+    size_t speed_count = 0;
+    size_t speed_next = 0;
+    double speed_sum = 0.0;
+
+    static const std::unordered_map<std::string, Accessor>& columnAccessors() {
+        static const std::unordered_map<std::string, Accessor> accessors = {
+            {"User_X", [](const FeatureFrame& f) { return f.features.User_X; }},
+            {"User_Y", [](const FeatureFrame& f) { return f.features.User_Y; }},
+            {"AGV_X", [](const FeatureFrame& f) { return f.features.AGV_X; }},
+            {"AGV_Y", [](const FeatureFrame& f) { return f.features.AGV_Y; }},
+            {"AGV_distance_X", [](const FeatureFrame& f) { return f.features.AGV_distance_X; }},
+            {"AGV_distance_Y", [](const FeatureFrame& f) { return f.features.AGV_distance_Y; }},
+            {"AGV_speed_X", [](const FeatureFrame& f) { return f.features.AGV_speed_X; }},
+            {"AGV_speed_Y", [](const FeatureFrame& f) { return f.features.AGV_speed_Y; }},
+            {"AGV_speed", [](const FeatureFrame& f) { return f.features.AGV_speed; }},
+            {"User_speed_X", [](const FeatureFrame& f) { return f.features.User_speed_X; }},
+            {"User_speed_Y", [](const FeatureFrame& f) { return f.features.User_speed_Y; }},
+            {"User_speed", [](const FeatureFrame& f) { return f.features.User_speed; }},
+            {"User_velocity_X", [](const FeatureFrame& f) { return f.features.User_velocity_X; }},
+            {"User_velocity_Y", [](const FeatureFrame& f) { return f.features.User_velocity_Y; }},
+            {"Wait_time", [](const FeatureFrame& f) { return f.features.Wait_time; }},
+            {"intent_to_cross", [](const FeatureFrame& f) { return f.features.intent_to_cross ? 1.0 : 0.0; }},
+            {"Gazing_station", [](const FeatureFrame& f) { return static_cast<double>(f.features.Gazing_station); }},
+            {"possible_interaction", [](const FeatureFrame& f) { return f.features.possible_interaction ? 1.0 : 0.0; }},
+            {"facing_along_sidewalk", [](const FeatureFrame& f) { return f.features.facing_along_sidewalk ? 1.0 : 0.0; }},
+            {"facing_to_road", [](const FeatureFrame& f) { return f.features.facing_to_road ? 1.0 : 0.0; }},
+            {"On_sidewalks", [](const FeatureFrame& f) { return f.features.On_sidewalks ? 1.0 : 0.0; }},
+            {"On_road", [](const FeatureFrame& f) { return f.features.On_road ? 1.0 : 0.0; }},
+            {"closest_station", [](const FeatureFrame& f) { return static_cast<double>(f.features.closest_station); }},
+            {"distance_to_closest_station", [](const FeatureFrame& f) { return f.features.distance_to_closest_station; }},
+            {"distance_to_closest_station_X", [](const FeatureFrame& f) { return f.features.distance_to_closest_station_X; }},
+            {"distance_to_closest_station_Y", [](const FeatureFrame& f) { return f.features.distance_to_closest_station_Y; }},
+            {"looking_at_AGV", [](const FeatureFrame& f) { return f.features.looking_at_AGV ? 1.0 : 0.0; }},
+            {"start_station_X", [](const FeatureFrame& f) { return f.features.start_station_X; }},
+            {"start_station_Y", [](const FeatureFrame& f) { return f.features.start_station_Y; }},
+            {"end_station_X", [](const FeatureFrame& f) { return f.features.end_station_X; }},
+            {"end_station_Y", [](const FeatureFrame& f) { return f.features.end_station_Y; }},
+            {"distance_from_start_station_X", [](const FeatureFrame& f) { return f.features.distance_from_start_station_X; }},
+            {"distance_from_start_station_Y", [](const FeatureFrame& f) { return f.features.distance_from_start_station_Y; }},
+            {"distance_from_end_station_X", [](const FeatureFrame& f) { return f.features.distance_from_end_station_X; }},
+            {"distance_from_end_station_Y", [](const FeatureFrame& f) { return f.features.distance_from_end_station_Y; }},
+            {"facing_start_station", [](const FeatureFrame& f) { return f.features.facing_start_station ? 1.0 : 0.0; }},
+            {"facing_end_station", [](const FeatureFrame& f) { return f.features.facing_end_station ? 1.0 : 0.0; }},
+            {"looking_at_closest_station", [](const FeatureFrame& f) { return f.features.looking_at_closest_station ? 1.0 : 0.0; }},
+            // The model was trained on the raw gaze vector; Features only keeps its normalized XY
+            {"GazeDirection_X", [](const FeatureFrame& f) { return f.raw ? f.raw->GazeDirection_X : f.features.GazeDirection_X; }},
+            {"GazeDirection_Y", [](const FeatureFrame& f) { return f.raw ? f.raw->GazeDirection_Y : f.features.GazeDirection_Y; }},
+            {"GazeDirection_Z", [](const FeatureFrame& f) { return f.raw ? f.raw->GazeDirection_Z : 0.0; }},
+            {"rolling_avg", [](const FeatureFrame& f) { return f.rolling_avg; }},
+        };
+        return accessors;
+    }
+
+    double updateRollingAverage(double speed) {
+        if (speeds.empty()) return speed;
+        if (speed_count == speeds.size()) {
+            speed_sum -= speeds[speed_next];
+        } else {
+            speed_count++;
+        }
+        speeds[speed_next] = speed;
+        speed_sum += speed;
+        speed_next = (speed_next + 1) % speeds.size();
+        return speed_sum / speed_count;
+    }
+
+    void writeRow(const FeatureFrame& frame, float* out) const {
+        for (size_t i = 0; i < accessors.size(); i++) {
+            out[i] = (static_cast<float>(accessors[i](frame)) - mean[i]) * scale[i];
+        }
+    }
+
+public:
+    // rolling_window: frames in rolling_avg, frame_rate / 2 in the Python generator (35 at 70 fps)
+    explicit FeatureAssembler(const FeatureSchema& schema, size_t rolling_window = 35)
+        : mean(schema.mean), scale(schema.scale), speeds(rolling_window) {
+        const auto& known = columnAccessors();
+        for (const std::string& column : schema.columns) {
+            auto it = known.find(column);
+            if (it == known.end()) {
+                throw std::runtime_error("Feature column " + column + " has no C++ feature");
+            }
+            accessors.push_back(it->second);
+        }
+    }
+
+    size_t size() const { return accessors.size(); }
+
+    // Start and end station ids of the trip, filled into every row by applyTrip()
+    void setTrip(int start, int end) {
+        if (stations.count(start) == 0 || stations.count(end) == 0) {
+            throw std::runtime_error("Unknown trip station " + std::to_string(start) + " -> " + std::to_string(end));
+        }
+        has_trip = true;
+        start_station = stations.at(start);
+        end_station = stations.at(end);
+    }
+
+    void applyTrip(Features& features) const {
+        if (!has_trip) return;
+        features.start_station_X = start_station.first;
+        features.start_station_Y = start_station.second;
+        features.end_station_X = end_station.first;
+        features.end_station_Y = end_station.second;
+        features.distance_from_start_station_X = std::abs(features.User_X - start_station.first);
+        features.distance_from_start_station_Y = std::abs(features.User_Y - start_station.second);
+        features.distance_from_end_station_X = std::abs(features.User_X - end_station.first);
+        features.distance_from_end_station_Y = std::abs(features.User_Y - end_station.second);
+    }
+
+    // Forget the running values, for a new pedestrian
+    void reset() {
+        speed_count = 0;
+        speed_next = 0;
+        speed_sum = 0.0;
+    }
+
+    // Next frame of the stream into `out` (size() floats); `raw` may be null when only Features are at hand
+    void write(const Features& features, const Row* raw, float* out) {
+        writeRow({features, raw, updateRollingAverage(features.User_speed)}, out);
+    }
+
+    // Consecutive frames of one pedestrian into rows.size() x size() floats
+    void writeBatch(const std::vector<Features>& rows, float* out) {
+        for (const Features& features : rows) {
+            write(features, nullptr, out);
+            out += accessors.size();
+        }
+    }
+};
+
+#endif // FEATURE_SCHEMA_HPP
@@ -0,0 +1,104 @@
+#ifndef FEATURE_SESSION_HPP
+#define FEATURE_SESSION_HPP
+
+// A whole recorded feature session (feature CSV) parsed into one contiguous [rows x feature_dim] block, for
+// offline re-scoring. The file is memory-mapped and parsed by all cores, each taking a range of lines.
+// Sliding window i (rows i .. i + sequence_length) is the contiguous span starting at row i, so every window
+// is a view into the block; overlapping windows only need a copy when a backend wants a dense batch.
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <mapped_file.hpp>
+#include <cpu_affinity.hpp>
+
+class FeatureSession {
+private:
+    std::vector<float> values;
+    size_t rows = 0;
+    size_t feature_dim;
+
+    // Parse the lines in [begin, end) like the runners' convertLineToRow: up to feature_dim fields,
+    // missing or unparsable fields are zero
+    static void parseLines(const char* begin, const char* end, size_t feature_dim, std::vector<float>& out) {
+        std::string line;
+        while (begin < end) {
+            const char* newline = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+            const char* line_end = newline ? newline : end;
+            line.assign(begin, line_end);
+            begin = line_end + 1;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+
+            size_t first = out.size();
+            out.resize(first + feature_dim, 0.0f);
+            const char* field = line.c_str();
+            for (size_t i = 0; i < feature_dim; i++) {
+                char* parsed = nullptr;
+                float value = std::strtof(field, &parsed);
+                if (parsed != field) out[first + i] = value;
+                const char* comma = std::strchr(field, ',');
+                if (!comma) break;
+                field = comma + 1;
+            }
+        }
+    }
+
+public:
+    FeatureSession(const std::string& path, size_t feature_dim, unsigned threads = hardwareCores())
+        : feature_dim(feature_dim) {
+        MappedFile file(path);
+        const char* data = static_cast<const char*>(file.data());
+        const char* end = data + file.size();
+        const char* header_end = static_cast<const char*>(std::memchr(data, '\n', file.size()));
+        const char* body = header_end ? header_end + 1 : end;
+
+        // Chunk boundaries moved forward to the next line start
+        threads = std::max(1u, threads);
+        std::vector<const char*> bounds{body};
+        for (unsigned t = 1; t < threads; t++) {
+            const char* cut = body + (end - body) * t / threads;
+            cut = std::max(cut, bounds.back());
+            const char* newline = static_cast<const char*>(std::memchr(cut, '\n', end - cut));
+            bounds.push_back(newline ? newline + 1 : end);
+        }
+        bounds.push_back(end);
+
+        std::vector<std::vector<float>> parts(threads);
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; t++) {
+            workers.emplace_back([&, t] { parseLines(bounds[t], bounds[t + 1], feature_dim, parts[t]); });
+        }
+        for (auto& worker : workers) worker.join();
+
+        size_t total = 0;
+        for (const auto& part : parts) total += part.size();
+        values.reserve(total);
+        for (const auto& part : parts) values.insert(values.end(), part.begin(), part.end());
+        rows = total / feature_dim;
+    }
+
+    size_t row_count() const { return rows; }
+    size_t columns() const { return feature_dim; }
+    const float* data() const { return values.data(); }
+
+    size_t window_count(size_t sequence_length) const {
+        return rows >= sequence_length ? rows - sequence_length + 1 : 0;
+    }
+
+    // Window i as a [sequence_length x feature_dim] view
+    const float* window(size_t index) const { return values.data() + index * feature_dim; }
+
+    // Windows [first, first + count) as a dense [count x sequence_length x feature_dim] batch
+    void gatherWindows(size_t first, size_t count, size_t sequence_length, float* out) const {
+        size_t window_size = sequence_length * feature_dim;
+        for (size_t i = 0; i < count; i++) {
+            std::memcpy(out + i * window_size, window(first + i), window_size * sizeof(float));
+        }
+    }
+};
+
+#endif // FEATURE_SESSION_HPP
@@ -0,0 +1,121 @@
+#ifndef INFERENCE_BACKEND_HPP
+#define INFERENCE_BACKEND_HPP
+
+// Engine-independent trajectory predictor. A backend takes a contiguous [batch, sequence_length, feature_dim]
+// float span and fills a contiguous output span, so the same driver can run TorchScript, ONNX Runtime and
+// native models on identical windows. Engine-specific backends live next to their runners
+// (tra_pred_model/torch_backend.hpp, tra_pred_model_onnx/onnx_backend.hpp).
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cvm_predictor.hpp>
+#include <trajectory_prediction.hpp>
+
+struct WindowShape {
+    size_t batch = 1;
+    size_t sequence_length = 30;
+    size_t feature_dim = 2;
+
+    size_t element_count() const { return batch * sequence_length * feature_dim; }
+    std::vector<int64_t> dims() const {
+        return {static_cast<int64_t>(batch), static_cast<int64_t>(sequence_length), static_cast<int64_t>(feature_dim)};
+    }
+};
+
+inline size_t elementCount(const std::vector<int64_t>& shape) {
+    size_t count = 1;
+    for (int64_t dim : shape) count *= static_cast<size_t>(dim);
+    return count;
+}
+
+class InferenceBackend {
+public:
+    virtual ~InferenceBackend() = default;
+
+    virtual std::string name() const = 0;
+
+    // Shape of the prediction for an input shape, [batch, horizon, 2] for the trajectory models
+    virtual std::vector<int64_t> outputShape(const WindowShape& shape) = 0;
+
+    // input: shape.element_count() floats, output: elementCount(outputShape(shape)) floats
+    virtual void infer(const float* input, const WindowShape& shape, float* output) = 0;
+
+    // infer() into buffers the backend sizes: `output` is resized to the prediction and `dims` set to its shape.
+    // The default asks outputShape() first, which costs engines without static shapes a zero run per new shape.
+    virtual void inferResized(const float* input, const WindowShape& shape, std::vector<float>& output,
+                              std::vector<int64_t>& dims) {
+        dims = outputShape(shape);
+        output.resize(elementCount(dims));
+        infer(input, shape, output.data());
+    }
+
+    // Scalar side outputs of the last infer() (the TFT's vq_loss and perplexity), false when the model has none
+    virtual bool vqOutputs(float& vq_loss, float& perplexity) const {
+        (void)vq_loss;
+        (void)perplexity;
+        return false;
+    }
+};
+
+// The runners' per-frame driver: one [1, sequence_length, feature_dim] window through a backend, decoded into a
+// TrajectoryPrediction. The output buffers are reused, so a steady window length allocates nothing per frame.
+class WindowPredictor {
+private:
+    InferenceBackend& backend;
+    WindowShape shape;
+    std::vector<int64_t> output_dims;
+    std::vector<float> output_values;
+
+public:
+    WindowPredictor(InferenceBackend& backend, size_t feature_dim) : backend(backend) {
+        shape.feature_dim = feature_dim;
+    }
+
+    void predict(const float* window, size_t sequence_length, TrajectoryPrediction& prediction) {
+        shape.sequence_length = sequence_length;
+        backend.inferResized(window, shape, output_values, output_dims);
+        decodeTrajectory(output_values.data(), output_dims, 0, prediction);
+        float vq_loss = 0.0f, perplexity = 0.0f;
+        bool has_vq = backend.vqOutputs(vq_loss, perplexity);
+        decodeVqOutputs(has_vq ? &vq_loss : nullptr, has_vq ? &perplexity : nullptr, prediction);
+    }
+
+    // The raw prediction of the last predict()
+    const float* output() const { return output_values.data(); }
+    size_t output_size() const { return output_values.size(); }
+    InferenceBackend& inference_backend() { return backend; }
+};
+
+// Constant-velocity extrapolation without a runtime, see CvmPredictor
+class CvmBackend : public InferenceBackend {
+private:
+    CvmPredictor predictor;
+
+public:
+    explicit CvmBackend(size_t horizon = 40) : predictor(horizon) {}
+
+    std::string name() const override { return "cvm-native"; }
+
+    std::vector<int64_t> outputShape(const WindowShape& shape) override {
+        return {static_cast<int64_t>(shape.batch), static_cast<int64_t>(predictor.output_horizon()),
+                static_cast<int64_t>(CvmPredictor::POSITION_DIM)};
+    }
+
+    void infer(const float* input, const WindowShape& shape, float* output) override {
+        predictor.predict(input, shape.batch, shape.sequence_length, shape.feature_dim, output);
+    }
+
+    void inferResized(const float* input, const WindowShape& shape, std::vector<float>& output,
+                      std::vector<int64_t>& dims) override {
+        dims.resize(3);
+        dims[0] = static_cast<int64_t>(shape.batch);
+        dims[1] = static_cast<int64_t>(predictor.output_horizon());
+        dims[2] = static_cast<int64_t>(CvmPredictor::POSITION_DIM);
+        output.resize(elementCount(dims));
+        infer(input, shape, output.data());
+    }
+};
+
+#endif // INFERENCE_BACKEND_HPP
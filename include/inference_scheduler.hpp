@@ -0,0 +1,136 @@
+#ifndef INFERENCE_SCHEDULER_HPP
+#define INFERENCE_SCHEDULER_HPP
+
+// FAM-gated inference scheduling. A pedestrian waiting at a station does not need a fresh trajectory every
+// frame: the scheduler picks an inference stride per pedestrian from the FAM state, the walking speed and
+// possible_interaction, and serves the frames in between from the last prediction, shifted forward by the
+// frames that have passed.
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <state_timeline.hpp>
+#include <trajectory_prediction.hpp>
+
+struct SchedulePolicy {
+    size_t active_stride = 1;       // Crossing, approaching the sidewalk, unknown state or a possible interaction
+    size_t moving_stride = 2;       // Walking along the sidewalk or towards the target station
+    size_t stationary_stride = 10;  // At Station or Wait while (nearly) not moving
+    double stationary_speed = 0.1;  // User_speed below which a pedestrian counts as stationary
+
+    size_t stride(uint8_t state_id, double user_speed, bool possible_interaction) const {
+        if (possible_interaction) return active_stride;
+        switch (state_id) {
+            case STATE_AT_STATION:
+            case STATE_WAIT:
+                return std::abs(user_speed) < stationary_speed ? stationary_stride : moving_stride;
+            case STATE_MOVE_ALONG_SIDEWALK:
+            case STATE_APPROACH_TARGET_STATION:
+                return moving_stride;
+            default:  // Cross, Approach Sidewalk, Error
+                return active_stride;
+        }
+    }
+};
+
+struct ScheduleReport {
+    size_t frames = 0;      // Frames that needed a prediction
+    size_t inferences = 0;  // Of those, frames that ran the model
+    size_t evaluated = 0;   // Served predictions compared against a model run
+    double ade_sum = 0.0;
+    double fde_sum = 0.0;
+    double max_fde = 0.0;
+
+    void print(std::ostream& out) const {
+        size_t skipped = frames - inferences;
+        out << "Inference schedule: " << inferences << " model runs for " << frames << " frames ("
+            << (frames ? 100.0 * skipped / frames : 0.0) << "% saved)";
+        if (evaluated) {
+            out << ", error of reused predictions: ADE " << ade_sum / evaluated << ", FDE " << fde_sum / evaluated
+                << ", max FDE " << max_fde << " over " << evaluated << " frames";
+        }
+        out << std::endl;
+    }
+};
+
+class InferenceScheduler {
+private:
+    struct PedestrianSchedule {
+        bool has_prediction = false;
+        size_t since_inference = 0;  // Frames since `last` was predicted
+        TrajectoryPrediction last;
+    };
+
+    SchedulePolicy policy;
+    std::unordered_map<uint32_t, PedestrianSchedule> pedestrians;
+    ScheduleReport stats;
+
+public:
+    explicit InferenceScheduler(const SchedulePolicy& policy = SchedulePolicy()) : policy(policy) {}
+
+    // Called once per frame of `pedestrian`. True: run the model and record() the result. False: serve
+    // reuse() instead. A pedestrian turning active gets a model run on that same frame.
+    bool shouldInfer(uint32_t pedestrian, uint8_t state_id, double user_speed, bool possible_interaction) {
+        PedestrianSchedule& schedule = pedestrians[pedestrian];
+        stats.frames++;
+        schedule.since_inference++;
+        bool infer = !schedule.has_prediction ||
+                     schedule.since_inference >= policy.stride(state_id, user_speed, possible_interaction);
+        if (infer) stats.inferences++;
+        return infer;
+    }
+
+    void record(const TrajectoryPrediction& prediction) {
+        PedestrianSchedule& schedule = pedestrians[prediction.pedestrian];
+        schedule.last = prediction;
+        schedule.has_prediction = true;
+        schedule.since_inference = 0;
+    }
+
+    // The last prediction advanced by the frames since it was made: step k now is its step k + elapsed,
+    // and steps past its horizon continue with its final displacement
+    void reuse(uint32_t pedestrian, TrajectoryPrediction& prediction) const {
+        const PedestrianSchedule& schedule = pedestrians.at(pedestrian);
+        const TrajectoryPrediction& last = schedule.last;
+        size_t horizon = last.horizon;
+        size_t elapsed = schedule.since_inference;
+        prediction.pedestrian = pedestrian;
+        prediction.horizon = last.horizon;
+        prediction.has_vq = last.has_vq;
+        prediction.vq_loss = last.vq_loss;
+        prediction.perplexity = last.perplexity;
+        prediction.xy.resize(horizon * 2);
+        if (horizon == 0) return;
+
+        float dx = horizon > 1 ? last.x(horizon - 1) - last.x(horizon - 2) : 0.0f;
+        float dy = horizon > 1 ? last.y(horizon - 1) - last.y(horizon - 2) : 0.0f;
+        for (size_t step = 0; step < horizon; step++) {
+            size_t source = step + elapsed;
+            if (source < horizon) {
+                prediction.xy[2 * step] = last.x(source);
+                prediction.xy[2 * step + 1] = last.y(source);
+            } else {
+                float beyond = static_cast<float>(source - (horizon - 1));
+                prediction.xy[2 * step] = last.x(horizon - 1) + dx * beyond;
+                prediction.xy[2 * step + 1] = last.y(horizon - 1) + dy * beyond;
+            }
+        }
+    }
+
+    // Score a reused prediction against the model's prediction for the same frame
+    void evaluate(const TrajectoryPrediction& served, const TrajectoryPrediction& reference) {
+        auto [ade, fde] = trajectoryError(served, reference);
+        stats.evaluated++;
+        stats.ade_sum += ade;
+        stats.fde_sum += fde;
+        stats.max_fde = std::max(stats.max_fde, fde);
+    }
+
+    void forget(uint32_t pedestrian) { pedestrians.erase(pedestrian); }
+
+    const ScheduleReport& report() const { return stats; }
+};
+
+#endif // INFERENCE_SCHEDULER_HPP
@@ -0,0 +1,61 @@
+#ifndef LATENCY_STATS_HPP
+#define LATENCY_STATS_HPP
+
+// Latency samples of a benchmark run, in microseconds, with the usual summary figures.
+
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <numeric>
+#include <ostream>
+#include <iomanip>
+
+class LatencyStats {
+private:
+    mutable std::vector<double> samples;  // Sorted lazily by the percentile queries
+    mutable bool sorted = true;
+
+    const std::vector<double>& ordered() const {
+        if (!sorted) {
+            std::sort(samples.begin(), samples.end());
+            sorted = true;
+        }
+        return samples;
+    }
+
+public:
+    void reserve(size_t n) { samples.reserve(n); }
+
+    void add(double us) {
+        samples.push_back(us);
+        sorted = false;
+    }
+
+    void merge(const LatencyStats& other) {
+        samples.insert(samples.end(), other.samples.begin(), other.samples.end());
+        sorted = false;
+    }
+
+    size_t count() const { return samples.size(); }
+    double total() const { return std::accumulate(samples.begin(), samples.end(), 0.0); }
+    double mean() const { return samples.empty() ? 0.0 : total() / samples.size(); }
+
+    // Nearest-rank percentile, p in [0, 100]
+    double percentile(double p) const {
+        const auto& values = ordered();
+        if (values.empty()) return 0.0;
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+        return values[std::min(values.size() - 1, rank == 0 ? 0 : rank - 1)];
+    }
+
+    double max() const { return samples.empty() ? 0.0 : ordered().back(); }
+
+    // "mean 12.3 us, p50 11.9 us, p95 15.0 us, p99 20.1 us, max 31.0 us"
+    void print(std::ostream& out) const {
+        out << std::fixed << std::setprecision(2) << "mean " << mean() << " us, p50 " << percentile(50) << " us, p95 "
+            << percentile(95) << " us, p99 " << percentile(99) << " us, max " << max() << " us" << std::defaultfloat;
+    }
+};
+
+#endif // LATENCY_STATS_HPP
@@ -0,0 +1,63 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+// Read-only memory map of a whole file. The mapping is shared: every process that maps the same model
+// file reads the same page-cache pages instead of holding its own copy, and nothing is read up front.
+// POSIX only; on Windows the constructor throws and callers fall back to reading the file.
+
+#include <string>
+#include <cstddef>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+class MappedFile {
+private:
+    std::string file_path;
+    void* mapping = nullptr;
+    size_t length = 0;
+
+public:
+    explicit MappedFile(const std::string& path) : file_path(path) {
+#ifdef _WIN32
+        throw std::runtime_error("Cannot map " + path + ": memory-mapped models need a POSIX system");
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || info.st_size == 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot map " + path + ": empty or unreadable");
+        }
+        length = static_cast<size_t>(info.st_size);
+        void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        int error = errno;
+        ::close(fd);  // The mapping keeps the file referenced
+        if (mapped == MAP_FAILED) throw std::runtime_error("Cannot map " + path + ": " + std::strerror(error));
+        mapping = mapped;
+        // The model is parsed front to back right after this
+        ::madvise(mapping, length, MADV_SEQUENTIAL);
+#endif
+    }
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (mapping) ::munmap(mapping, length);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const void* data() const { return mapping; }
+    size_t size() const { return length; }
+    const std::string& path() const { return file_path; }
+};
+
+#endif // MAPPED_FILE_HPP
@@ -0,0 +1,161 @@
+#ifndef MODEL_CASCADE_HPP
+#define MODEL_CASCADE_HPP
+
+// CVM-first model cascade. Every pedestrian gets the native constant-velocity prediction; a pedestrian is
+// escalated to the learned model only when constant velocity is not good enough for it right now:
+// the CVM prediction made `residual_lag` frames ago missed the observed position, the AGV is close,
+// or the walking direction is turning.
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <feature_schema.hpp>
+
+struct CascadePolicy {
+    float residual_threshold = 100.0f;  // CVM miss, in position units, `residual_lag` frames ahead
+    size_t residual_lag = 10;
+    float agv_distance = 5.0f;          // Escalate when hypot(AGV_distance_X, AGV_distance_Y) is below this
+    float heading_change_deg = 30.0f;   // Escalate when the walking direction turns more than this
+    size_t heading_span = 5;            // Frames per direction estimate
+    float min_heading_speed = 0.5f;     // Displacement per frame below which the direction is not trusted
+};
+
+enum class EscalationReason : uint8_t { None = 0, Residual, AgvClose, Heading };
+
+inline const char* escalationReasonName(EscalationReason reason) {
+    switch (reason) {
+        case EscalationReason::Residual: return "residual";
+        case EscalationReason::AgvClose: return "AGV close";
+        case EscalationReason::Heading: return "heading change";
+        default: return "none";
+    }
+}
+
+// Index of `column` in the schema, -1 when the model does not take it
+inline int schemaColumn(const FeatureSchema& schema, const std::string& column) {
+    for (size_t i = 0; i < schema.columns.size(); i++) {
+        if (schema.columns[i] == column) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+class CascadeMonitor {
+private:
+    struct PedestrianTrack {
+        std::vector<float> lagged;  // Ring of (x, y) the CVM predicted `residual_lag` frames ahead
+        size_t frames = 0;
+    };
+
+    CascadePolicy policy;
+    int x_column, y_column, agv_dx_column, agv_dy_column;
+    float cos_heading;
+    std::unordered_map<uint32_t, PedestrianTrack> tracks;
+
+    // Model input rows hold the normalized values; undo it for thresholds in feature units
+    std::vector<float> mean, scale;
+    float value(const float* row, int column) const { return row[column] / scale[column] + mean[column]; }
+
+public:
+    CascadeMonitor(const FeatureSchema& schema, const CascadePolicy& policy = CascadePolicy())
+        : policy(policy), x_column(schemaColumn(schema, "User_X")), y_column(schemaColumn(schema, "User_Y")),
+          agv_dx_column(schemaColumn(schema, "AGV_distance_X")), agv_dy_column(schemaColumn(schema, "AGV_distance_Y")),
+          cos_heading(std::cos(policy.heading_change_deg * static_cast<float>(M_PI) / 180.0f)),
+          mean(schema.mean), scale(schema.scale) {
+        if (x_column < 0 || y_column < 0) {
+            throw std::runtime_error("The cascade needs User_X and User_Y in the model input");
+        }
+        this->policy.residual_lag = std::max<size_t>(this->policy.residual_lag, 1);
+    }
+
+    // User_X / User_Y of a [sequence_length x feature_dim] window into [sequence_length x 2], for the CVM
+    void positions(const float* window, size_t sequence_length, size_t feature_dim, float* out) const {
+        for (size_t t = 0; t < sequence_length; t++) {
+            const float* row = window + t * feature_dim;
+            out[2 * t] = value(row, x_column);
+            out[2 * t + 1] = value(row, y_column);
+        }
+    }
+
+    // Decide for the newest frame of `pedestrian`. positions: its window as [sequence_length x 2],
+    // newest_row: its newest model input row, cvm: this frame's CVM prediction [horizon x 2].
+    EscalationReason update(uint32_t pedestrian, const float* positions, size_t sequence_length,
+                            const float* newest_row, const float* cvm, size_t horizon) {
+        PedestrianTrack& track = tracks[pedestrian];
+        size_t lag = policy.residual_lag;
+        if (track.lagged.empty()) track.lagged.assign(2 * lag, 0.0f);
+
+        const float* now = positions + 2 * (sequence_length - 1);
+        size_t slot = track.frames % lag;
+        float residual = 0.0f;
+        if (track.frames >= lag) {
+            residual = std::hypot(now[0] - track.lagged[2 * slot], now[1] - track.lagged[2 * slot + 1]);
+        }
+        size_t ahead = std::min(lag, horizon) - 1;
+        track.lagged[2 * slot] = cvm[2 * ahead];
+        track.lagged[2 * slot + 1] = cvm[2 * ahead + 1];
+        track.frames++;
+
+        if (residual > policy.residual_threshold) return EscalationReason::Residual;
+
+        if (agv_dx_column >= 0 && agv_dy_column >= 0 &&
+            std::hypot(value(newest_row, agv_dx_column), value(newest_row, agv_dy_column)) < policy.agv_distance) {
+            return EscalationReason::AgvClose;
+        }
+
+        size_t span = policy.heading_span;
+        if (sequence_length > 2 * span) {
+            const float* middle = now - 2 * span;
+            const float* oldest = middle - 2 * span;
+            float ax = middle[0] - oldest[0], ay = middle[1] - oldest[1];
+            float bx = now[0] - middle[0], by = now[1] - middle[1];
+            float la = std::hypot(ax, ay), lb = std::hypot(bx, by);
+            float min_length = policy.min_heading_speed * span;
+            if (la > min_length && lb > min_length && (ax * bx + ay * by) / (la * lb) < cos_heading) {
+                return EscalationReason::Heading;
+            }
+        }
+        return EscalationReason::None;
+    }
+
+    void forget(uint32_t pedestrian) { tracks.erase(pedestrian); }
+};
+
+struct CascadeReport {
+    size_t frames = 0;
+    size_t escalated = 0;
+    size_t by_reason[4] = {0, 0, 0, 0};
+    size_t model_batches = 0;
+    double cvm_seconds = 0.0;
+    double model_seconds = 0.0;
+
+    // Served CVM predictions compared against the model, when evaluating
+    size_t evaluated = 0;
+    double ade_sum = 0.0;
+    double fde_sum = 0.0;
+
+    void record(EscalationReason reason) {
+        frames++;
+        by_reason[static_cast<size_t>(reason)]++;
+        if (reason != EscalationReason::None) escalated++;
+    }
+
+    void print(std::ostream& out) const {
+        out << "Cascade: " << escalated << " of " << frames << " frames escalated ("
+            << (frames ? 100.0 * escalated / frames : 0.0) << "%; ";
+        for (size_t r = 1; r < 4; r++) {
+            out << escalationReasonName(static_cast<EscalationReason>(r)) << " " << by_reason[r] << (r < 3 ? ", " : "");
+        }
+        out << ") in " << model_batches << " model batches" << std::endl;
+        out << "Cascade time: CVM " << cvm_seconds << " s, model " << model_seconds << " s" << std::endl;
+        if (evaluated) {
+            out << "CVM frames against the model: ADE " << ade_sum / evaluated << ", FDE " << fde_sum / evaluated
+                << " over " << evaluated << " frames" << std::endl;
+        }
+    }
+};
+
+#endif // MODEL_CASCADE_HPP
@@ -0,0 +1,87 @@
+#ifndef MPMC_QUEUE_HPP
+#define MPMC_QUEUE_HPP
+
+// Bounded lock-free multi-producer multi-consumer queue (Vyukov's sequence-numbered ring).
+// Every cell carries a sequence number that tells producers and consumers whether it is free or full
+// for their lap, so push and pop are one CAS on the shared index plus a release store on the cell.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <stdexcept>
+
+template <typename T>
+class MpmcQueue {
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    static constexpr size_t CACHE_LINE = 64;
+
+    size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    alignas(CACHE_LINE) std::atomic<size_t> enqueue_pos{0};
+    alignas(CACHE_LINE) std::atomic<size_t> dequeue_pos{0};
+
+public:
+    // capacity must be a power of two
+    explicit MpmcQueue(size_t capacity) : mask(capacity - 1), cells(new Cell[capacity]) {
+        if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+            throw std::invalid_argument("MpmcQueue capacity must be a power of two");
+        }
+        for (size_t i = 0; i < capacity; i++) cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    // False when the queue is full
+    bool try_push(T value) {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // Full
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // False when the queue is empty
+    bool try_pop(T& value) {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = std::move(cell.value);
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // Empty
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t capacity() const { return mask + 1; }
+};
+
+#endif // MPMC_QUEUE_HPP
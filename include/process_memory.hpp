@@ -0,0 +1,57 @@
+#ifndef PROCESS_MEMORY_HPP
+#define PROCESS_MEMORY_HPP
+
+// Resident set size of this process. On Linux it is split into file-backed pages (a mapped model lives
+// here and is shared with other processes mapping the same file) and anonymous pages (private copies).
+// macOS only has the peak RSS from getrusage.
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <ostream>
+#include <sys/resource.h>
+
+struct ResidentMemory {
+    size_t rss_kb = 0;
+    size_t file_kb = 0;   // RssFile, Linux only
+    size_t anon_kb = 0;   // RssAnon, Linux only
+    bool peak_only = false;
+
+    void print(std::ostream& out, const std::string& label) const {
+        out << "RSS " << label << ": " << rss_kb / 1024.0 << " MB";
+        if (peak_only) {
+            out << " (peak)";
+        } else {
+            out << " (file-backed " << file_kb / 1024.0 << " MB, anonymous " << anon_kb / 1024.0 << " MB)";
+        }
+        out << std::endl;
+    }
+};
+
+inline ResidentMemory residentMemory() {
+    ResidentMemory memory;
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        std::istringstream fields(line);
+        std::string key;
+        size_t kb = 0;
+        fields >> key >> kb;
+        if (key == "VmRSS:") memory.rss_kb = kb;
+        else if (key == "RssFile:") memory.file_kb = kb;
+        else if (key == "RssAnon:") memory.anon_kb = kb;
+    }
+    if (memory.rss_kb == 0) {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+        memory.rss_kb = static_cast<size_t>(usage.ru_maxrss) / 1024;  // Bytes on macOS
+#else
+        memory.rss_kb = static_cast<size_t>(usage.ru_maxrss);
+#endif
+        memory.peak_only = true;
+    }
+    return memory;
+}
+
+#endif // PROCESS_MEMORY_HPP
@@ -0,0 +1,35 @@
+#ifndef SAMPLE_RECORD_HPP
+#define SAMPLE_RECORD_HPP
+
+// Fixed binary layout of one UE sample, shared by the binary transports (shared-memory ring, segment log,
+// socket ingest). One record is one cache line and is copied as plain bytes.
+
+#include <cstddef>
+#include <cstdint>
+
+// One sample as the UE logs it; fields are in the raw-log column order
+struct alignas(64) SampleRecord {
+    uint64_t sequence = 0;      // Set by the writer: records written before this one
+    int64_t timestamp = 0;      // TimestampID of the raw log
+    uint32_t user = 0;
+    uint32_t flags = 0;
+    float user_x = 0.0f;
+    float user_y = 0.0f;
+    float gaze_x = 0.0f;
+    float gaze_y = 0.0f;
+    float gaze_z = 0.0f;
+    float agv_x = 0.0f;
+    float agv_y = 0.0f;
+
+    static constexpr size_t FEATURE_COUNT = 7;
+    static constexpr uint32_t END_OF_STREAM = 1;  // In-band end marker for transports without a close flag
+
+    // User_X, User_Y, GazeDirection_X/Y/Z, AGV_X, AGV_Y; the first `count` of them (rest zero)
+    void features(float* out, size_t count) const {
+        const float values[FEATURE_COUNT] = {user_x, user_y, gaze_x, gaze_y, gaze_z, agv_x, agv_y};
+        for (size_t i = 0; i < count; i++) out[i] = i < FEATURE_COUNT ? values[i] : 0.0f;
+    }
+};
+static_assert(sizeof(SampleRecord) == 64, "SampleRecord is one cache line");
+
+#endif // SAMPLE_RECORD_HPP
@@ -0,0 +1,279 @@
+#ifndef SEGMENT_LOG_HPP
+#define SEGMENT_LOG_HPP
+
+// Append-only sample log in rotating segment files, replacing one log_N.csv per sample. The producer
+// appends SampleRecords to segment_<N>.bin; after `records_per_segment` records it starts segment N + 1
+// and deletes the segment `keep_segments` back, so disk use stays bounded however long the session runs.
+// The reader tails the current segment by offset with pread and follows the rotation.
+//
+// A segment starts with one SegmentHeader block (the size of a record), then the records. The reader only
+// takes whole records, so a record that is still being appended is picked up on the next read.
+//
+// Every writer stamps its segments with a new session id. A session that had already ended when the reader
+// started (its last record is the end marker) is skipped, so a reader started before the writer does not
+// replay the previous run. When a new writer replaces the session the reader is following (it removes the
+// old segments, including the one the reader holds open), the reader moves to the new session.
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <filesystem>
+#include <stdexcept>
+#include <chrono>
+#include <random>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sample_record.hpp>
+
+struct alignas(64) SegmentHeader {
+    static constexpr uint32_t MAGIC = 0x53474C47;  // "SGLG"
+    static constexpr uint32_t VERSION = 2;
+
+    uint32_t magic = MAGIC;
+    uint32_t version = VERSION;
+    uint32_t record_size = sizeof(SampleRecord);
+    uint32_t records_per_segment = 0;
+    uint64_t segment = 0;
+    uint64_t session = 0;  // Same for all segments of one writer, never 0
+};
+static_assert(sizeof(SegmentHeader) == sizeof(SampleRecord), "The segment header takes one record slot");
+
+inline std::string segmentPath(const std::string& dir, uint64_t segment) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "segment_%08llu.bin", static_cast<unsigned long long>(segment));
+    return (std::filesystem::path(dir) / name).string();
+}
+
+class SegmentLogWriter {
+private:
+    std::string dir;
+    uint32_t records_per_segment;
+    uint32_t keep_segments;
+    uint64_t segment = 0;
+    uint32_t in_segment = 0;
+    uint64_t sequence = 0;
+    uint64_t session;
+    int fd = -1;
+
+    static uint64_t newSession() {
+        uint64_t id = (static_cast<uint64_t>(std::random_device{}()) << 32) ^
+                      static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+        return id ? id : 1;
+    }
+
+    void open_segment() {
+        std::string path = segmentPath(dir, segment);
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) throw std::runtime_error("Cannot create " + path + ": " + std::strerror(errno));
+        SegmentHeader header;
+        header.records_per_segment = records_per_segment;
+        header.segment = segment;
+        header.session = session;
+        write_block(&header);
+        in_segment = 0;
+    }
+
+    void write_block(const void* block) {
+        if (::write(fd, block, sizeof(SampleRecord)) != static_cast<ssize_t>(sizeof(SampleRecord))) {
+            throw std::runtime_error("Cannot append to " + segmentPath(dir, segment) + ": " + std::strerror(errno));
+        }
+    }
+
+    void rotate() {
+        ::close(fd);
+        segment++;
+        open_segment();
+        if (segment >= keep_segments) std::filesystem::remove(segmentPath(dir, segment - keep_segments));
+    }
+
+public:
+    // Starts a fresh log in dir; segments of an earlier session there are removed
+    SegmentLogWriter(const std::string& dir, uint32_t records_per_segment = 65536, uint32_t keep_segments = 4)
+        : dir(dir), records_per_segment(std::max<uint32_t>(records_per_segment, 1)),
+          keep_segments(std::max<uint32_t>(keep_segments, 2)), session(newSession()) {
+        std::filesystem::create_directories(dir);
+        for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+            if (entry.path().filename().string().rfind("segment_", 0) == 0) std::filesystem::remove(entry.path());
+        }
+        open_segment();
+    }
+
+    ~SegmentLogWriter() {
+        if (fd >= 0) ::close(fd);
+    }
+
+    SegmentLogWriter(const SegmentLogWriter&) = delete;
+    SegmentLogWriter& operator=(const SegmentLogWriter&) = delete;
+
+    // One write() of one record
+    void append(const SampleRecord& record) {
+        if (in_segment == records_per_segment) rotate();
+        SampleRecord stamped = record;
+        stamped.sequence = sequence++;
+        write_block(&stamped);
+        in_segment++;
+    }
+
+    // Mark the end of the session for the reader
+    void close() {
+        SampleRecord end;
+        end.flags = SampleRecord::END_OF_STREAM;
+        append(end);
+    }
+
+    uint64_t current_segment() const { return segment; }
+    uint64_t session_id() const { return session; }
+};
+
+class SegmentLogReader {
+private:
+    std::string dir;
+    uint64_t segment = 0;
+    uint64_t offset = 0;  // Records read from the current segment
+    uint32_t records_per_segment = 0;
+    uint64_t session = 0;        // Session being followed, 0 until the first segment is opened
+    uint64_t ended_session = 0;  // Session that had ended before the reader started, skipped
+    int fd = -1;
+    uint64_t skipped_segments = 0;
+    uint64_t session_changes = 0;
+
+    // Header of a segment file, false while it is incomplete
+    static bool readHeader(int file, const std::string& path, SegmentHeader& header) {
+        if (::pread(file, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) return false;
+        if (header.magic != SegmentHeader::MAGIC || header.version != SegmentHeader::VERSION ||
+            header.record_size != sizeof(SampleRecord)) {
+            throw std::runtime_error(path + " is not a sample log segment");
+        }
+        return true;
+    }
+
+    // Segment indices in dir, ascending
+    std::vector<uint64_t> listSegments() const {
+        std::vector<uint64_t> indices;
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(dir, error)) {
+            unsigned long long index;
+            std::string name = entry.path().filename().string();
+            if (std::sscanf(name.c_str(), "segment_%llu.bin", &index) == 1) indices.push_back(index);
+        }
+        std::sort(indices.begin(), indices.end());
+        return indices;
+    }
+
+    // The session of the newest segment, when its last complete record is the end marker
+    uint64_t findEndedSession() const {
+        std::vector<uint64_t> indices = listSegments();
+        if (indices.empty()) return 0;
+        std::string path = segmentPath(dir, indices.back());
+        int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file < 0) return 0;
+        SegmentHeader header;
+        SampleRecord last;
+        struct stat info;
+        uint64_t ended = 0;
+        if (readHeader(file, path, header) && ::fstat(file, &info) == 0) {
+            uint64_t blocks = static_cast<uint64_t>(info.st_size) / sizeof(SampleRecord);
+            if (blocks > 1 && ::pread(file, &last, sizeof(last), static_cast<off_t>((blocks - 1) * sizeof(SampleRecord))) ==
+                                  static_cast<ssize_t>(sizeof(last)) &&
+                (last.flags & SampleRecord::END_OF_STREAM)) {
+                ended = header.session;
+            }
+        }
+        ::close(file);
+        return ended;
+    }
+
+    // Open the current segment once its header is complete; a segment of another session is not opened
+    bool open_segment() {
+        std::string path = segmentPath(dir, segment);
+        fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        SegmentHeader header;
+        if (!readHeader(fd, path, header) || header.session == ended_session ||
+            (session != 0 && header.session != session)) {
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+        session = header.session;
+        records_per_segment = header.records_per_segment;
+        offset = 0;
+        return true;
+    }
+
+    // The current segment is gone: continue at the oldest segment left of the session, or, when the writer
+    // has started a new session, at the oldest segment of that one
+    bool skip_to_oldest() {
+        for (uint64_t index : listSegments()) {
+            std::string path = segmentPath(dir, index);
+            int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (file < 0) continue;
+            SegmentHeader header;
+            bool complete = readHeader(file, path, header);
+            ::close(file);
+            if (!complete || header.session == ended_session) continue;
+            if (header.session == session) {
+                if (index <= segment) continue;
+                skipped_segments += index - segment;
+            } else if (session != 0) {
+                session = 0;  // Adopted by open_segment
+                session_changes++;
+            }
+            segment = index;
+            return open_segment();
+        }
+        return false;
+    }
+
+    // The writer removed the open segment without finishing it: it was replaced by a new session
+    bool unlinked() const {
+        struct stat info;
+        return ::fstat(fd, &info) == 0 && info.st_nlink == 0;
+    }
+
+public:
+    explicit SegmentLogReader(const std::string& dir) : dir(dir), ended_session(findEndedSession()) {}
+
+    ~SegmentLogReader() {
+        if (fd >= 0) ::close(fd);
+    }
+
+    SegmentLogReader(const SegmentLogReader&) = delete;
+    SegmentLogReader& operator=(const SegmentLogReader&) = delete;
+
+    // The next complete record, false when the writer has not appended one yet
+    bool try_read(SampleRecord& record) {
+        if (fd < 0 && !open_segment() && !skip_to_oldest()) return false;
+        if (offset == records_per_segment) {
+            // Segment complete: the next one exists once the writer has rotated
+            ::close(fd);
+            fd = -1;
+            segment++;
+            if (!open_segment()) return false;
+        }
+        off_t position = static_cast<off_t>((offset + 1) * sizeof(SampleRecord));
+        if (::pread(fd, &record, sizeof(record), position) != static_cast<ssize_t>(sizeof(record))) {
+            if (unlinked()) {
+                ::close(fd);
+                fd = -1;
+                skip_to_oldest();
+            }
+            return false;
+        }
+        offset++;
+        return true;
+    }
+
+    const std::string& directory() const { return dir; }
+    uint64_t current_segment() const { return segment; }
+    uint64_t current_session() const { return session; }
+    uint64_t skipped() const { return skipped_segments; }
+    uint64_t sessions_replaced() const { return session_changes; }
+};
+
+#endif // SEGMENT_LOG_HPP
@@ -0,0 +1,261 @@
+#ifndef SESSION_SNAPSHOT_HPP
+#define SESSION_SNAPSHOT_HPP
+
+// Compact binary snapshot of the per-pedestrian pipeline state, so a restarted component resumes
+// without re-warming: the previous raw row (speeds), the wait-time flags, the FAM state and the
+// model input window. Every section is optional; each component writes and restores its own.
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+#include <filesystem>
+#include <config.hpp>
+
+// Plain copy of Row without the setter table
+struct RowState {
+    double User_X = 0.0;
+    double User_Y = 0.0;
+    double GazeDirection_X = 0.0;
+    double GazeDirection_Y = 0.0;
+    double AGV_X = 0.0;
+    double AGV_Y = 0.0;
+    int32_t TimestampID = 0;
+
+    static RowState fromRow(const Row& row) {
+        return {row.User_X, row.User_Y, row.GazeDirection_X, row.GazeDirection_Y, row.AGV_X, row.AGV_Y, row.TimestampID};
+    }
+    Row toRow() const {
+        return Row(User_X, User_Y, GazeDirection_X, GazeDirection_Y, AGV_X, AGV_Y, TimestampID);
+    }
+};
+
+// Flags carried by generate_wait_time between frames
+struct WaitTimeState {
+    bool begin_wait_Flag = false;
+    bool AGV_passed_Flag = false;
+    uint64_t begin_wait_Timestamp = 0;
+    uint64_t frames_seen = 0;  // Frames processed before the next batch, keeps indices session-wide
+};
+
+// FAM controller state; the state objects themselves are rebuilt from their names
+struct FamSnapshot {
+    std::string current_state = "Error";
+    std::string S_prev = "Error";
+    std::vector<bool> errorFlag;
+};
+
+struct PedestrianSnapshot {
+    uint32_t pedestrian = 0;
+
+    bool has_prev_row = false;
+    RowState prev_row;
+
+    bool has_wait_time = false;
+    WaitTimeState wait_time;
+
+    bool has_fam = false;
+    FamSnapshot fam;
+
+    // Model input window, oldest row first, window_rows x window_cols floats
+    uint32_t window_rows = 0;
+    uint32_t window_cols = 0;
+    std::vector<float> window;
+
+    // Position of the component in its input (next log index, file line, ...)
+    uint64_t source_offset = 0;
+};
+
+struct SessionSnapshot {
+    std::vector<PedestrianSnapshot> pedestrians;
+
+    PedestrianSnapshot* find(uint32_t pedestrian) {
+        for (auto& snapshot : pedestrians) {
+            if (snapshot.pedestrian == pedestrian) return &snapshot;
+        }
+        return nullptr;
+    }
+};
+
+constexpr char SNAPSHOT_MAGIC[8] = {'U', 'E', 'P', 'S', 'N', 'A', 'P', '1'};
+constexpr uint32_t SNAPSHOT_VERSION = 2;
+constexpr size_t SNAPSHOT_MAX_ERROR_FLAGS = 32;  // Packed into one uint32_t
+
+namespace snapshot_io {
+    template <typename T>
+    void put(std::ostream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    inline void putString(std::ostream& out, const std::string& value) {
+        put<uint16_t>(out, static_cast<uint16_t>(value.size()));
+        out.write(value.data(), value.size());
+    }
+
+    template <typename T>
+    T get(std::istream& in) {
+        T value;
+        if (!in.read(reinterpret_cast<char*>(&value), sizeof(T))) {
+            throw std::runtime_error("Truncated session snapshot");
+        }
+        return value;
+    }
+
+    // Field by field: no struct padding in the file, and the format does not follow the struct layout
+    inline void putRow(std::ostream& out, const RowState& row) {
+        put(out, row.User_X);
+        put(out, row.User_Y);
+        put(out, row.GazeDirection_X);
+        put(out, row.GazeDirection_Y);
+        put(out, row.AGV_X);
+        put(out, row.AGV_Y);
+        put(out, row.TimestampID);
+    }
+
+    inline RowState getRow(std::istream& in) {
+        RowState row;
+        row.User_X = get<double>(in);
+        row.User_Y = get<double>(in);
+        row.GazeDirection_X = get<double>(in);
+        row.GazeDirection_Y = get<double>(in);
+        row.AGV_X = get<double>(in);
+        row.AGV_Y = get<double>(in);
+        row.TimestampID = get<int32_t>(in);
+        return row;
+    }
+
+    // Bytes left between the read position and the end of the file
+    inline uint64_t remaining(std::istream& in) {
+        std::streampos position = in.tellg();
+        in.seekg(0, std::ios::end);
+        std::streampos end = in.tellg();
+        in.seekg(position);
+        return end > position ? static_cast<uint64_t>(end - position) : 0;
+    }
+
+    inline std::string getString(std::istream& in) {
+        std::string value(get<uint16_t>(in), '\0');
+        if (!in.read(value.data(), value.size())) {
+            throw std::runtime_error("Truncated session snapshot");
+        }
+        return value;
+    }
+}
+
+// Write the snapshot next to the target and rename it into place, so readers never see a partial file
+inline void writeSessionSnapshot(const std::string& path, const SessionSnapshot& snapshot) {
+    using namespace snapshot_io;
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Cannot open snapshot file: " + tmp_path);
+        }
+        out.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        put<uint32_t>(out, SNAPSHOT_VERSION);
+        put<uint32_t>(out, static_cast<uint32_t>(snapshot.pedestrians.size()));
+
+        for (const auto& ped : snapshot.pedestrians) {
+            uint8_t sections = (ped.has_prev_row ? 1 : 0) | (ped.has_wait_time ? 2 : 0) | (ped.has_fam ? 4 : 0);
+            put(out, ped.pedestrian);
+            put(out, sections);
+            put(out, ped.source_offset);
+            if (ped.has_prev_row) putRow(out, ped.prev_row);
+            if (ped.has_wait_time) {
+                put<uint8_t>(out, ped.wait_time.begin_wait_Flag);
+                put<uint8_t>(out, ped.wait_time.AGV_passed_Flag);
+                put(out, ped.wait_time.begin_wait_Timestamp);
+                put(out, ped.wait_time.frames_seen);
+            }
+            if (ped.has_fam) {
+                putString(out, ped.fam.current_state);
+                putString(out, ped.fam.S_prev);
+                if (ped.fam.errorFlag.size() > SNAPSHOT_MAX_ERROR_FLAGS) {
+                    throw std::runtime_error("Cannot snapshot " + std::to_string(ped.fam.errorFlag.size()) +
+                                             " FAM error flags, at most " + std::to_string(SNAPSHOT_MAX_ERROR_FLAGS));
+                }
+                uint32_t flags = 0;
+                for (size_t i = 0; i < ped.fam.errorFlag.size(); i++) {
+                    flags |= static_cast<uint32_t>(ped.fam.errorFlag[i]) << i;
+                }
+                put<uint8_t>(out, static_cast<uint8_t>(ped.fam.errorFlag.size()));
+                put(out, flags);
+            }
+            put(out, ped.window_rows);
+            put(out, ped.window_cols);
+            out.write(reinterpret_cast<const char*>(ped.window.data()), ped.window.size() * sizeof(float));
+        }
+        if (!out) {
+            throw std::runtime_error("Failed writing snapshot file: " + tmp_path);
+        }
+    }
+    std::filesystem::rename(tmp_path, path);
+}
+
+inline SessionSnapshot readSessionSnapshot(const std::string& path) {
+    using namespace snapshot_io;
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open snapshot file: " + path);
+    }
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0) {
+        throw std::runtime_error("Not a session snapshot: " + path);
+    }
+    if (get<uint32_t>(in) != SNAPSHOT_VERSION) {
+        throw std::runtime_error("Unsupported session snapshot version: " + path);
+    }
+
+    // Counts come from the file: bound them by what is left of it before allocating, so a corrupt
+    // snapshot fails instead of allocating gigabytes
+    constexpr uint64_t MIN_PEDESTRIAN_BYTES = sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint64_t) + 2 * sizeof(uint32_t);
+    SessionSnapshot snapshot;
+    uint32_t count = get<uint32_t>(in);
+    if (count > remaining(in) / MIN_PEDESTRIAN_BYTES) {
+        throw std::runtime_error("Corrupt session snapshot (" + std::to_string(count) + " pedestrians): " + path);
+    }
+    snapshot.pedestrians.resize(count);
+    for (auto& ped : snapshot.pedestrians) {
+        ped.pedestrian = get<uint32_t>(in);
+        uint8_t sections = get<uint8_t>(in);
+        ped.source_offset = get<uint64_t>(in);
+        ped.has_prev_row = sections & 1;
+        ped.has_wait_time = sections & 2;
+        ped.has_fam = sections & 4;
+        if (ped.has_prev_row) ped.prev_row = getRow(in);
+        if (ped.has_wait_time) {
+            ped.wait_time.begin_wait_Flag = get<uint8_t>(in);
+            ped.wait_time.AGV_passed_Flag = get<uint8_t>(in);
+            ped.wait_time.begin_wait_Timestamp = get<uint64_t>(in);
+            ped.wait_time.frames_seen = get<uint64_t>(in);
+        }
+        if (ped.has_fam) {
+            ped.fam.current_state = getString(in);
+            ped.fam.S_prev = getString(in);
+            uint8_t num_flags = get<uint8_t>(in);
+            uint32_t flags = get<uint32_t>(in);
+            if (num_flags > SNAPSHOT_MAX_ERROR_FLAGS) {
+                throw std::runtime_error("Corrupt session snapshot (" + std::to_string(num_flags) + " FAM error flags): " + path);
+            }
+            ped.fam.errorFlag.resize(num_flags);
+            for (size_t i = 0; i < num_flags; i++) ped.fam.errorFlag[i] = (flags >> i) & 1;
+        }
+        ped.window_rows = get<uint32_t>(in);
+        ped.window_cols = get<uint32_t>(in);
+        uint64_t window_bytes = static_cast<uint64_t>(ped.window_rows) * ped.window_cols * sizeof(float);
+        if (window_bytes > remaining(in)) {
+            throw std::runtime_error("Corrupt session snapshot (" + std::to_string(ped.window_rows) + " x " +
+                                     std::to_string(ped.window_cols) + " window): " + path);
+        }
+        ped.window.resize(static_cast<size_t>(ped.window_rows) * ped.window_cols);
+        if (!in.read(reinterpret_cast<char*>(ped.window.data()), ped.window.size() * sizeof(float))) {
+            throw std::runtime_error("Truncated session snapshot");
+        }
+    }
+    return snapshot;
+}
+
+#endif // SESSION_SNAPSHOT_HPP
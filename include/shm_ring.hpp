@@ -0,0 +1,268 @@
+#ifndef SHM_RING_HPP
+#define SHM_RING_HPP
+
+// Single-producer / single-consumer ring of fixed-size sample records in POSIX shared memory, the binary
+// transport between the UE-side producer and a predictor process. A sample costs the producer one
+// 64-byte record write plus a release store of the head index; the consumer reads it in place.
+//
+// Layout of the shared object: ShmRingHeader, then `capacity` SampleRecords. head counts records written
+// and is only stored by the producer; tail counts records read and is only stored by the consumer. Each
+// sits on its own cache line so the two sides do not false-share.
+//
+// Each writer stamps its ring with a fresh generation and unlinks the name when it closes, so a reader never
+// attaches to a finished run's ring, and a reader left on a ring whose producer died notices when a new
+// producer replaces it.
+
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <thread>
+#include <stdexcept>
+#include <random>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sample_record.hpp>
+
+struct ShmRingHeader {
+    static constexpr uint32_t MAGIC = 0x53524E47;  // "SRNG"
+    static constexpr uint32_t VERSION = 2;
+
+    std::atomic<uint32_t> magic;  // Stored last by the producer: the header is ready
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t capacity;            // Power of two
+    std::atomic<uint32_t> closed; // Set by the producer after its last record
+    uint64_t generation;          // Differs for every ring created under the same name
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "The ring needs lock-free 64-bit atomics across processes");
+
+// The mapped shared object, common to both ends
+class ShmRing {
+protected:
+    std::string shm_name;
+    void* mapping = nullptr;
+    size_t length = 0;
+    ShmRingHeader* header = nullptr;
+    SampleRecord* records = nullptr;
+    uint64_t mask = 0;
+
+    static std::string objectName(const std::string& name) {
+        return name.empty() || name[0] == '/' ? name : "/" + name;
+    }
+
+    static size_t mappedSize(uint32_t capacity) {
+        return sizeof(SampleRecord) * ((sizeof(ShmRingHeader) + sizeof(SampleRecord) - 1) / sizeof(SampleRecord)) +
+               sizeof(SampleRecord) * capacity;
+    }
+
+    void map(int fd, size_t size) {
+        length = size;
+        mapping = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        int error = errno;
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            mapping = nullptr;
+            throw std::runtime_error("Cannot map shared memory " + shm_name + ": " + std::strerror(error));
+        }
+        header = static_cast<ShmRingHeader*>(mapping);
+        records = reinterpret_cast<SampleRecord*>(static_cast<char*>(mapping) + mappedSize(0));
+    }
+
+    void unmap() {
+        if (mapping) ::munmap(mapping, length);
+        mapping = nullptr;
+        header = nullptr;
+        records = nullptr;
+    }
+
+    explicit ShmRing(const std::string& name) : shm_name(objectName(name)) {}
+
+public:
+    ~ShmRing() { unmap(); }
+
+    ShmRing(const ShmRing&) = delete;
+    ShmRing& operator=(const ShmRing&) = delete;
+
+    const std::string& name() const { return shm_name; }
+    size_t capacity() const { return header->capacity; }
+
+    // Remove the shared object name; processes that have it mapped keep their mapping
+    static void remove(const std::string& name) {
+        ::shm_unlink(objectName(name).c_str());
+    }
+};
+
+class ShmRingWriter : public ShmRing {
+private:
+    uint64_t head = 0;         // Local copy, the producer is the only writer
+    uint64_t cached_tail = 0;  // Last tail seen; refreshed only when the ring looks full
+    uint64_t sequence = 0;
+    bool closed = false;
+
+public:
+    // Create (or recreate) the ring; capacity is rounded up to a power of two
+    ShmRingWriter(const std::string& name, uint32_t capacity) : ShmRing(name) {
+        uint32_t rounded = 1;
+        while (rounded < capacity) rounded <<= 1;
+        ShmRing::remove(shm_name);  // A ring left by a producer that died would have old indices
+        int fd = ::shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) throw std::runtime_error("Cannot create shared memory " + shm_name + ": " + std::strerror(errno));
+        size_t size = mappedSize(rounded);
+        if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            int error = errno;
+            ::close(fd);
+            throw std::runtime_error("Cannot size shared memory " + shm_name + ": " + std::strerror(error));
+        }
+        map(fd, size);
+        header->record_size = sizeof(SampleRecord);
+        header->capacity = rounded;
+        header->closed.store(0, std::memory_order_relaxed);
+        header->head.store(0, std::memory_order_relaxed);
+        header->tail.store(0, std::memory_order_relaxed);
+        header->generation = (static_cast<uint64_t>(::getpid()) << 32) ^ std::random_device{}() ^
+                             static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+        header->version = ShmRingHeader::VERSION;
+        header->magic.store(ShmRingHeader::MAGIC, std::memory_order_release);
+        mask = rounded - 1;
+    }
+
+    // False when the consumer is a full ring behind; the record is not written
+    bool try_push(const SampleRecord& record) {
+        if (head - cached_tail >= header->capacity) {
+            cached_tail = header->tail.load(std::memory_order_acquire);
+            if (head - cached_tail >= header->capacity) return false;
+        }
+        SampleRecord& slot = records[head & mask];
+        slot = record;
+        slot.sequence = sequence++;
+        header->head.store(++head, std::memory_order_release);
+        return true;
+    }
+
+    // Wait for room instead of dropping
+    void push(const SampleRecord& record) {
+        while (!try_push(record)) std::this_thread::yield();
+    }
+
+    // A writer destroyed without close() (e.g. by an exception) still ends the stream
+    ~ShmRingWriter() { close(); }
+
+    // Tell the consumer no more records follow and unlink the name; the attached reader keeps its mapping
+    void close() {
+        if (closed) return;
+        closed = true;
+        header->closed.store(1, std::memory_order_release);
+        ShmRing::remove(shm_name);
+    }
+};
+
+class ShmRingReader : public ShmRing {
+private:
+    uint64_t tail = 0;
+    uint64_t cached_head = 0;  // Last head seen; refreshed only when the ring looks empty
+    uint64_t generation = 0;   // Of the ring this reader is attached to
+
+    // Map the ring currently under the name; false when there is none yet, or it is a closed one
+    bool attach(std::chrono::steady_clock::time_point deadline) {
+        int fd = ::shm_open(shm_name.c_str(), O_RDWR, 0600);
+        if (fd < 0) return false;
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < mappedSize(1)) {
+            ::close(fd);
+            return false;
+        }
+        map(fd, static_cast<size_t>(info.st_size));
+        while (header->magic.load(std::memory_order_acquire) != ShmRingHeader::MAGIC) {
+            if (std::chrono::steady_clock::now() > deadline) throw std::runtime_error(shm_name + " is not a sample ring");
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (header->version != ShmRingHeader::VERSION || header->record_size != sizeof(SampleRecord)) {
+            throw std::runtime_error(shm_name + " has an incompatible record layout");
+        }
+        if (header->closed.load(std::memory_order_acquire) != 0) {
+            unmap();
+            return false;
+        }
+        return true;
+    }
+
+public:
+    // Attach to a ring created by a ShmRingWriter, waiting up to `timeout` for the producer to create it.
+    // A ring that is already closed is a finished run whose name was not unlinked; it is skipped.
+    ShmRingReader(const std::string& name, std::chrono::milliseconds timeout = std::chrono::seconds(10)) : ShmRing(name) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!attach(deadline)) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                throw std::runtime_error("No shared memory ring " + shm_name + " from a producer");
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        mask = header->capacity - 1;
+        generation = header->generation;
+        tail = header->tail.load(std::memory_order_relaxed);
+        cached_head = header->head.load(std::memory_order_acquire);
+    }
+
+    bool try_pop(SampleRecord& record) {
+        if (tail == cached_head) {
+            cached_head = header->head.load(std::memory_order_acquire);
+            if (tail == cached_head) return false;
+        }
+        record = records[tail & mask];
+        header->tail.store(++tail, std::memory_order_release);
+        return true;
+    }
+
+    // Records written but not read yet
+    size_t pending() const { return header->head.load(std::memory_order_acquire) - tail; }
+
+    // The producer closed the ring and every record has been read
+    bool finished() const { return header->closed.load(std::memory_order_acquire) != 0 && pending() == 0; }
+
+    // A newer producer created another ring under the name, so this one will never be written again
+    bool replaced() const {
+        int fd = ::shm_open(shm_name.c_str(), O_RDONLY, 0);
+        if (fd < 0) return false;  // Unlinked: the producer closed, or is recreating it
+        struct stat info;
+        bool differs = false;
+        if (::fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(ShmRingHeader)) {
+            void* view = ::mmap(nullptr, sizeof(ShmRingHeader), PROT_READ, MAP_SHARED, fd, 0);
+            if (view != MAP_FAILED) {
+                const ShmRingHeader* other = static_cast<const ShmRingHeader*>(view);
+                differs = other->magic.load(std::memory_order_acquire) == ShmRingHeader::MAGIC &&
+                          other->generation != generation;
+                ::munmap(view, sizeof(ShmRingHeader));
+            }
+        }
+        ::close(fd);
+        return differs;
+    }
+
+    // Spin briefly, then back off with growing sleeps (up to max_sleep). False once finished() or `stop` is set,
+    // or when the ring has been replaced() (checked every 256 sleeps once the reader has backed off to max_sleep).
+    bool pop(SampleRecord& record, const std::atomic<bool>& stop,
+             std::chrono::microseconds max_sleep = std::chrono::microseconds(500)) {
+        std::chrono::microseconds sleep(1);
+        for (size_t spins = 0; !stop; spins++) {
+            if (try_pop(record)) return true;
+            if (finished()) return false;
+            if (spins < 1000) continue;
+            if (sleep == max_sleep && (spins & 255) == 0 && replaced()) return false;
+            std::this_thread::sleep_for(sleep);
+            sleep = std::min(sleep * 2, max_sleep);
+        }
+        return false;
+    }
+
+    uint64_t ring_generation() const { return generation; }
+};
+
+#endif // SHM_RING_HPP
@@ -0,0 +1,78 @@
+#ifndef SLIDING_WINDOW_HPP
+#define SLIDING_WINDOW_HPP
+
+// Fixed-size window of the latest `rows` feature rows, stored as a mirrored ring buffer.
+// The backing store holds every row twice (slot i and slot i + rows), so the current window is always
+// one contiguous [rows x cols] span that can be handed to a tensor without copying or allocating.
+
+#include <vector>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+
+class SlidingWindow {
+private:
+    size_t num_rows;
+    size_t num_cols;
+    std::vector<float> storage;  // 2 * num_rows * num_cols
+    size_t head = 0;             // Slot receiving the next row
+    size_t count = 0;            // Rows currently in the window
+
+public:
+    SlidingWindow(size_t rows, size_t cols)
+        : num_rows(rows), num_cols(cols), storage(2 * rows * cols, 0.0f) {}
+
+    // Slot for the next row. Fill num_cols values, then call commit_row().
+    float* next_row() {
+        return storage.data() + head * num_cols;
+    }
+
+    // Mirror the row written through next_row() and advance the window
+    void commit_row() {
+        float* row = storage.data() + head * num_cols;
+        std::memcpy(row + num_rows * num_cols, row, num_cols * sizeof(float));
+        head = (head + 1) % num_rows;
+        count = std::min(count + 1, num_rows);
+    }
+
+    void push(const float* row) {
+        std::memcpy(next_row(), row, num_cols * sizeof(float));
+        commit_row();
+    }
+
+    void push(const std::vector<float>& row) {
+        float* slot = next_row();
+        size_t n = std::min(row.size(), num_cols);
+        std::memcpy(slot, row.data(), n * sizeof(float));
+        std::fill(slot + n, slot + num_cols, 0.0f);
+        commit_row();
+    }
+
+    // Oldest row first, size() * cols() contiguous floats
+    float* data() {
+        return storage.data() + (count == num_rows ? head : 0) * num_cols;
+    }
+
+    const float* data() const {
+        return storage.data() + (count == num_rows ? head : 0) * num_cols;
+    }
+
+    // Row i of the window, 0 being the oldest
+    const float* row(size_t i) const {
+        return data() + i * num_cols;
+    }
+
+    void clear() {
+        head = 0;
+        count = 0;
+    }
+
+    size_t size() const { return count; }
+    size_t rows() const { return num_rows; }
+    size_t cols() const { return num_cols; }
+    size_t element_count() const { return count * num_cols; }
+    bool full() const { return count == num_rows; }
+    bool empty() const { return count == 0; }
+};
+
+#endif // SLIDING_WINDOW_HPP
@@ -0,0 +1,204 @@
+#ifndef SOCKET_INGEST_HPP
+#define SOCKET_INGEST_HPP
+
+// Datagram ingest of SampleRecords from the simulator or tracker, without the log directory. Endpoints:
+// "udp:<port>" (localhost), "udp:<host>:<port>" or "unix:<path>" (Unix domain datagram socket). A datagram
+// carries one or more whole 64-byte records. On Linux up to RECEIVE_BATCH datagrams are taken per
+// recvmmsg call; elsewhere the same batch is collected with non-blocking recv calls.
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <sample_record.hpp>
+
+// A parsed endpoint, bound by the receiver and connected to by the sender
+struct SocketEndpoint {
+    bool unix_socket = false;
+    std::string path;  // unix:
+    std::string host = "127.0.0.1";
+    std::string port;
+
+    static SocketEndpoint parse(const std::string& spec) {
+        SocketEndpoint endpoint;
+        if (spec.rfind("unix:", 0) == 0) {
+            endpoint.unix_socket = true;
+            endpoint.path = spec.substr(5);
+            if (endpoint.path.empty() || endpoint.path.size() >= sizeof(sockaddr_un::sun_path)) {
+                throw std::runtime_error("Bad Unix socket path in " + spec);
+            }
+            return endpoint;
+        }
+        if (spec.rfind("udp:", 0) != 0) throw std::runtime_error("Endpoint must be udp:[host:]port or unix:path: " + spec);
+        std::string address = spec.substr(4);
+        size_t colon = address.rfind(':');
+        if (colon != std::string::npos) {
+            endpoint.host = address.substr(0, colon);
+            address = address.substr(colon + 1);
+        }
+        endpoint.port = address;
+        return endpoint;
+    }
+
+    // A datagram socket with `address` set to the endpoint
+    int open(sockaddr_storage& address, socklen_t& length) const {
+        std::memset(&address, 0, sizeof(address));
+        if (unix_socket) {
+            sockaddr_un* un = reinterpret_cast<sockaddr_un*>(&address);
+            un->sun_family = AF_UNIX;
+            std::strncpy(un->sun_path, path.c_str(), sizeof(un->sun_path) - 1);
+            length = sizeof(sockaddr_un);
+            return ::socket(AF_UNIX, SOCK_DGRAM, 0);
+        }
+        addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_DGRAM;
+        addrinfo* found = nullptr;
+        if (::getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0 || !found) {
+            throw std::runtime_error("Cannot resolve " + host + ":" + port);
+        }
+        std::memcpy(&address, found->ai_addr, found->ai_addrlen);
+        length = found->ai_addrlen;
+        int fd = ::socket(found->ai_family, SOCK_DGRAM, 0);
+        ::freeaddrinfo(found);
+        return fd;
+    }
+};
+
+class SocketIngest {
+public:
+    static constexpr size_t RECEIVE_BATCH = 64;        // Datagrams per receive call
+    static constexpr size_t RECORDS_PER_DATAGRAM = 16;
+
+    struct Stats {
+        size_t receives = 0;   // Calls that returned data
+        size_t datagrams = 0;
+        size_t records = 0;
+        size_t malformed = 0;  // Truncated or not a whole number of records, dropped
+    };
+
+private:
+    SocketEndpoint endpoint;
+    int fd = -1;
+    std::vector<SampleRecord> slots;  // RECEIVE_BATCH datagram buffers of RECORDS_PER_DATAGRAM records
+    Stats stats;
+
+    void take(size_t datagram, size_t bytes, bool truncated, std::vector<SampleRecord>& out) {
+        stats.datagrams++;
+        if (truncated || bytes == 0 || bytes % sizeof(SampleRecord) != 0) {
+            stats.malformed++;
+            return;
+        }
+        const SampleRecord* records = slots.data() + datagram * RECORDS_PER_DATAGRAM;
+        size_t count = bytes / sizeof(SampleRecord);
+        out.insert(out.end(), records, records + count);
+        stats.records += count;
+    }
+
+public:
+    explicit SocketIngest(const std::string& spec, std::chrono::milliseconds receive_timeout = std::chrono::milliseconds(100))
+        : endpoint(SocketEndpoint::parse(spec)), slots(RECEIVE_BATCH * RECORDS_PER_DATAGRAM) {
+        sockaddr_storage address;
+        socklen_t length = 0;
+        fd = endpoint.open(address, length);
+        if (fd < 0) throw std::runtime_error("Cannot create a socket for " + spec + ": " + std::strerror(errno));
+        if (endpoint.unix_socket) ::unlink(endpoint.path.c_str());  // Left over from an earlier run
+        int buffer = 4 << 20;  // Room for bursts while a batch is being predicted
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+        timeval timeout{static_cast<time_t>(receive_timeout.count() / 1000),
+                        static_cast<suseconds_t>((receive_timeout.count() % 1000) * 1000)};
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&address), length) != 0) {
+            int error = errno;
+            ::close(fd);
+            throw std::runtime_error("Cannot bind " + spec + ": " + std::strerror(error));
+        }
+    }
+
+    ~SocketIngest() {
+        if (fd >= 0) ::close(fd);
+        if (endpoint.unix_socket) ::unlink(endpoint.path.c_str());
+    }
+
+    SocketIngest(const SocketIngest&) = delete;
+    SocketIngest& operator=(const SocketIngest&) = delete;
+
+    // Wait up to the receive timeout for datagrams and append the records of up to RECEIVE_BATCH of them
+    // to `out`. Returns the number of records added, 0 after a timeout.
+    size_t receive(std::vector<SampleRecord>& out) {
+        size_t before = out.size();
+        const size_t datagram_bytes = RECORDS_PER_DATAGRAM * sizeof(SampleRecord);
+#ifdef __linux__
+        mmsghdr messages[RECEIVE_BATCH];
+        iovec buffers[RECEIVE_BATCH];
+        std::memset(messages, 0, sizeof(messages));
+        for (size_t i = 0; i < RECEIVE_BATCH; i++) {
+            buffers[i].iov_base = slots.data() + i * RECORDS_PER_DATAGRAM;
+            buffers[i].iov_len = datagram_bytes;
+            messages[i].msg_hdr.msg_iov = &buffers[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        // Blocks for the first datagram only, then takes whatever else is queued
+        int received = ::recvmmsg(fd, messages, RECEIVE_BATCH, MSG_WAITFORONE, nullptr);
+        if (received <= 0) return 0;
+        for (int i = 0; i < received; i++) {
+            take(i, messages[i].msg_len, messages[i].msg_hdr.msg_flags & MSG_TRUNC, out);
+        }
+#else
+        for (size_t i = 0; i < RECEIVE_BATCH; i++) {
+            ssize_t bytes = ::recv(fd, slots.data() + i * RECORDS_PER_DATAGRAM, datagram_bytes, i == 0 ? 0 : MSG_DONTWAIT);
+            if (bytes < 0) break;
+            take(i, static_cast<size_t>(bytes), false, out);
+        }
+#endif
+        if (out.size() > before) stats.receives++;
+        return out.size() - before;
+    }
+
+    const Stats& statistics() const { return stats; }
+};
+
+// Stand-in for the simulator side: sends records to a SocketIngest endpoint
+class SocketSender {
+private:
+    int fd = -1;
+
+public:
+    explicit SocketSender(const std::string& spec) {
+        SocketEndpoint endpoint = SocketEndpoint::parse(spec);
+        sockaddr_storage address;
+        socklen_t length = 0;
+        fd = endpoint.open(address, length);
+        if (fd < 0) throw std::runtime_error("Cannot create a socket for " + spec + ": " + std::strerror(errno));
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&address), length) != 0) {
+            int error = errno;
+            ::close(fd);
+            throw std::runtime_error("Cannot connect to " + spec + ": " + std::strerror(error));
+        }
+    }
+
+    ~SocketSender() {
+        if (fd >= 0) ::close(fd);
+    }
+
+    SocketSender(const SocketSender&) = delete;
+    SocketSender& operator=(const SocketSender&) = delete;
+
+    // One datagram of `count` records (at most SocketIngest::RECORDS_PER_DATAGRAM). False if it was not sent,
+    // e.g. no receiver on a Unix socket.
+    bool send(const SampleRecord* records, size_t count = 1) {
+        size_t bytes = count * sizeof(SampleRecord);
+        return ::send(fd, records, bytes, 0) == static_cast<ssize_t>(bytes);
+    }
+};
+
+#endif // SOCKET_INGEST_HPP
@@ -0,0 +1,269 @@
+#ifndef STATE_TIMELINE_HPP
+#define STATE_TIMELINE_HPP
+
+// Run-length encoded FAM state output. Instead of one state string per frame, a timeline holds one
+// (pedestrian, state_id, start_ts, end_ts) interval per dwell, emitted only when the state changes.
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+// Compact ids for the FAM state names
+enum FamStateId : uint8_t {
+    STATE_ERROR = 0,
+    STATE_AT_STATION = 1,
+    STATE_WAIT = 2,
+    STATE_CROSS = 3,
+    STATE_APPROACH_SIDEWALK = 4,
+    STATE_MOVE_ALONG_SIDEWALK = 5,
+    STATE_APPROACH_TARGET_STATION = 6,
+    STATE_UNKNOWN = 255
+};
+
+inline const std::vector<std::string>& famStateNames() {
+    static const std::vector<std::string> names = {
+        "Error", "At Station", "Wait", "Cross", "Approach Sidewalk", "Move Along Sidewalk", "Approach Target Station"
+    };
+    return names;
+}
+
+inline uint8_t stateIdFromName(const std::string& name) {
+    const auto& names = famStateNames();
+    auto it = std::find(names.begin(), names.end(), name);
+    return it == names.end() ? static_cast<uint8_t>(STATE_UNKNOWN) : static_cast<uint8_t>(it - names.begin());
+}
+
+inline std::string stateNameFromId(uint8_t id) {
+    const auto& names = famStateNames();
+    return id < names.size() ? names[id] : "Unknown";
+}
+
+// One dwell of a pedestrian in a state, both timestamps inclusive
+struct StateInterval {
+    uint32_t pedestrian;
+    uint8_t state_id;
+    int64_t start_ts;
+    int64_t end_ts;
+};
+
+enum class TimelineFormat { CSV, Binary };
+
+// Binary layout: 16-byte header ("FAMTLINE", uint32 version, uint32 record size), then fixed 24-byte records
+constexpr char TIMELINE_MAGIC[8] = {'F', 'A', 'M', 'T', 'L', 'I', 'N', 'E'};
+constexpr uint32_t TIMELINE_VERSION = 1;
+
+#pragma pack(push, 1)
+struct StateIntervalRecord {
+    uint32_t pedestrian;
+    uint8_t state_id;
+    uint8_t reserved[3];
+    int64_t start_ts;
+    int64_t end_ts;
+};
+#pragma pack(pop)
+static_assert(sizeof(StateIntervalRecord) == 24, "StateIntervalRecord must stay 24 bytes");
+
+inline TimelineFormat parseTimelineFormat(const std::string& name) {
+    if (name == "csv") return TimelineFormat::CSV;
+    if (name == "binary" || name == "bin") return TimelineFormat::Binary;
+    throw std::runtime_error("Unknown timeline format: " + name);
+}
+
+// Collapses per-frame states into intervals and writes each interval once it is closed
+class StateTimelineWriter {
+private:
+    std::ofstream out;
+    TimelineFormat format;
+    std::unordered_map<uint32_t, StateInterval> open_intervals;  // Current dwell of every pedestrian
+    size_t frames = 0;
+    size_t intervals = 0;
+
+    void write(const StateInterval& interval) {
+        if (format == TimelineFormat::CSV) {
+            out << interval.pedestrian << ',' << stateNameFromId(interval.state_id) << ','
+                << interval.start_ts << ',' << interval.end_ts << '\n';
+        } else {
+            StateIntervalRecord record{};
+            record.pedestrian = interval.pedestrian;
+            record.state_id = interval.state_id;
+            record.start_ts = interval.start_ts;
+            record.end_ts = interval.end_ts;
+            out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        }
+        intervals++;
+    }
+
+public:
+    StateTimelineWriter(const std::string& path, TimelineFormat format = TimelineFormat::CSV)
+        : out(path, format == TimelineFormat::Binary ? std::ios::binary : std::ios::out), format(format) {
+        if (!out) {
+            throw std::runtime_error("Cannot open timeline file: " + path);
+        }
+        if (format == TimelineFormat::CSV) {
+            out << "pedestrian,state,start_ts,end_ts\n";
+        } else {
+            uint32_t header[2] = {TIMELINE_VERSION, sizeof(StateIntervalRecord)};
+            out.write(TIMELINE_MAGIC, sizeof(TIMELINE_MAGIC));
+            out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        }
+    }
+
+    ~StateTimelineWriter() { finish(); }
+
+    // Record the state of a pedestrian at a frame; timestamps must not decrease per pedestrian
+    void record(uint32_t pedestrian, uint8_t state_id, int64_t ts) {
+        frames++;
+        auto it = open_intervals.find(pedestrian);
+        if (it == open_intervals.end()) {
+            open_intervals.emplace(pedestrian, StateInterval{pedestrian, state_id, ts, ts});
+            return;
+        }
+        StateInterval& current = it->second;
+        if (current.state_id == state_id) {
+            current.end_ts = ts;
+            return;
+        }
+        write(current);
+        current = StateInterval{pedestrian, state_id, ts, ts};
+    }
+
+    void record(uint32_t pedestrian, const std::string& state, int64_t ts) {
+        record(pedestrian, stateIdFromName(state), ts);
+    }
+
+    // Close the dwell of a pedestrian that left the scene
+    void close(uint32_t pedestrian) {
+        auto it = open_intervals.find(pedestrian);
+        if (it == open_intervals.end()) return;
+        write(it->second);
+        open_intervals.erase(it);
+    }
+
+    // Close every open dwell and flush the file
+    void finish() {
+        std::vector<uint32_t> pedestrians;
+        for (const auto& [pedestrian, interval] : open_intervals) pedestrians.push_back(pedestrian);
+        std::sort(pedestrians.begin(), pedestrians.end());
+        for (uint32_t pedestrian : pedestrians) close(pedestrian);
+        out.flush();
+    }
+
+    size_t framesRecorded() const { return frames; }
+    size_t intervalsWritten() const { return intervals; }
+};
+
+// Read a timeline written by StateTimelineWriter, detecting the format from the header
+inline std::vector<StateInterval> readStateTimeline(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open timeline file: " + path);
+    }
+    std::vector<StateInterval> intervals;
+
+    char magic[sizeof(TIMELINE_MAGIC)] = {};
+    in.read(magic, sizeof(magic));
+    if (in.gcount() == sizeof(magic) && std::memcmp(magic, TIMELINE_MAGIC, sizeof(magic)) == 0) {
+        uint32_t header[2];
+        if (!in.read(reinterpret_cast<char*>(header), sizeof(header))) {
+            throw std::runtime_error("Truncated timeline header in " + path);
+        }
+        if (header[0] != TIMELINE_VERSION || header[1] != sizeof(StateIntervalRecord)) {
+            throw std::runtime_error("Unsupported timeline version in " + path);
+        }
+        StateIntervalRecord record;
+        while (in.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+            intervals.push_back({record.pedestrian, record.state_id, record.start_ts, record.end_ts});
+        }
+        return intervals;
+    }
+
+    in.clear();
+    in.seekg(0);
+    std::string line;
+    std::getline(in, line);  // Header
+    while (std::getline(in, line)) {
+        std::stringstream ss(line);
+        std::string pedestrian, state, start_ts, end_ts;
+        std::getline(ss, pedestrian, ',');
+        std::getline(ss, state, ',');
+        std::getline(ss, start_ts, ',');
+        std::getline(ss, end_ts, ',');
+        intervals.push_back({static_cast<uint32_t>(std::stoul(pedestrian)), stateIdFromName(state),
+                             std::stoll(start_ts), std::stoll(end_ts)});
+    }
+    return intervals;
+}
+
+// Interval index for range queries. Intervals of one pedestrian never overlap, so sorting them by
+// start also sorts them by end and a query is two binary searches.
+class StateIntervalIndex {
+private:
+    std::unordered_map<uint32_t, std::vector<StateInterval>> by_pedestrian;
+
+public:
+    StateIntervalIndex() = default;
+    explicit StateIntervalIndex(const std::vector<StateInterval>& intervals) {
+        for (const auto& interval : intervals) add(interval);
+        for (auto& [pedestrian, list] : by_pedestrian) {
+            std::sort(list.begin(), list.end(), [](const StateInterval& a, const StateInterval& b) {
+                return a.start_ts < b.start_ts;
+            });
+        }
+    }
+
+    // Append an interval that starts after every indexed interval of the same pedestrian
+    void add(const StateInterval& interval) {
+        by_pedestrian[interval.pedestrian].push_back(interval);
+    }
+
+    // Intervals of a pedestrian overlapping [from_ts, to_ts]
+    std::vector<StateInterval> query(uint32_t pedestrian, int64_t from_ts, int64_t to_ts) const {
+        std::vector<StateInterval> result;
+        auto it = by_pedestrian.find(pedestrian);
+        if (it == by_pedestrian.end() || to_ts < from_ts) return result;
+        const auto& list = it->second;
+        auto first = std::lower_bound(list.begin(), list.end(), from_ts, [](const StateInterval& interval, int64_t ts) {
+            return interval.end_ts < ts;
+        });
+        auto last = std::upper_bound(first, list.end(), to_ts, [](int64_t ts, const StateInterval& interval) {
+            return ts < interval.start_ts;
+        });
+        result.assign(first, last);
+        return result;
+    }
+
+    // Intervals of every pedestrian overlapping [from_ts, to_ts]
+    std::vector<StateInterval> query(int64_t from_ts, int64_t to_ts) const {
+        std::vector<StateInterval> result;
+        for (const auto& [pedestrian, list] : by_pedestrian) {
+            auto matches = query(pedestrian, from_ts, to_ts);
+            result.insert(result.end(), matches.begin(), matches.end());
+        }
+        return result;
+    }
+
+    // State of a pedestrian at a timestamp, STATE_UNKNOWN if it falls between or outside intervals
+    uint8_t stateAt(uint32_t pedestrian, int64_t ts) const {
+        auto matches = query(pedestrian, ts, ts);
+        return matches.empty() ? static_cast<uint8_t>(STATE_UNKNOWN) : matches.front().state_id;
+    }
+
+    // Total time a pedestrian spent in a state
+    int64_t dwellTime(uint32_t pedestrian, uint8_t state_id) const {
+        int64_t total = 0;
+        auto it = by_pedestrian.find(pedestrian);
+        if (it == by_pedestrian.end()) return total;
+        for (const auto& interval : it->second) {
+            if (interval.state_id == state_id) total += interval.end_ts - interval.start_ts + 1;
+        }
+        return total;
+    }
+};
+
+#endif // STATE_TIMELINE_HPP
@@ -0,0 +1,226 @@
+#ifndef TRAJECTORY_PREDICTION_HPP
+#define TRAJECTORY_PREDICTION_HPP
+
+// Typed model output and where it goes. Runners decode the raw [batch, horizon, 2] output into a
+// TrajectoryPrediction and hand it to a PredictionSink: the legacy stdout dump, a buffered CSV or binary
+// file, in-memory subscribers, or nothing at all when only inference is being measured.
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <iostream>
+#include <functional>
+#include <stdexcept>
+
+struct TrajectoryPrediction {
+    uint32_t pedestrian = 0;
+    int64_t frame = 0;
+    uint32_t horizon = 0;
+    std::vector<float> xy;  // horizon x (x, y)
+
+    // VQ-VAE side outputs of the TFT model, when the model exports them
+    bool has_vq = false;
+    float vq_loss = 0.0f;
+    float perplexity = 0.0f;
+
+    float x(size_t step) const { return xy[2 * step]; }
+    float y(size_t step) const { return xy[2 * step + 1]; }
+};
+
+// Decode sample `index` of a [batch, horizon, 2] (or [horizon, 2]) output into `prediction`, reusing its storage
+inline void decodeTrajectory(const float* output, const std::vector<int64_t>& shape, size_t index,
+                             TrajectoryPrediction& prediction) {
+    if (shape.size() < 2 || shape.back() != 2) {
+        throw std::runtime_error("Model output is not a [.., horizon, 2] trajectory");
+    }
+    size_t horizon = static_cast<size_t>(shape[shape.size() - 2]);
+    const float* sample = output + index * horizon * 2;
+    prediction.horizon = static_cast<uint32_t>(horizon);
+    prediction.xy.assign(sample, sample + horizon * 2);
+}
+
+// Attach the scalar vq_loss / perplexity outputs (second and third model outputs) when present
+inline void decodeVqOutputs(const float* vq_loss, const float* perplexity, TrajectoryPrediction& prediction) {
+    prediction.has_vq = vq_loss != nullptr;
+    prediction.vq_loss = vq_loss ? *vq_loss : 0.0f;
+    prediction.perplexity = perplexity ? *perplexity : 0.0f;
+}
+
+// Average and final displacement between two trajectories of the same horizon
+inline std::pair<double, double> trajectoryError(const TrajectoryPrediction& served, const TrajectoryPrediction& reference) {
+    size_t horizon = std::min(served.horizon, reference.horizon);
+    double sum = 0.0, last = 0.0;
+    for (size_t step = 0; step < horizon; step++) {
+        last = std::hypot(served.x(step) - reference.x(step), served.y(step) - reference.y(step));
+        sum += last;
+    }
+    return {horizon ? sum / horizon : 0.0, last};
+}
+
+class PredictionSink {
+public:
+    virtual ~PredictionSink() = default;
+    virtual void write(const TrajectoryPrediction& prediction) = 0;
+    virtual void flush() {}
+};
+
+// The runners' original per-frame dump
+class StdoutPredictionSink : public PredictionSink {
+public:
+    void write(const TrajectoryPrediction& prediction) override {
+        std::cout << "Model output " << prediction.frame + 1 << ": 1 " << prediction.horizon << " 2" << std::endl;
+        std::cout << "Output data: ";
+        for (float value : prediction.xy) std::cout << value << " ";
+        std::cout << std::endl;
+    }
+};
+
+// Drops predictions, for measuring inference alone
+class NullPredictionSink : public PredictionSink {
+public:
+    void write(const TrajectoryPrediction&) override {}
+};
+
+// One row per predicted step: pedestrian,frame,step,x,y
+class CsvPredictionSink : public PredictionSink {
+private:
+    std::vector<char> file_buffer;
+    std::ofstream out;
+
+public:
+    explicit CsvPredictionSink(const std::string& path, size_t buffer_size = 1 << 20)
+        : file_buffer(buffer_size) {
+        out.rdbuf()->pubsetbuf(file_buffer.data(), file_buffer.size());  // Before open to take effect
+        out.open(path);
+        if (!out) {
+            throw std::runtime_error("Cannot open prediction file: " + path);
+        }
+        out << "pedestrian,frame,step,x,y\n";
+    }
+
+    ~CsvPredictionSink() override { flush(); }
+
+    void write(const TrajectoryPrediction& prediction) override {
+        for (size_t step = 0; step < prediction.horizon; step++) {
+            out << prediction.pedestrian << ',' << prediction.frame << ',' << step + 1 << ','
+                << prediction.x(step) << ',' << prediction.y(step) << '\n';
+        }
+    }
+
+    void flush() override { out.flush(); }
+};
+
+// Binary layout: "TRAJPRED", uint32 version, then per prediction a 28-byte header
+// (pedestrian u32, frame i64, horizon u32, flags u32, vq_loss f32, perplexity f32) and horizon x 2 floats
+constexpr char PREDICTION_MAGIC[8] = {'T', 'R', 'A', 'J', 'P', 'R', 'E', 'D'};
+constexpr uint32_t PREDICTION_VERSION = 1;
+
+#pragma pack(push, 1)
+struct PredictionRecordHeader {
+    uint32_t pedestrian;
+    int64_t frame;
+    uint32_t horizon;
+    uint32_t flags;  // Bit 0: vq_loss / perplexity are set
+    float vq_loss;
+    float perplexity;
+};
+#pragma pack(pop)
+static_assert(sizeof(PredictionRecordHeader) == 28, "PredictionRecordHeader must stay 28 bytes");
+
+class BinaryPredictionSink : public PredictionSink {
+private:
+    std::ofstream out;
+    std::vector<char> buffer;  // Records are staged here and written in large chunks
+    size_t buffer_limit;
+
+    void append(const void* data, size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        buffer.insert(buffer.end(), bytes, bytes + size);
+    }
+
+public:
+    explicit BinaryPredictionSink(const std::string& path, size_t buffer_size = 1 << 20)
+        : out(path, std::ios::binary | std::ios::trunc), buffer_limit(buffer_size) {
+        if (!out) {
+            throw std::runtime_error("Cannot open prediction file: " + path);
+        }
+        buffer.reserve(buffer_size + 4096);
+        out.write(PREDICTION_MAGIC, sizeof(PREDICTION_MAGIC));
+        out.write(reinterpret_cast<const char*>(&PREDICTION_VERSION), sizeof(PREDICTION_VERSION));
+    }
+
+    ~BinaryPredictionSink() override { flush(); }
+
+    void write(const TrajectoryPrediction& prediction) override {
+        PredictionRecordHeader header{prediction.pedestrian, prediction.frame, prediction.horizon,
+                                      prediction.has_vq ? 1u : 0u, prediction.vq_loss, prediction.perplexity};
+        append(&header, sizeof(header));
+        append(prediction.xy.data(), prediction.xy.size() * sizeof(float));
+        if (buffer.size() >= buffer_limit) flush();
+    }
+
+    void flush() override {
+        out.write(buffer.data(), buffer.size());
+        buffer.clear();
+        out.flush();
+    }
+};
+
+inline std::vector<TrajectoryPrediction> readBinaryPredictions(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(PREDICTION_MAGIC)];
+    uint32_t version = 0;
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, PREDICTION_MAGIC, sizeof(magic)) != 0 ||
+        !in.read(reinterpret_cast<char*>(&version), sizeof(version)) || version != PREDICTION_VERSION) {
+        throw std::runtime_error("Not a prediction file: " + path);
+    }
+    std::vector<TrajectoryPrediction> predictions;
+    PredictionRecordHeader header;
+    while (in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        TrajectoryPrediction prediction;
+        prediction.pedestrian = header.pedestrian;
+        prediction.frame = header.frame;
+        prediction.horizon = header.horizon;
+        prediction.has_vq = header.flags & 1;
+        prediction.vq_loss = header.vq_loss;
+        prediction.perplexity = header.perplexity;
+        prediction.xy.resize(static_cast<size_t>(header.horizon) * 2);
+        if (!in.read(reinterpret_cast<char*>(prediction.xy.data()), prediction.xy.size() * sizeof(float))) {
+            throw std::runtime_error("Truncated prediction file: " + path);
+        }
+        predictions.push_back(std::move(prediction));
+    }
+    return predictions;
+}
+
+// In-process consumers, e.g. a planner polling the latest trajectory per pedestrian
+class SubscriberPredictionSink : public PredictionSink {
+public:
+    using Subscriber = std::function<void(const TrajectoryPrediction&)>;
+
+private:
+    std::vector<Subscriber> subscribers;
+
+public:
+    void subscribe(Subscriber subscriber) { subscribers.push_back(std::move(subscriber)); }
+
+    void write(const TrajectoryPrediction& prediction) override {
+        for (const auto& subscriber : subscribers) subscriber(prediction);
+    }
+};
+
+// "stdout", "none", "csv:<path>" or "bin:<path>"
+inline std::unique_ptr<PredictionSink> makePredictionSink(const std::string& spec) {
+    if (spec.empty() || spec == "stdout") return std::make_unique<StdoutPredictionSink>();
+    if (spec == "none") return std::make_unique<NullPredictionSink>();
+    if (spec.rfind("csv:", 0) == 0) return std::make_unique<CsvPredictionSink>(spec.substr(4));
+    if (spec.rfind("bin:", 0) == 0) return std::make_unique<BinaryPredictionSink>(spec.substr(4));
+    throw std::runtime_error("Unknown prediction output: " + spec + " (expected stdout, none, csv:<path> or bin:<path>)");
+}
+
+#endif // TRAJECTORY_PREDICTION_HPP
@@ -0,0 +1,377 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <mutex>
+#include <future>
+#include <exception>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <iomanip>
+#include <argparse.hpp>
+#include <config.hpp>
+#include <fam_params.hpp>
+#include <feature_rules.hpp>
+#include "../fam/FiniteAutomationMachine.hpp"
+
+// Values swept for one parameter, parsed from "name=lo:hi:step", "name=lo:hi" or "name=v1,v2,..."
+struct ParamSpec {
+    std::string name;
+    std::vector<double> values;  // Grid values
+    double low = 0.0;
+    double high = 0.0;
+    bool is_range = false;       // lo:hi(:step) form, sampled uniformly in random mode
+};
+
+struct SweepResult {
+    FamParams params;
+    size_t correct = 0;
+    size_t total = 0;
+    double accuracy() const { return total ? static_cast<double>(correct) / total : 0.0; }
+};
+
+ParamSpec parseParamSpec(const std::string& spec) {
+    size_t eq = spec.find('=');
+    if (eq == std::string::npos) {
+        throw std::runtime_error("Invalid parameter spec (expected name=values): " + spec);
+    }
+    ParamSpec result;
+    result.name = spec.substr(0, eq);
+    if (!FamParams().set(result.name, 0.0)) {
+        throw std::runtime_error("Unknown parameter: " + result.name);
+    }
+
+    std::string values = spec.substr(eq + 1);
+    if (values.find(':') != std::string::npos) {
+        std::vector<double> bounds;
+        std::stringstream ss(values);
+        std::string item;
+        while (std::getline(ss, item, ':')) bounds.push_back(std::stod(item));
+        if (bounds.size() < 2 || bounds.size() > 3 || bounds[1] < bounds[0]) {
+            throw std::runtime_error("Invalid range for " + result.name + ": " + values);
+        }
+        result.is_range = true;
+        result.low = bounds[0];
+        result.high = bounds[1];
+        double step = bounds.size() == 3 ? bounds[2] : (bounds[1] - bounds[0]) / 4;
+        if (step <= 0) step = bounds[1] - bounds[0] + 1;
+        // Half a step of slack so the upper bound survives floating point accumulation
+        for (double v = bounds[0]; v <= bounds[1] + step / 2; v += step) result.values.push_back(v);
+    } else {
+        std::stringstream ss(values);
+        std::string item;
+        while (std::getline(ss, item, ',')) result.values.push_back(std::stod(item));
+        if (result.values.empty()) {
+            throw std::runtime_error("No values given for " + result.name);
+        }
+        result.low = *std::min_element(result.values.begin(), result.values.end());
+        result.high = *std::max_element(result.values.begin(), result.values.end());
+    }
+    return result;
+}
+
+std::vector<FamParams> buildGrid(const std::vector<ParamSpec>& specs) {
+    std::vector<FamParams> grid = {FamParams()};
+    for (const auto& spec : specs) {
+        std::vector<FamParams> expanded;
+        expanded.reserve(grid.size() * spec.values.size());
+        for (const auto& params : grid) {
+            for (double value : spec.values) {
+                FamParams next = params;
+                next.set(spec.name, value);
+                expanded.push_back(next);
+            }
+        }
+        grid = std::move(expanded);
+    }
+    return grid;
+}
+
+std::vector<FamParams> buildRandom(const std::vector<ParamSpec>& specs, size_t count, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::vector<FamParams> samples;
+    samples.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        FamParams params;
+        for (const auto& spec : specs) {
+            if (spec.is_range) {
+                params.set(spec.name, std::uniform_real_distribution<double>(spec.low, spec.high)(rng));
+            } else {
+                params.set(spec.name, spec.values[std::uniform_int_distribution<size_t>(0, spec.values.size() - 1)(rng)]);
+            }
+        }
+        samples.push_back(params);
+    }
+    return samples;
+}
+
+// Feature records loaded once. Threshold-independent values (CSV columns, gaze cosines) are shared by
+// every parameter set; threshold-dependent features are recomputed once per distinct
+// (walk_stay_threshold, gazing_angle_threshold, collision_threshold) and reused afterwards.
+class FeatureCache {
+private:
+    using FeatureKey = std::tuple<double, double, double>;
+    using FeatureList = std::shared_ptr<const std::vector<Features>>;
+
+    std::vector<Features> base;
+    std::map<FeatureKey, std::shared_future<FeatureList>> variants;
+    std::mutex variants_mutex;
+    std::atomic<size_t> computed{0};
+
+public:
+    explicit FeatureCache(std::vector<Features> records) : base(std::move(records)) {
+        for (auto& features : base) {
+            Row row(features.User_X, features.User_Y, features.GazeDirection_X, features.GazeDirection_Y,
+                    features.AGV_X, features.AGV_Y, features.TimestampID);
+            features.user_agv_direction_cos = get_user_agv_direction_cos(row);
+            auto close_station_res = get_most_close_station_direction(row);
+            features.gazing_station_direction_cos = std::get<0>(close_station_res);
+            features.Gazing_station = std::get<1>(close_station_res);
+            features.closest_station_dir_X = std::get<2>(close_station_res);
+            features.closest_station_dir_Y = std::get<3>(close_station_res);
+        }
+    }
+
+    // Features under the calling thread's fam_params
+    FeatureList get() {
+        FeatureKey key{fam_params.walk_stay_threshold, fam_params.gazing_angle_threshold, fam_params.collision_threshold};
+        std::promise<FeatureList> promise;
+        std::shared_future<FeatureList> future;
+        bool owner = false;
+        {
+            std::lock_guard<std::mutex> lock(variants_mutex);
+            auto it = variants.find(key);
+            if (it == variants.end()) {
+                future = promise.get_future().share();
+                variants.emplace(key, future);
+                owner = true;
+            } else {
+                future = it->second;
+            }
+        }
+
+        if (owner) {
+            // Waiters on this key get the exception instead of blocking forever
+            try {
+                auto features = std::make_shared<std::vector<Features>>(base);
+                for (auto& row : *features) {
+                    update_threshold_features(row);
+                }
+                computed++;
+                promise.set_value(features);
+            } catch (...) {
+                promise.set_exception(std::current_exception());
+            }
+        }
+        return future.get();
+    }
+
+    size_t size() const { return base.size(); }
+    size_t variantsComputed() const { return computed; }
+};
+
+SweepResult evaluate(FeatureCache& cache, const FamParams& params) {
+    fam_params = params;
+    auto rows = cache.get();
+
+    SweepResult result;
+    result.params = params;
+    if (rows->size() < 2) return result;
+
+    FiniteAutomationMachine model{Features()};
+    model.setCurrentStateByName((*rows)[0].state);
+    for (size_t i = 1; i < rows->size(); i++) {
+        const Features& features = (*rows)[i];
+        model.run(features);
+        result.correct += model.getCurrentStateName() == features.state;
+        result.total++;
+    }
+    return result;
+}
+
+std::vector<SweepResult> runSweep(FeatureCache& cache, const std::vector<FamParams>& param_sets, size_t num_jobs) {
+    std::vector<SweepResult> results(param_sets.size());
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    // The first failure stops the other workers and is rethrown to the caller
+    auto worker = [&]() {
+        try {
+            for (size_t i = next++; i < param_sets.size(); i = next++) {
+                results[i] = evaluate(cache, param_sets[i]);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) error = std::current_exception();
+            next = param_sets.size();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < num_jobs; i++) workers.emplace_back(worker);
+    for (auto& thread : workers) thread.join();
+    if (error) std::rethrow_exception(error);
+    return results;
+}
+
+// Parse CSV line into Features struct
+Features parseCSVLine(const std::string& line, const std::vector<std::string>& headers) {
+    std::istringstream lineStream(line);
+    std::string cell;
+    Features features;
+    size_t columnIndex = 0;
+
+    while (std::getline(lineStream, cell, ',')) {
+        if (columnIndex < headers.size()) {
+            features.setField(headers[columnIndex], cell);
+        }
+        columnIndex++;
+    }
+
+    return features;
+}
+
+// Read and parse CSV file
+std::vector<Features> parseCSV(const std::string& filePath) {
+    std::ifstream file(filePath);
+    std::string line;
+    std::vector<Features> records;
+    std::vector<std::string> headers;
+
+    // Read headers
+    if (std::getline(file, line)) {
+        std::istringstream headerStream(line);
+        std::string header;
+        while (std::getline(headerStream, header, ',')) {
+            headers.push_back(header);
+        }
+    }
+
+    // Read data lines
+    while (std::getline(file, line)) {
+        records.push_back(parseCSVLine(line, headers));
+    }
+
+    return records;
+}
+
+int main(int argc, char** argv) {
+    argparse::ArgumentParser program("FAM Parameter Sweep");
+
+    program.add_argument("-f", "--file_path")
+        .help("Path to the CSV file containing feature records with ground truth states")
+        .default_value(std::string("data/demo/feature_fam/0.csv"));
+
+    program.add_argument("-p", "--param")
+        .help("Parameter to sweep: name=lo:hi:step, name=lo:hi or name=v1,v2,... (repeatable)")
+        .append();
+
+    program.add_argument("-r", "--random")
+        .help("Number of random samples drawn from the parameter ranges (0 = full grid)")
+        .default_value(0)
+        .scan<'i', int>();
+
+    program.add_argument("--seed")
+        .help("Random seed for --random")
+        .default_value(0)
+        .scan<'i', int>();
+
+    program.add_argument("-j", "--jobs")
+        .help("Number of worker threads (0 = all cores)")
+        .default_value(0)
+        .scan<'i', int>();
+
+    program.add_argument("-t", "--top")
+        .help("Number of best parameter sets to print")
+        .default_value(10)
+        .scan<'i', int>();
+
+    program.add_argument("-o", "--output")
+        .help("Optional CSV file receiving the accuracy of every parameter set")
+        .default_value(std::string(""));
+
+    std::vector<ParamSpec> specs;
+    try {
+        program.parse_args(argc, argv);
+        for (const auto& spec : program.get<std::vector<std::string>>("--param")) {
+            specs.push_back(parseParamSpec(spec));
+        }
+    } catch (const std::exception& err) {
+        std::cout << err.what() << std::endl;
+        std::cout << program;
+        exit(0);
+    }
+
+    std::string file_path = program.get<std::string>("-f");
+    int num_random = program.get<int>("--random");
+    size_t num_jobs = program.get<int>("--jobs") > 0 ? program.get<int>("--jobs") : std::max(1u, std::thread::hardware_concurrency());
+    size_t top = std::max(0, program.get<int>("--top"));
+    std::string output_path = program.get<std::string>("--output");
+
+    auto load_start = std::chrono::high_resolution_clock::now();
+    FeatureCache cache(parseCSV(file_path));
+    std::chrono::duration<double> load_elapsed = std::chrono::high_resolution_clock::now() - load_start;
+    std::cout << "Loaded " << cache.size() << " records in " << load_elapsed.count() << " seconds." << std::endl;
+
+    // The default parameter set goes first so the report always includes the baseline
+    std::vector<FamParams> param_sets = num_random > 0 ? buildRandom(specs, num_random, program.get<int>("--seed"))
+                                                       : buildGrid(specs);
+    param_sets.insert(param_sets.begin(), FamParams());
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<SweepResult> results;
+    try {
+        results = runSweep(cache, param_sets, num_jobs);
+    } catch (const std::exception& err) {
+        std::cerr << "Error evaluating parameter sets: " << err.what() << std::endl;
+        exit(-1);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+    SweepResult baseline = results.front();
+    std::vector<SweepResult> ranked(results.begin() + 1, results.end());
+    std::stable_sort(ranked.begin(), ranked.end(), [](const SweepResult& a, const SweepResult& b) {
+        return a.accuracy() > b.accuracy();
+    });
+
+    auto print_row = [&](const std::string& label, const SweepResult& result) {
+        std::cout << std::setw(10) << label << std::setw(10) << std::fixed << std::setprecision(4) << result.accuracy();
+        for (const auto& spec : specs) {
+            std::cout << "  " << spec.name << "=" << std::defaultfloat << result.params.get(spec.name);
+        }
+        std::cout << std::defaultfloat << std::endl;
+    };
+
+    std::cout << "\n" << std::setw(10) << "rank" << std::setw(10) << "accuracy" << "  parameters" << std::endl;
+    print_row("baseline", baseline);
+    for (size_t i = 0; i < std::min(top, ranked.size()); i++) {
+        print_row(std::to_string(i + 1), ranked[i]);
+    }
+
+    if (!output_path.empty()) {
+        std::ofstream output(output_path);
+        for (const auto& [name, member] : FamParams::fields()) output << name << ",";
+        output << "correct,total,accuracy\n";
+        for (const auto& result : results) {
+            for (const auto& [name, member] : FamParams::fields()) output << result.params.*member << ",";
+            output << result.correct << "," << result.total << "," << result.accuracy() << "\n";
+        }
+        std::cout << "Wrote " << results.size() << " results to " << output_path << std::endl;
+    }
+
+    std::cout << "\n\n\n";
+    std::cout << "Elapsed time: " << elapsed.count() << " seconds on " << num_jobs << " threads\n";
+    std::cout << "Evaluated " << results.size() << " parameter sets, computed "
+              << cache.variantsComputed() << " feature variants.\n";
+    std::cout << "Speed: " << results.size() / elapsed.count() << " parameter sets per second\n";
+
+    return 0;
+}
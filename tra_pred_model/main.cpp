@@ -4,81 +4,128 @@
 #include <deque>
 #include <vector>
 #include <thread>
+#include <unordered_map>
 #include <torch/script.h>
 #include <torch/torch.h>
 #include <argparse.hpp>
+#include <sliding_window.hpp>
+#include <trajectory_prediction.hpp>
+#include <process_memory.hpp>
+#include <feature_session.hpp>
+#include "torch_backend.hpp"
 
 class ModelRunner {
 private:
     torch::jit::script::Module model;
     std::string filename;
     int feature_dim;
-    std::deque<torch::Tensor> buffer;
+    SlidingWindow buffer;        // Latest `capacity` rows, contiguous for the input tensor
     size_t capacity;
     torch::Device device; // Store the device type
     int cnt = 0;
+    std::unique_ptr<TorchBackend> backend;     // Inference on the prepared module
+    std::unique_ptr<WindowPredictor> predictor;
+    std::unique_ptr<PredictionSink> sink = std::make_unique<StdoutPredictionSink>();
+    TrajectoryPrediction prediction;  // Decoded in place every frame
 
 public:
-    ModelRunner(const std::string& model_path, const std::string& filename, int feature_dim, size_t capacity)
-        : filename(filename), feature_dim(feature_dim), capacity(capacity), 
+    ModelRunner(const std::string& model_path, const std::string& filename, int feature_dim, size_t capacity,
+                bool mmap_model = false)
+        : filename(filename), feature_dim(feature_dim), buffer(capacity, feature_dim), capacity(capacity),
          device(torch::cuda::is_available() ? torch::kCUDA : torch::kCPU) {
         try {
-            model = torch::jit::load(model_path);
+            auto start = std::chrono::high_resolution_clock::now();
+            model = loadTorchModule(model_path, c10::nullopt, mmap_model);
+            auto loaded = std::chrono::high_resolution_clock::now();
             // Set device based on CUDA availability
             model.to(device);
+            model.eval();
+            auto moved = std::chrono::high_resolution_clock::now();
             std::cout << (device.type() == torch::kCUDA ? "Using GPU." : "Using CPU.") << std::endl;
 
-            // Verify model input dimension with a random input
-            auto test_input = torch::rand({1, feature_dim}, device);
-            std::vector<torch::jit::IValue> inputs = {test_input};
-            model.forward(inputs); // This will throw if the dimension is incorrect
+            // Check the forward signature instead of running a throwaway forward pass
+            validateSchema();
+            auto validated = std::chrono::high_resolution_clock::now();
+
+            // Inline parameters as constants and fuse for inference
+            model = freezeForInference(model);
+            auto frozen = std::chrono::high_resolution_clock::now();
+            backend = std::make_unique<TorchBackend>(model, device, "torch:" + model_path);
+            predictor = std::make_unique<WindowPredictor>(*backend, feature_dim);
+
+            std::chrono::duration<double, std::milli> load_ms = loaded - start, device_ms = moved - loaded,
+                                                      validate_ms = validated - moved, freeze_ms = frozen - validated,
+                                                      total_ms = frozen - start;
+            std::cout << "Startup: load " << load_ms.count() << " ms, device " << device_ms.count()
+                      << " ms, validate " << validate_ms.count() << " ms, freeze " << freeze_ms.count()
+                      << " ms, total " << total_ms.count() << " ms" << std::endl;
         } catch (const c10::Error& err) {
             std::cerr << "Error loading the model: " << err.what() << std::endl;
             exit(-1);
+        } catch (const std::runtime_error& err) {
+            std::cerr << "Error loading the model: " << err.what() << std::endl;
+            exit(-1);
+        }
+    }
+
+    // The model must expose forward(self, input, ...) taking one tensor; further arguments need defaults
+    void validateSchema() {
+        auto forward = model.find_method("forward");
+        if (!forward) {
+            std::cerr << "Error loading the model: no forward method" << std::endl;
+            exit(-1);
+        }
+        const c10::FunctionSchema& schema = forward->function().getSchema();
+        const auto& arguments = schema.arguments();
+        size_t num_inputs = arguments.empty() ? 0 : arguments.size() - 1;  // Skip self
+        size_t required = 0;
+        for (size_t i = 1; i < arguments.size(); i++) {
+            if (!arguments[i].default_value()) required++;
+        }
+        if (num_inputs == 0 || required > 1) {
+            std::cerr << "Error loading the model: forward takes " << required << " required inputs, expected 1 ("
+                      << schema << ")" << std::endl;
+            exit(-1);
+        }
+        const c10::TypePtr& type = arguments[1].type();
+        if (type->kind() != c10::TypeKind::TensorType && type->kind() != c10::TypeKind::AnyType) {
+            std::cerr << "Error loading the model: forward input is " << type->str() << ", expected Tensor" << std::endl;
+            exit(-1);
         }
     }
 
-    torch::Tensor convertLineToTensor(const std::string& line) {
-        torch::Tensor tensor = torch::empty(feature_dim, torch::kFloat32);
+    // Parse a CSV line straight into the next window slot
+    void convertLineToRow(const std::string& line, float* vec) {
+        std::fill(vec, vec + feature_dim, 0.0f);
         std::stringstream ss(line);
         std::string item;
         int index = 0;
         while (std::getline(ss, item, ',') && index < feature_dim) {
             try {
-                tensor[index++] = std::stof(item);
+                vec[index++] = std::stof(item);
             } catch (const std::exception& e) {
                 std::cerr << "Parsing error: " << e.what() << " in line: " << line << std::endl;
-                tensor[index++] = 0.0f; // Handle error, e.g., by setting to zero
+                vec[index++] = 0.0f; // Handle error, e.g., by setting to zero
             }
         }
-        return tensor;
     }
 
     void feedModel(){
-        if (buffer.empty()) return;
-
-        // Stack tensors to create a batched input
-        auto input = torch::stack(std::vector<torch::Tensor>(buffer.begin(), buffer.end()));
+        if (!buffer.full()) return;
 
-        // Forward pass through the model
-        // auto outputs = model.forward({input}).toTuple();
-        // auto predictions = outputs->elements()[0].toTensor();
-
-        auto predictions = model.forward({input}).toTensor();
-        std::cout << "Model output " << this->cnt + 1 << ": " 
-                  << std::setw(3) << std::setfill(' ');
-        this->cnt++;
-        for (auto s : predictions.sizes()) std::cout << s << " ";
-        std::cout << std::endl;
+        // The window is wrapped without a copy on the CPU; the TFT's vq_loss and perplexity come along
+        prediction.frame = this->cnt++;
+        predictor->predict(buffer.data(), capacity, prediction);
+        sink->write(prediction);
+    }
 
-        std::cout << predictions << std::endl;
+    // Where predictions go: "stdout" (default), "none", "csv:<path>" or "bin:<path>"
+    void setOutput(const std::string& spec) {
+        sink = makePredictionSink(spec);
     }
 
-    void updateBuffer(torch::Tensor newTensor) {
-        if (buffer.size() >= capacity) {
-            buffer.pop_front();  // Remove the oldest tensor if we are at capacity
-        }
-        buffer.push_back(newTensor);  // Add the new tensor to the buffer
+    void updateBuffer(const std::vector<float>& newVector) {
+        buffer.push(newVector);  // Overwrites the oldest row once the window is full
     }
 
     void processFile(const std::string& spec_filename) {
@@ -91,10 +138,11 @@ public:
         if (std::getline(file, line)) {} // Optionally handle header
 
         while (std::getline(file, line)) {
-            auto tensor = convertLineToTensor(line);
-            updateBuffer(tensor);  // Update the buffer with each new line
-            feedModel();           // Run the model on every new line
+            convertLineToRow(line, buffer.next_row());
+            buffer.commit_row();  // Update the buffer with each new line
+            feedModel();          // Run the model on every new line
         }
+        sink->flush();
 
         auto end = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double> elapsed = end - start;
@@ -104,7 +152,56 @@ public:
         std::cout << "Speed: " << this->cnt / elapsed.count() << " lines per second.\n\n" << std::endl;
     }
 
-    // TODO: Is this to run multiple instances of the model paralelly?
+    // Offline re-scoring of a whole recorded session: all sliding windows of the file as one strided view
+    // (unfold) over the parsed rows, run in [batch_windows, capacity, feature_dim] slices on libtorch's
+    // intra-op pool. Predictions are written in window order.
+    void processFileOffline(const std::string& spec_filename, size_t batch_windows) {
+        auto start = std::chrono::high_resolution_clock::now();
+        std::string effectiveFilename = spec_filename.empty() ? this->filename : spec_filename;
+        std::cout << "Processing file offline: " << effectiveFilename << ", " << batch_windows << " windows per batch, "
+                  << at::get_num_threads() << " threads" << std::endl;
+
+        FeatureSession recording(effectiveFilename, feature_dim);
+        auto parsed = std::chrono::high_resolution_clock::now();
+        size_t windows = recording.window_count(capacity);
+        size_t batches = 0;
+        if (windows > 0) {
+            c10::InferenceMode guard;
+            torch::Tensor rows = torch::from_blob(const_cast<float*>(recording.data()),
+                {static_cast<int64_t>(recording.row_count()), static_cast<int64_t>(feature_dim)}, torch::kFloat32);
+            // [windows, feature_dim, capacity] -> [windows, capacity, feature_dim], both views of `rows`
+            torch::Tensor all_windows = rows.unfold(0, static_cast<int64_t>(capacity), 1).transpose(1, 2);
+            for (size_t first = 0; first < windows; first += batch_windows) {
+                size_t count = std::min(batch_windows, windows - first);
+                torch::Tensor batch = all_windows.narrow(0, static_cast<int64_t>(first), static_cast<int64_t>(count));
+                torch::jit::IValue output = model.forward({batch.to(device)});
+                torch::Tensor predictions = output.isTuple() ? output.toTuple()->elements()[0].toTensor() : output.toTensor();
+                predictions = predictions.to(torch::kCPU).contiguous();
+                batches++;
+
+                bool has_vq = output.isTuple() && output.toTuple()->elements().size() >= 3;
+                float vq_loss = has_vq ? output.toTuple()->elements()[1].toTensor().item<float>() : 0.0f;
+                float perplexity = has_vq ? output.toTuple()->elements()[2].toTensor().item<float>() : 0.0f;
+                for (size_t i = 0; i < count; i++) {
+                    prediction.frame = this->cnt++;
+                    decodeTrajectory(predictions.data_ptr<float>(), predictions.sizes().vec(), i, prediction);
+                    if (has_vq) decodeVqOutputs(&vq_loss, &perplexity, prediction);
+                    sink->write(prediction);
+                }
+            }
+        }
+        sink->flush();
+
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+        std::cout << "\n\n";
+        std::cout << "Elapsed time: " << elapsed.count() << " seconds." << std::endl;
+        std::cout << "Processed " << windows << " windows of " << recording.row_count() << " rows in " << batches
+                  << " batches (parse " << std::chrono::duration<double>(parsed - start).count() << " s)." << std::endl;
+        std::cout << "Speed: " << windows / elapsed.count() << " windows per second.\n\n" << std::endl;
+    }
+
+    // Single replica on one worker; parallel pinned replicas are served by ModelPool (tra_pred_model_onnx/model_pool.hpp)
     void start(const std::string& filename = "") {
         this->cnt = 0;
         std::thread worker(&ModelRunner::processFile, this, filename);
@@ -121,7 +218,7 @@ int main(int argc, char** argv) {
         .default_value(std::string("data/demo/feature_model/0.csv"));
 
     program.add_argument("-b", "--batch_size")
-        .help("Size of bach for processing")
+        .help("Window length (sequence length) fed to the model")
         .default_value(40)
         .scan<'i', size_t>(); // Scanning as size_t; 
 
@@ -134,6 +231,23 @@ int main(int argc, char** argv) {
         .default_value(32)
         .scan<'i', int>();
 
+    program.add_argument("--output")
+        .help("Prediction output: stdout, none, csv:<path> or bin:<path>")
+        .default_value(std::string("stdout"));
+
+    program.add_argument("--offline")
+        .help("Re-score the whole file in large batches of sliding windows, using every core")
+        .flag();
+
+    program.add_argument("--offline_batch")
+        .help("Windows per model call in offline mode")
+        .default_value(256)
+        .scan<'i', int>();
+
+    program.add_argument("--mmap_model")
+        .help("Read the model from a shared read-only memory map instead of a private copy of the file")
+        .flag();
+
     try {
         program.parse_args(argc, argv);
     } catch (const std::runtime_error& err) {
@@ -149,10 +263,31 @@ int main(int argc, char** argv) {
     int feature_dim = program.get<int>("--feature_dim");
 
 
+    ResidentMemory memory_before_load = residentMemory();
     ModelRunner runner(model_path,
                        file_path,
                        feature_dim, // Feature dimension
-                       batch_size); // Capacity or batch size
+                       batch_size, // Capacity or batch size
+                       program.get<bool>("--mmap_model"));
+    memory_before_load.print(std::cout, "before model load");
+    residentMemory().print(std::cout, "after model load");
+
+    try {
+        runner.setOutput(program.get<std::string>("--output"));
+    } catch (const std::runtime_error& err) {
+        std::cerr << err.what() << std::endl;
+        exit(-1);
+    }
+
+    if (program.get<bool>("--offline")) {
+        try {
+            runner.processFileOffline(file_path, std::max(program.get<int>("--offline_batch"), 1));
+        } catch (const std::exception& err) {
+            std::cerr << "Error in offline mode: " << err.what() << std::endl;
+            exit(-1);
+        }
+        return 0;
+    }
 
     runner.start(file_path);
     return 0;
@@ -0,0 +1,147 @@
+#ifndef TORCH_BACKEND_HPP
+#define TORCH_BACKEND_HPP
+
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <torch/script.h>
+#include <torch/torch.h>
+#include <inference_backend.hpp>
+#include <mapped_file.hpp>
+#include <caffe2/serialize/read_adapter_interface.h>
+
+// Freeze an eval-mode module (parameters and attributes become constants) and run the inference passes
+// (conv/bn folding, op fusion). Modules that cannot be frozen are returned as they are.
+inline torch::jit::script::Module freezeForInference(const torch::jit::script::Module& module) {
+    try {
+        torch::jit::script::Module frozen = torch::jit::freeze(module);
+        return torch::jit::optimize_for_inference(frozen);
+    } catch (const c10::Error& err) {
+        std::cerr << "Cannot freeze the model, running it unfrozen: " << err.what() << std::endl;
+        return module;
+    }
+}
+
+// TorchScript archive read straight from a shared read-only mapping instead of a private copy of the file.
+// The loader still copies the tensor data out of the archive into the module's own storage.
+class MappedReadAdapter : public caffe2::serialize::ReadAdapterInterface {
+private:
+    MappedFile file;
+
+public:
+    explicit MappedReadAdapter(const std::string& path) : file(path) {}
+
+    size_t size() const override { return file.size(); }
+
+    size_t read(uint64_t pos, void* buf, size_t n, const char* what = "") const override {
+        (void)what;
+        if (pos >= file.size()) return 0;
+        n = std::min<size_t>(n, file.size() - pos);
+        std::memcpy(buf, static_cast<const char*>(file.data()) + pos, n);
+        return n;
+    }
+};
+
+// torch::jit::load from a file path, or from a MappedReadAdapter when `mapped`
+inline torch::jit::script::Module loadTorchModule(const std::string& model_path, c10::optional<torch::Device> device,
+                                                  bool mapped) {
+    if (!mapped) return torch::jit::load(model_path, device);
+    return torch::jit::load(std::make_shared<MappedReadAdapter>(model_path), device);
+}
+
+// InferenceBackend over a TorchScript module. The input span is wrapped without a copy, and the wrapping tensor
+// is kept per input address, so a sliding window cycling through its positions allocates nothing per frame.
+// Models returning a tuple (the TFT also returns vq_loss and perplexity) are read from their first element.
+class TorchBackend : public InferenceBackend {
+private:
+    torch::jit::script::Module module;
+    torch::Device device;
+    std::string label;
+    std::map<std::vector<int64_t>, std::vector<int64_t>> output_shapes;  // By input dims
+    std::unordered_map<const float*, torch::Tensor> input_tensors;
+    bool has_vq = false;
+    float last_vq_loss = 0.0f;
+    float last_perplexity = 0.0f;
+
+    static constexpr size_t MAX_INPUT_TENSORS = 4096;  // Callers with ever new buffers do not grow the cache
+
+    torch::Tensor inputTensor(const float* input, const WindowShape& shape) {
+        auto it = input_tensors.find(input);
+        if (it != input_tensors.end() && it->second.size(0) == static_cast<int64_t>(shape.batch) &&
+            it->second.size(1) == static_cast<int64_t>(shape.sequence_length) &&
+            it->second.size(2) == static_cast<int64_t>(shape.feature_dim)) {
+            return it->second;
+        }
+        if (input_tensors.size() >= MAX_INPUT_TENSORS) input_tensors.clear();
+        // from_blob does not take ownership; the module only reads its input
+        torch::Tensor tensor = torch::from_blob(const_cast<float*>(input), shape.dims(), torch::kFloat32);
+        input_tensors[input] = tensor;
+        return tensor;
+    }
+
+    torch::Tensor forward(const float* input, const WindowShape& shape) {
+        c10::InferenceMode guard;
+        torch::Tensor tensor = inputTensor(input, shape);
+        if (device.type() != torch::kCPU) tensor = tensor.to(device);
+        torch::jit::IValue result = module.forward({tensor});
+        has_vq = result.isTuple() && result.toTuple()->elements().size() >= 3;
+        if (has_vq) {
+            const auto& elements = result.toTuple()->elements();
+            last_vq_loss = elements[1].toTensor().item<float>();
+            last_perplexity = elements[2].toTensor().item<float>();
+        }
+        torch::Tensor prediction = result.isTuple() ? result.toTuple()->elements()[0].toTensor() : result.toTensor();
+        return prediction.to(torch::kCPU).contiguous();
+    }
+
+public:
+    TorchBackend(const std::string& model_path, torch::Device device = torch::kCPU)
+        : module(torch::jit::load(model_path, device)), device(device), label("torch:" + model_path) {
+        module.eval();
+        module = freezeForInference(module);
+    }
+
+    // Over a module the caller has already loaded, placed on `device` and prepared for inference
+    TorchBackend(torch::jit::script::Module prepared, torch::Device device, const std::string& label)
+        : module(std::move(prepared)), device(device), label(label) {}
+
+    std::string name() const override { return label; }
+
+    std::vector<int64_t> outputShape(const WindowShape& shape) override {
+        std::vector<int64_t> dims = shape.dims();
+        auto it = output_shapes.find(dims);
+        if (it == output_shapes.end()) {
+            std::vector<float> zeros(shape.element_count(), 0.0f);
+            torch::Tensor prediction = forward(zeros.data(), shape);
+            it = output_shapes.emplace(dims, prediction.sizes().vec()).first;
+        }
+        return it->second;
+    }
+
+    void infer(const float* input, const WindowShape& shape, float* output) override {
+        torch::Tensor prediction = forward(input, shape);
+        std::memcpy(output, prediction.data_ptr<float>(), prediction.numel() * sizeof(float));
+    }
+
+    // The shape is known after the forward pass, no zero run to size the output
+    void inferResized(const float* input, const WindowShape& shape, std::vector<float>& output,
+                      std::vector<int64_t>& dims) override {
+        torch::Tensor prediction = forward(input, shape);
+        dims.assign(prediction.sizes().begin(), prediction.sizes().end());
+        const float* data = prediction.data_ptr<float>();
+        output.assign(data, data + prediction.numel());
+    }
+
+    bool vqOutputs(float& vq_loss, float& perplexity) const override {
+        vq_loss = last_vq_loss;
+        perplexity = last_perplexity;
+        return has_vq;
+    }
+
+    torch::jit::script::Module& torch_module() { return module; }
+};
+
+#endif // TORCH_BACKEND_HPP
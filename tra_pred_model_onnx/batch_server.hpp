@@ -0,0 +1,171 @@
+#ifndef BATCH_SERVER_HPP
+#define BATCH_SERVER_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "onnx_session.hpp"
+
+// Dynamic batching over many pedestrians. Callers submit one ready [T, F] window each; a worker packs
+// up to max_batch_size queued windows into a single [B, T, F] run, waiting at most max_queue_delay for
+// the batch to fill, and scatters row b of every output back to the request that supplied window b.
+class BatchServer {
+public:
+    // Model outputs for one window. Batch-major outputs keep the request's row with a batch dimension of 1;
+    // outputs that are not batch-major (the TFT's scalar vq_loss / perplexity) are copied whole to every
+    // request. Has the output accessors of OnnxSession, so decodePrediction(result, 0, prediction) works.
+    struct Result {
+        std::vector<std::vector<float>> values;
+        std::vector<std::vector<int64_t>> shapes;
+
+        const float* output(size_t index = 0) const { return values[index].data(); }
+        size_t output_size(size_t index = 0) const { return values[index].size(); }
+        const std::vector<int64_t>& output_shape(size_t index = 0) const { return shapes[index]; }
+        size_t output_count() const { return values.size(); }
+    };
+
+    struct Stats {
+        size_t requests = 0;
+        size_t batches = 0;
+        size_t full_batches = 0;   // Dispatched because max_batch_size was reached
+        double run_seconds = 0.0;  // Time spent inside the model
+    };
+
+private:
+    struct Request {
+        uint32_t pedestrian;
+        std::vector<float> window;
+        std::promise<Result> result;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    OnnxSession& session;
+    size_t sequence_length;
+    size_t feature_dim;
+    size_t max_batch_size;
+    std::chrono::microseconds max_queue_delay;
+
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::deque<Request> queue;
+    bool stopping = false;
+
+    std::vector<float> batch_input;  // max_batch_size x T x F, reused for every batch
+    std::vector<int64_t> input_shape;
+    Stats stats;
+    std::thread worker;
+
+    void serve() {
+        std::vector<Request> batch;
+        batch.reserve(max_batch_size);
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                queue_cv.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty()) return;  // Stopping and drained
+
+                // Hold the batch open until it is full or the oldest request has waited long enough
+                auto deadline = queue.front().enqueued + max_queue_delay;
+                queue_cv.wait_until(lock, deadline, [this] { return stopping || queue.size() >= max_batch_size; });
+
+                size_t count = std::min(queue.size(), max_batch_size);
+                for (size_t i = 0; i < count; i++) {
+                    batch.push_back(std::move(queue.front()));
+                    queue.pop_front();
+                }
+            }
+            runBatch(batch);
+            batch.clear();
+        }
+    }
+
+    void runBatch(std::vector<Request>& batch) {
+        size_t window_size = sequence_length * feature_dim;
+        for (size_t b = 0; b < batch.size(); b++) {
+            std::memcpy(batch_input.data() + b * window_size, batch[b].window.data(), window_size * sizeof(float));
+        }
+        input_shape[0] = static_cast<int64_t>(batch.size());
+
+        auto start = std::chrono::high_resolution_clock::now();
+        try {
+            session.run(batch_input.data(), input_shape);
+        } catch (...) {
+            for (auto& request : batch) request.result.set_exception(std::current_exception());
+            return;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+        stats.requests += batch.size();
+        stats.batches++;
+        if (batch.size() == max_batch_size) stats.full_batches++;
+        stats.run_seconds += elapsed.count();
+
+        // Request b owns the b-th contiguous slice of a batch-major output
+        size_t outputs = session.output_count();
+        for (size_t b = 0; b < batch.size(); b++) {
+            Result result;
+            result.values.resize(outputs);
+            result.shapes.resize(outputs);
+            for (size_t i = 0; i < outputs; i++) {
+                const std::vector<int64_t>& shape = session.output_shape(i);
+                bool batch_major = !shape.empty() && shape[0] == static_cast<int64_t>(batch.size());
+                size_t per_request = batch_major ? session.output_size(i) / batch.size() : session.output_size(i);
+                const float* data = session.output(i) + (batch_major ? b * per_request : 0);
+                result.values[i].assign(data, data + per_request);
+                result.shapes[i] = shape;
+                if (batch_major) result.shapes[i][0] = 1;
+            }
+            batch[b].result.set_value(std::move(result));
+        }
+    }
+
+public:
+    BatchServer(OnnxSession& session, size_t sequence_length, size_t feature_dim,
+                size_t max_batch_size, std::chrono::microseconds max_queue_delay)
+        : session(session), sequence_length(sequence_length), feature_dim(feature_dim),
+          max_batch_size(std::max<size_t>(max_batch_size, 1)), max_queue_delay(max_queue_delay),
+          batch_input(this->max_batch_size * sequence_length * feature_dim, 0.0f),
+          input_shape{1, static_cast<int64_t>(sequence_length), static_cast<int64_t>(feature_dim)} {
+        worker = std::thread(&BatchServer::serve, this);
+    }
+
+    ~BatchServer() { stop(); }
+
+    BatchServer(const BatchServer&) = delete;
+    BatchServer& operator=(const BatchServer&) = delete;
+
+    // Queue one [T, F] window, oldest row first. The window is copied, so the caller may keep sliding it.
+    std::future<Result> submit(uint32_t pedestrian, const float* window) {
+        Request request;
+        request.pedestrian = pedestrian;
+        request.window.assign(window, window + sequence_length * feature_dim);
+        request.enqueued = std::chrono::steady_clock::now();
+        std::future<Result> future = request.result.get_future();
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            queue.push_back(std::move(request));
+        }
+        queue_cv.notify_one();
+        return future;
+    }
+
+    // Serve what is already queued, then stop the worker
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            stopping = true;
+        }
+        queue_cv.notify_one();
+        if (worker.joinable()) worker.join();
+    }
+
+    // Only consistent once the server is stopped
+    const Stats& statistics() const { return stats; }
+};
+
+#endif // BATCH_SERVER_HPP
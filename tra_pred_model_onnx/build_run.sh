@@ -1,7 +1,9 @@
 # Build the main.cpp file with the onnxruntime library
 g++ -v -std=c++17 \
     -I/Users/shawn/Documents/UMSI/Boeing_Project/onnxruntime/include \
+    -I../include \
     main.cpp \
+    ../fam/FiniteAutomationMachine.cpp \
     /Users/shawn/Documents/UMSI/Boeing_Project/onnxruntime/build/MacOS/Release/libonnxruntime.dylib \
     -o main \
     -Wl,-rpath,/Users/shawn/Documents/UMSI/Boeing_Project/onnxruntime/build/MacOS/Release/
@@ -14,11 +16,41 @@ g++ -v -std=c++17 \
     --model_path model/model.onnx \
     --feature_dim 32
 
+# quantize the model to INT8 (QDQ) and compare it against the float model
+python quantize_model.py --model model/model.onnx --data data/demo/feature_model --output model/model.int8.onnx
+./main \
+    --file_path data/demo/feature_model/0.csv \
+    --batch_size 30 \
+    --model_path model/model.onnx \
+    --feature_dim 32 \
+    --compare_model_path model/model.int8.onnx
+
+# scaling benchmark of pinned model replicas, 1 to 4 replicas
+./main \
+    --file_path data/demo/feature_model/0.csv \
+    --batch_size 30 \
+    --model_path model/model.onnx \
+    --feature_dim 32 \
+    --pool_replicas 4 \
+    --cores_per_replica 1 \
+    --scaling_bench
+
+# run 50 pedestrians through the batching server
+./main \
+    --file_path data/demo/feature_model/0.csv \
+    --batch_size 30 \
+    --model_path model/model.onnx \
+    --feature_dim 32 \
+    --num_pedestrians 50 \
+    --max_batch_size 16 \
+    --max_queue_delay_us 2000
+
 
 
 # Build the main.cpp file with the onnxruntime library
 g++ -v -std=c++17 \
     -I/Users/shawn/Documents/UMSI/Boeing_Project/onnxruntime/include \
+    -I../include \
     main_logsim.cpp \
     /Users/shawn/Documents/UMSI/Boeing_Project/onnxruntime/build/MacOS/Release/libonnxruntime.dylib \
     -o main_logsim \
@@ -30,4 +62,115 @@ g++ -v -std=c++17 \
     --sequence_length 30 \
     --model_path model/model_cvm.onnx \
     --feature_dim 2 \
-    --log_dir data/demo/feature_cvm/logs
\ No newline at end of file
+    --log_dir data/demo/feature_cvm/logs
+
+# same logs through the native constant-velocity backend, checked against model_cvm.onnx
+./main_logsim \
+    --sequence_length 30 \
+    --model_path model/model_cvm.onnx \
+    --feature_dim 2 \
+    --log_dir data/demo/feature_cvm/logs \
+    --backend cvm-native \
+    --validate_backend
+
+# simulator and predictor over a shared-memory ring instead of one log file per sample
+g++ -std=c++17 -I../include log_writer.cpp -o log_writer
+./main_logsim \
+    --sequence_length 30 \
+    --model_path model/model_cvm.onnx \
+    --feature_dim 2 \
+    --log_dir shm:ue_samples &
+./log_writer --input data/demo/feature_model/0.csv --shm ue_samples
+wait
+
+# same through one rotating append-only segment log, at most 4 segment files on disk
+./main_logsim \
+    --sequence_length 30 \
+    --model_path model/model_cvm.onnx \
+    --feature_dim 2 \
+    --log_dir segments:data/demo/feature_cvm/segments &
+./log_writer --input data/demo/feature_model/0.csv --segments data/demo/feature_cvm/segments --keep_segments 4
+wait
+
+# datagram ingest: four simulated pedestrians sent over UDP, one sliding window per pedestrian
+./main_logsim \
+    --sequence_length 30 \
+    --model_path model/model_cvm.onnx \
+    --feature_dim 2 \
+    --log_dir udp:9000 &
+./log_writer --input data/demo/feature_model/0.csv --send udp:9000 --users 4
+wait
+
+# raw rows straight into the model input, columns in the feature_model order
+./main \
+    --file_path data/demo/raw/0.csv \
+    --batch_size 30 \
+    --model_path model/model.onnx \
+    --feature_dim 32 \
+    --raw_input \
+    --trip 1,2 \
+    --feature_schema data/demo/feature_model/0.csv
+
+# same, with the FAM choosing how often the model runs; --schedule_eval reports the error of reused frames
+./main \
+    --file_path data/demo/raw/0.csv \
+    --batch_size 30 \
+    --model_path model/model.onnx \
+    --feature_dim 32 \
+    --raw_input \
+    --trip 1,2 \
+    --schedule \
+    --schedule_eval
+
+# a crowd of 64 pedestrians through the CVM-first cascade, escalations batched up to 16
+./main \
+    --file_path data/demo/feature_model/0.csv \
+    --batch_size 30 \
+    --model_path model/model.onnx \
+    --feature_dim 32 \
+    --cascade \
+    --num_pedestrians 64 \
+    --max_batch_size 16 \
+    --cascade_eval
+
+# stateful streaming: one timestep per frame with past_* / present_* state, on a fixture whose cache state
+# grows to 30 rows and a fixed-shape smoothed-position state
+python make_stateful_fixture.py --output model/model_stateful.onnx --check
+./main \
+    --file_path data/demo/feature_model/0.csv \
+    --batch_size 30 \
+    --model_path model/model_stateful.onnx \
+    --feature_dim 32
+
+# swap in model/model.onnx whenever it is replaced, after 50 frames of running it next to the current model
+./main \
+    --file_path data/demo/feature_model/0.csv \
+    --batch_size 30 \
+    --model_path model/model.onnx \
+    --feature_dim 32 \
+    --watch_model \
+    --shadow_frames 50
+
+# one runner per camera zone sharing the model pages: move the weights to an external file, load from a
+# read-only mmap and compare the RSS reports
+python externalize_model.py --model model/model.onnx --output model/model.ext.onnx --check
+for zone in 0 1 2; do  # the demo has one file; each zone replays it
+    ./main \
+        --file_path data/demo/feature_model/0.csv \
+        --batch_size 30 \
+        --model_path model/model.ext.onnx \
+        --feature_dim 32 \
+        --mmap_model \
+        --output none &
+done
+wait
+
+# re-score a recorded session offline: all sliding windows in batches of 256 on every core
+./main \
+    --file_path data/demo/feature_model/0.csv \
+    --batch_size 30 \
+    --model_path model/model.onnx \
+    --feature_dim 32 \
+    --offline \
+    --offline_batch 256 \
+    --output csv:predictions_offline.csv
@@ -0,0 +1,59 @@
+"""Move the weights of an ONNX model into an external data file, so runners started with --mmap_model share them.
+
+    python externalize_model.py --model model/model.onnx --output model/model.ext.onnx
+
+A protobuf .onnx keeps its initializers inline, and ORT copies them into private memory of every process
+that loads the model. With the initializers in <output>.data, ORT maps that file read-only, so the weight
+pages are shared by every runner on the host. Keep the .data file next to the .onnx file.
+
+Prepacked weights are private again, so --mmap_model also turns ORT's weight prepacking off. Compare the
+RSS reports of two runners:
+
+    ./main --model_path model/model.ext.onnx --mmap_model --batch_size 30 --feature_dim 32 --output none
+"""
+import argparse
+import os
+
+import numpy as np
+import onnx
+from onnx import numpy_helper
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--model", default="model/model.onnx")
+    parser.add_argument("--output", default="model/model.ext.onnx")
+    parser.add_argument("--size_threshold", type=int, default=1024,
+                        help="Initializers smaller than this many bytes stay inline")
+    parser.add_argument("--check", action="store_true", help="Compare the two models on a random input")
+    parser.add_argument("--symbolic_dim", type=int, default=30,
+                        help="Size of symbolic input dimensions in the check (the runner's --batch_size)")
+    args = parser.parse_args()
+
+    model = onnx.load(args.model)
+    location = os.path.basename(args.output) + ".data"
+    data_path = os.path.join(os.path.dirname(args.output) or ".", location)
+    if os.path.exists(data_path):
+        os.remove(data_path)  # onnx appends to an existing data file
+    onnx.save_model(model, args.output, save_as_external_data=True, all_tensors_to_one_file=True,
+                    location=location, size_threshold=args.size_threshold)
+
+    external = sum(numpy_helper.to_array(tensor).nbytes for tensor in model.graph.initializer
+                   if numpy_helper.to_array(tensor).nbytes >= args.size_threshold)
+    print(f"Wrote {args.output} ({os.path.getsize(args.output)} bytes) and {data_path} "
+          f"({os.path.getsize(data_path)} bytes, {external} bytes of initializers)")
+
+    if args.check:
+        import onnxruntime as ort
+        inline = ort.InferenceSession(args.model)
+        moved = ort.InferenceSession(args.output)
+        feeds = {}
+        for node in inline.get_inputs():
+            shape = [dim if isinstance(dim, int) else args.symbolic_dim for dim in node.shape]
+            feeds[node.name] = np.random.default_rng(0).random(shape, dtype=np.float32)
+        diff = max(float(np.abs(a - b).max()) for a, b in zip(inline.run(None, feeds), moved.run(None, feeds)))
+        print(f"Max abs diff to {args.model}: {diff}")
+
+
+if __name__ == "__main__":
+    main()
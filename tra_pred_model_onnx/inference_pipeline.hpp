@@ -0,0 +1,183 @@
+#ifndef INFERENCE_PIPELINE_HPP
+#define INFERENCE_PIPELINE_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "onnx_session.hpp"
+
+// Three-stage frame pipeline: the caller parses frame t+1 while a dedicated thread runs the model on
+// frame t and a third thread hands frame t-1 to the completion callback. Frames flow through a fixed set
+// of slots in FIFO order through single-threaded stages, so completions arrive in submission order.
+// A frame whose inference throws is not handed to the callback; its slot still goes back to the free list so
+// no stage stalls. The first such error is rethrown by the next acquire() and by finish().
+class InferencePipeline {
+public:
+    struct Completion {
+        size_t frame;
+        const float* output;
+        size_t output_size;
+        const std::vector<int64_t>& output_shape;
+        std::chrono::high_resolution_clock::time_point started;  // When the caller began building the frame
+        double infer_us;
+    };
+    using Callback = std::function<void(const Completion&)>;
+
+private:
+    struct Slot {
+        std::vector<float> input;
+        std::vector<float> output;
+        std::vector<int64_t> output_shape;
+        size_t frame = 0;
+        std::chrono::high_resolution_clock::time_point started;
+        double infer_us = 0.0;
+        std::exception_ptr error;  // Set when the run failed
+    };
+
+    // Blocking FIFO of slot pointers; pop returns nullptr once closed and drained
+    class SlotQueue {
+    private:
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<Slot*> slots;
+        bool closed = false;
+
+    public:
+        void push(Slot* slot) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                slots.push_back(slot);
+            }
+            cv.notify_one();
+        }
+
+        Slot* pop() {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] { return closed || !slots.empty(); });
+            if (slots.empty()) return nullptr;
+            Slot* slot = slots.front();
+            slots.pop_front();
+            return slot;
+        }
+
+        void close() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                closed = true;
+            }
+            cv.notify_all();
+        }
+    };
+
+    OnnxSession& session;
+    std::vector<int64_t> input_shape;
+    Callback callback;
+    std::vector<Slot> slots;
+    SlotQueue free_slots;
+    SlotQueue infer_queue;
+    SlotQueue emit_queue;
+    Slot* acquired = nullptr;
+    std::thread infer_thread;
+    std::thread emit_thread;
+    bool finished = false;
+    std::mutex error_mutex;
+    std::exception_ptr first_error;  // First failed run or callback
+
+    void inferLoop() {
+        while (Slot* slot = infer_queue.pop()) {
+            auto start = std::chrono::high_resolution_clock::now();
+            slot->error = nullptr;
+            try {
+                session.run(slot->input.data(), input_shape);
+                slot->output.assign(session.output(0), session.output(0) + session.output_size(0));
+                slot->output_shape = session.output_shape(0);
+            } catch (...) {
+                slot->error = std::current_exception();
+            }
+            slot->infer_us = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+            emit_queue.push(slot);
+        }
+        emit_queue.close();
+    }
+
+    void emitLoop() {
+        while (Slot* slot = emit_queue.pop()) {
+            std::exception_ptr error = slot->error;
+            if (!error) {
+                try {
+                    callback({slot->frame, slot->output.data(), slot->output.size(), slot->output_shape, slot->started,
+                              slot->infer_us});
+                } catch (...) {
+                    error = std::current_exception();
+                }
+            }
+            if (error) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!first_error) first_error = error;
+            }
+            free_slots.push(slot);
+        }
+    }
+
+    void rethrowError() {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (first_error) std::rethrow_exception(first_error);
+    }
+
+    // Drain the submitted frames and join the stages
+    void shutdown() {
+        if (finished) return;
+        finished = true;
+        infer_queue.close();
+        if (infer_thread.joinable()) infer_thread.join();
+        if (emit_thread.joinable()) emit_thread.join();
+    }
+
+public:
+    // depth: frames in flight across the three stages, 3 lets every stage work on its own frame
+    InferencePipeline(OnnxSession& session, size_t sequence_length, size_t feature_dim, size_t depth, Callback callback)
+        : session(session),
+          input_shape{1, static_cast<int64_t>(sequence_length), static_cast<int64_t>(feature_dim)},
+          callback(std::move(callback)), slots(std::max<size_t>(depth, 1)) {
+        for (auto& slot : slots) {
+            slot.input.resize(sequence_length * feature_dim);
+            free_slots.push(&slot);
+        }
+        infer_thread = std::thread(&InferencePipeline::inferLoop, this);
+        emit_thread = std::thread(&InferencePipeline::emitLoop, this);
+    }
+
+    ~InferencePipeline() { shutdown(); }
+
+    InferencePipeline(const InferencePipeline&) = delete;
+    InferencePipeline& operator=(const InferencePipeline&) = delete;
+
+    // Input buffer of the next frame, [sequence_length x feature_dim]; blocks while every slot is in flight.
+    // Throws the error of an earlier frame instead, so the caller stops feeding a failing model.
+    float* acquire() {
+        rethrowError();
+        acquired = free_slots.pop();
+        return acquired->input.data();
+    }
+
+    // Hand the acquired frame to the inference stage
+    void submit(size_t frame, std::chrono::high_resolution_clock::time_point started) {
+        acquired->frame = frame;
+        acquired->started = started;
+        infer_queue.push(acquired);
+        acquired = nullptr;
+    }
+
+    // Complete every submitted frame and stop the stages; throws the first error of a run or the callback
+    void finish() {
+        shutdown();
+        rethrowError();
+    }
+};
+
+#endif // INFERENCE_PIPELINE_HPP
@@ -7,27 +7,70 @@
 #include <deque>
 #include <filesystem>
 #include <sstream>
+#include <cstdio>
 #include <chrono>
 #include <thread>
 #include <mutex>
+#include <memory>
+#include <atomic>
+#include <condition_variable>
+#include <sliding_window.hpp>
+#include <shm_ring.hpp>
+#include <segment_log.hpp>
+#include <socket_ingest.hpp>
+#include <unordered_map>
+#include <set>
+#ifdef __linux__
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#endif
 
 namespace fs = std::filesystem;
 
+// Follows log_0.csv, log_1.csv, ... in log_dir and keeps the newest `input_size` logs as one window.
+// On Linux the reader thread sleeps in poll() on an inotify watch (IN_CLOSE_WRITE / IN_MOVED_TO), so a log
+// is read as soon as its writer closes or renames it and an idle reader costs no CPU; only the log_N.csv
+// names reported by those events are read, never a file that is still open for writing. Elsewhere, or when
+// inotify is unavailable, it falls back to checking for the next file every 5 ms, which relies on the writer
+// renaming each log into place (log_writer does). Consumers block in
+// wait_for_new_data() on a condition variable instead of polling has_new_data().
+// A log_dir of "shm:<name>" reads samples from a ShmRingWriter's shared-memory ring instead of files, and
+// "segments:<dir>" tails a SegmentLogWriter's rotating segment files (woken by IN_MODIFY / IN_CREATE).
+// "udp:[host:]<port>" and "unix:<path>" receive datagrams of records in batches and keep one window per
+// pedestrian (the record's user); consume_ready() hands out every pedestrian with a new window.
 class LogReader {
 private:
     std::string log_dir;
-    std::deque<std::vector<float>> logs_deque;  // To store the most recent logs
+    SlidingWindow logs_window;                  // The most recent logs, contiguous [input_size x feature_dim]
     std::deque<std::string> file_buffer;        // Buffer for tracking log file names
     std::mutex data_mutex;  // Mutex to protect shared data access
+    std::condition_variable data_ready;  // Signalled when a full window has new data, and on stop
     bool new_data_flag;     // Flag to indicate if the newest data has been used
     std::thread reader_thread;
-    bool stop_thread;
+    std::atomic<bool> stop_thread;
+    int watch_fd = -1;      // inotify instance, -1 when polling
+    int wake_fd = -1;       // eventfd that interrupts poll() on stop and restore
+    std::string ring_name;  // Set for a shared-memory source
+    std::unique_ptr<SegmentLogReader> segments;  // Set for a segment log source
+    uint64_t segment_sessions = 0;               // Writer sessions replaced so far, to restart the window
+    std::string ingest_spec;                     // Set for a socket source
+
+    // Socket source: a window per pedestrian, and the pedestrians whose window has rows not handed out yet
+    struct PedestrianWindow {
+        SlidingWindow window;
+        bool fresh = false;
+    };
+    std::unordered_map<uint32_t, PedestrianWindow> pedestrian_windows;
+    std::vector<uint32_t> fresh_pedestrians;
+    std::set<int> completed_logs;  // Log indices whose close / rename event arrived, not read yet
     int input_size;         // Maximum number of logs to keep in the deque
     int newest_log_index;   // Keep track of the index of the newest log
 
-    // Internal method to read a single CSV log file
-    std::vector<float> read_log_file(const std::string& filename) {
-        std::vector<float> data;
+    // Internal method to read a single CSV log file into a window row of feature_dim floats
+    void read_log_file(const std::string& filename, float* data) {
+        std::fill(data, data + logs_window.cols(), 0.0f);
         std::ifstream file(filename);
         std::string line;
 
@@ -38,12 +81,11 @@ private:
         if (std::getline(file, line)) {
             std::stringstream ss(line);
             std::string value;
-            while (std::getline(ss, value, ',')) {
-                data.push_back(std::stof(value));  // Convert string to float and add to vector
+            size_t index = 0;
+            while (std::getline(ss, value, ',') && index < logs_window.cols()) {
+                data[index++] = std::stof(value);  // Convert string to float and add to vector
             }
         }
-
-        return data;
     }
 
     // Check if the next log file exists (e.g., log_1.csv, log_2.csv, etc.)
@@ -52,45 +94,249 @@ private:
         return fs::exists(new_log_file);
     }
 
-    // Thread method to monitor logs
-    void monitor_logs() {
-        while (!stop_thread) {
-            // Check if a new log file is available
-            if (is_new_log_available()) {
+    // Add one sample to the window; called with data_mutex held
+    void add_record(const SampleRecord& record) {
+        record.features(logs_window.next_row(), logs_window.cols());
+        logs_window.commit_row();
+        newest_log_index++;
+        if (logs_window.full()) new_data_flag = true;
+    }
+
+    // Every complete record appended since the last read; the end marker stops the reader
+    void read_available_records() {
+        SampleRecord record;
+        while (!stop_thread && segments->try_read(record)) {
+            if (record.flags & SampleRecord::END_OF_STREAM) {
+                stop();
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(data_mutex);
+                if (segments->sessions_replaced() != segment_sessions) {
+                    // A new writer took over the directory; its samples do not continue the old window
+                    segment_sessions = segments->sessions_replaced();
+                    logs_window.clear();
+                    new_data_flag = false;
+                }
+                add_record(record);
+            }
+            if (has_new_data()) data_ready.notify_all();
+        }
+    }
+
+    // Whether the next log is complete: reported by an event when watching, else present under its final name
+    bool next_log_ready(bool from_events) {
+        if (!from_events) return is_new_log_available();
+        while (!completed_logs.empty() && *completed_logs.begin() < newest_log_index) {
+            completed_logs.erase(completed_logs.begin());  // Read before the event arrived, or before a restore
+        }
+        return !completed_logs.empty() && *completed_logs.begin() == newest_log_index;
+    }
+
+    // Read every log that is ready, in index order
+    void read_available_logs(bool from_events = false) {
+        if (segments) {
+            read_available_records();
+            return;
+        }
+        while (!stop_thread && next_log_ready(from_events)) {
+            {
                 // Lock the mutex before modifying shared data
                 std::lock_guard<std::mutex> lock(data_mutex);
 
                 // Construct the file name for the new log
                 std::string new_log_file = log_dir + "/log_" + std::to_string(newest_log_index) + ".csv";
 
-                // Read the new log file and add to the deque
-                std::vector<float> log_data = read_log_file(new_log_file);
-                logs_deque.push_back(log_data);
+                // Read the new log file straight into the window, replacing the oldest log when full
+                read_log_file(new_log_file, logs_window.next_row());
+                logs_window.commit_row();
                 file_buffer.push_back(new_log_file);  // Track the log file in the buffer
 
                 // Increment the newest log index
                 newest_log_index++;
 
                 // Maintain fixed buffer size by popping the oldest log when necessary
-                if (logs_deque.size() > input_size) {
-                    logs_deque.pop_front();
+                if (file_buffer.size() > input_size) {
                     file_buffer.pop_front();  // Also remove from file buffer
                 }
 
                 // Set the new data flag
-                if (logs_deque.size() == input_size) {
+                if (logs_window.full()) {
                     new_data_flag = true;
                 }
             }
+            if (has_new_data()) data_ready.notify_all();
+        }
+    }
+
+    // Set up the inotify watch; false leaves the reader polling
+    bool watch_log_dir(const std::string& dir, bool appends) {
+#ifdef __linux__
+        watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (watch_fd < 0) return false;
+        // Log files are complete when closed or renamed into place; segments grow in place
+        uint32_t mask = appends ? IN_MODIFY | IN_CREATE : IN_CLOSE_WRITE | IN_MOVED_TO;
+        if (inotify_add_watch(watch_fd, dir.c_str(), mask) < 0) {
+            close(watch_fd);
+            watch_fd = -1;
+            return false;
+        }
+        wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd < 0) {
+            close(watch_fd);
+            watch_fd = -1;
+            return false;
+        }
+        return true;
+#else
+        (void)dir;
+        (void)appends;
+        return false;
+#endif
+    }
+
+    // Thread method for a shared-memory source: one window row per record, until the producer closes the ring
+    void monitor_ring() {
+        try {
+            bool replaced = true;
+            while (replaced && !stop_thread) {
+                ShmRingReader ring(ring_name);
+                SampleRecord record;
+                while (ring.pop(record, stop_thread)) {
+                    {
+                        std::lock_guard<std::mutex> lock(data_mutex);
+                        add_record(record);
+                    }
+                    if (has_new_data()) data_ready.notify_all();
+                }
+                // A producer that died left its ring unclosed; follow the one that replaced it, from an empty window
+                replaced = !ring.finished() && ring.replaced();
+                if (replaced) {
+                    std::cerr << "Shared memory ring " << ring.name() << " was replaced, reattaching" << std::endl;
+                    std::lock_guard<std::mutex> lock(data_mutex);
+                    logs_window.clear();
+                    new_data_flag = false;
+                }
+            }
+        } catch (const std::runtime_error& err) {
+            std::cerr << "Error reading shared memory: " << err.what() << std::endl;
+        }
+        stop();  // Release wait_for_new_data() once the stream is over
+    }
+
+    // Thread method for a socket source: route each received batch to the pedestrians' windows
+    void monitor_socket() {
+        try {
+            SocketIngest ingest(ingest_spec);
+            std::cout << "Receiving samples on " << ingest_spec << std::endl;
+            std::vector<SampleRecord> batch;
+            bool ended = false;
+            while (!stop_thread && !ended) {
+                batch.clear();
+                if (ingest.receive(batch) == 0) continue;
+                {
+                    std::lock_guard<std::mutex> lock(data_mutex);
+                    for (const SampleRecord& record : batch) {
+                        if (record.flags & SampleRecord::END_OF_STREAM) {
+                            ended = true;
+                            continue;
+                        }
+                        route_record(record);
+                    }
+                    new_data_flag = !fresh_pedestrians.empty();
+                }
+                if (has_new_data()) data_ready.notify_all();
+            }
+            const SocketIngest::Stats& stats = ingest.statistics();
+            std::cout << "Socket ingest: " << stats.records << " records in " << stats.datagrams << " datagrams, "
+                      << stats.receives << " receive calls, " << stats.malformed << " malformed datagrams dropped"
+                      << std::endl;
+        } catch (const std::runtime_error& err) {
+            std::cerr << "Error receiving samples: " << err.what() << std::endl;
+        }
+        stop();
+    }
+
+    // Called with data_mutex held
+    void route_record(const SampleRecord& record) {
+        auto it = pedestrian_windows.find(record.user);
+        if (it == pedestrian_windows.end()) {
+            PedestrianWindow created{SlidingWindow(logs_window.rows(), logs_window.cols())};
+            it = pedestrian_windows.emplace(record.user, std::move(created)).first;
+        }
+        PedestrianWindow& pedestrian = it->second;
+        record.features(pedestrian.window.next_row(), pedestrian.window.cols());
+        pedestrian.window.commit_row();
+        newest_log_index++;
+        if (pedestrian.window.full() && !pedestrian.fresh) {
+            pedestrian.fresh = true;
+            fresh_pedestrians.push_back(record.user);
+        }
+    }
+
+    // Thread method to monitor logs
+    void monitor_logs() {
+        if (!ingest_spec.empty()) {
+            monitor_socket();
+            return;
+        }
+        if (!ring_name.empty()) {
+            monitor_ring();
+            return;
+        }
+        if (watch_fd < 0) {
+            while (!stop_thread) {
+                read_available_logs();
+                // Sleep for a while before checking again
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            return;
+        }
+#ifdef __linux__
+        // Logs written before the watch existed raise no event
+        read_available_logs();
+        alignas(struct inotify_event) char events[4096];
+        pollfd fds[2] = {{watch_fd, POLLIN, 0}, {wake_fd, POLLIN, 0}};
+        while (!stop_thread) {
+            if (poll(fds, 2, -1) < 0) continue;  // EINTR
+            bool overflow = false;
+            ssize_t length;
+            while ((length = read(watch_fd, events, sizeof(events))) > 0) {
+                for (char* at = events; at < events + length;) {
+                    const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(at);
+                    at += sizeof(struct inotify_event) + event->len;
+                    if (event->mask & IN_Q_OVERFLOW) overflow = true;
+                    int index;
+                    int consumed = 0;
+                    if (event->len > 0 && std::sscanf(event->name, "log_%d.csv%n", &index, &consumed) == 1 &&
+                        event->name[consumed] == '\0' && index >= newest_log_index) {
+                        completed_logs.insert(index);
+                    }
+                }
+            }
+            uint64_t wakes;
+            bool restored = read(wake_fd, &wakes, sizeof(wakes)) > 0;
+            // Events were lost, or a restore moved the next index to logs that raised no event here: catch up
+            // with the logs present by name, as before the watch existed
+            read_available_logs(!overflow && !restored);
+        }
+#endif
+    }
 
-            // Sleep for a while before checking again
-            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    void wake_reader() {
+#ifdef __linux__
+        if (wake_fd >= 0) {
+            uint64_t one = 1;
+            if (write(wake_fd, &one, sizeof(one)) < 0) {}
         }
+#endif
     }
 
 public:
     // Constructor
-    LogReader(const std::string& directory) : log_dir(directory), new_data_flag(false), stop_thread(false), input_size(30), newest_log_index(0) {
+    LogReader(const std::string& directory, int input_size = 30, int feature_dim = 2)
+        : log_dir(directory), logs_window(input_size, feature_dim), new_data_flag(false), stop_thread(false),
+          input_size(input_size), newest_log_index(0) {
         // Check for existing logs and update newest_log_index
         // for (int i = 0; ; ++i) {
         //     std::string log_file = log_dir + "/log_" + std::to_string(i) + ".csv";
@@ -102,23 +348,122 @@ public:
         // }
         newest_log_index = 0; 
 
+        if (log_dir.rfind("udp:", 0) == 0 || log_dir.rfind("unix:", 0) == 0) {
+            ingest_spec = log_dir;
+        } else if (log_dir.rfind("shm:", 0) == 0) {
+            ring_name = log_dir.substr(4);
+        } else if (log_dir.rfind("segments:", 0) == 0) {
+            std::string segment_dir = log_dir.substr(9);
+            std::error_code error;
+            fs::create_directories(segment_dir, error);  // The writer may start later
+            segments = std::make_unique<SegmentLogReader>(segment_dir);
+            if (!watch_log_dir(segment_dir, true)) {
+                std::cerr << "Watching " << segment_dir << " by polling (inotify unavailable)" << std::endl;
+            }
+        } else if (!watch_log_dir(log_dir, false)) {
+            std::cerr << "Watching " << log_dir << " by polling (inotify unavailable)" << std::endl;
+        }
+
         // Start the thread for monitoring logs
         reader_thread = std::thread(&LogReader::monitor_logs, this);
     }
 
+    // True for shm:, segments:, udp: and unix: sources, false for a directory of log_N.csv files
+    static bool is_stream_source(const std::string& log_dir) {
+        for (const char* prefix : {"shm:", "segments:", "udp:", "unix:"}) {
+            if (log_dir.rfind(prefix, 0) == 0) return true;
+        }
+        return false;
+    }
+
     // Destructor to ensure thread is stopped properly
     ~LogReader() {
-        stop_thread = true;
+        stop();
         if (reader_thread.joinable()) {
             reader_thread.join();
         }
+#ifdef __linux__
+        if (watch_fd >= 0) close(watch_fd);
+        if (wake_fd >= 0) close(wake_fd);
+#endif
+    }
+
+    // Stop the reader thread and release every wait_for_new_data()
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(data_mutex);
+            stop_thread = true;
+        }
+        wake_reader();
+        data_ready.notify_all();
+    }
+
+    // Block until a full window has data that was not consumed yet; false once the reader is stopped
+    bool wait_for_new_data() {
+        std::unique_lock<std::mutex> lock(data_mutex);
+        data_ready.wait(lock, [this] { return new_data_flag || stop_thread; });
+        return new_data_flag;
     }
 
-    // Method to get the newest data and mark it as used
-    std::deque<std::vector<float>> _newest_data() {
+    // Hand the newest window to fn(const float* data, size_t rows, size_t cols) and mark it as used.
+    // The window is not copied: fn runs under the reader lock, so new logs wait until it returns.
+    template <typename Fn>
+    bool consume_newest(Fn&& fn) {
         std::lock_guard<std::mutex> lock(data_mutex);
+        if (!new_data_flag) return false;
         new_data_flag = false;  // Reset the flag once data is retrieved
-        return logs_deque;
+        fn(logs_window.data(), logs_window.size(), logs_window.cols());
+        return true;
+    }
+
+    // Hand every window with new data to fn(uint32_t pedestrian, const float* data, size_t rows, size_t cols),
+    // under the reader lock like consume_newest. Sources without pedestrians report pedestrian 0.
+    template <typename Fn>
+    size_t consume_ready(Fn&& fn) {
+        std::lock_guard<std::mutex> lock(data_mutex);
+        if (!new_data_flag) return 0;
+        new_data_flag = false;
+        if (ingest_spec.empty()) {
+            fn(0u, logs_window.data(), logs_window.size(), logs_window.cols());
+            return 1;
+        }
+        size_t handed = fresh_pedestrians.size();
+        for (uint32_t id : fresh_pedestrians) {
+            PedestrianWindow& pedestrian = pedestrian_windows.at(id);
+            pedestrian.fresh = false;
+            fn(id, pedestrian.window.data(), pedestrian.window.size(), pedestrian.window.cols());
+        }
+        fresh_pedestrians.clear();
+        return handed;
+    }
+
+    // Copy of the buffered logs, oldest first, for session snapshots
+    std::vector<float> window_copy(size_t& rows, size_t& cols) {
+        std::lock_guard<std::mutex> lock(data_mutex);
+        rows = logs_window.size();
+        cols = logs_window.cols();
+        return std::vector<float>(logs_window.data(), logs_window.data() + logs_window.element_count());
+    }
+
+    // Index of the next log file the reader waits for
+    int next_log_index() {
+        std::lock_guard<std::mutex> lock(data_mutex);
+        return newest_log_index;
+    }
+
+    // Resume from a session snapshot: restore the buffered logs (rows x cols, oldest first) and continue at next_index
+    void restore(const float* logs, size_t rows, size_t cols, int next_index) {
+        std::lock_guard<std::mutex> lock(data_mutex);
+        logs_window.clear();
+        std::vector<float> row(logs_window.cols(), 0.0f);
+        for (size_t i = rows > logs_window.rows() ? rows - logs_window.rows() : 0; i < rows; i++) {
+            std::copy(logs + i * cols, logs + i * cols + std::min(cols, row.size()), row.begin());
+            logs_window.push(row);
+        }
+        file_buffer.clear();
+        newest_log_index = next_index;
+        new_data_flag = false;
+        wake_reader();  // Logs from next_index on may already be there
     }
 
     // Method to check if new data is available
@@ -141,23 +486,18 @@ public:
 
 //     // Main loop to check for new data
 //     while (true) {
-//         // Check if new data is available
-//         if (log_reader.has_new_data()) {
-//             // Retrieve the newest data
-//             std::deque<std::vector<float>> new_data = log_reader._newest_data();
-
+//         // Check if new data is available and process the newest window
+//         log_reader.consume_newest([](const float* data, size_t rows, size_t cols) {
 //             // Process the new data (for demonstration, we'll just print the size)
-//             std::cout << "New data received! Number of logs: " << new_data.size() << std::endl;
+//             std::cout << "New data received! Number of logs: " << rows << std::endl;
 
 //             // Print the first log for demonstration
-//             if (!new_data.empty()) {
-//                 std::cout << "First log data: ";
-//                 for (float value : new_data.front()) {
-//                     std::cout << value << " ";
-//                 }
-//                 std::cout << std::endl;
+//             std::cout << "First log data: ";
+//             for (size_t i = 0; i < cols; i++) {
+//                 std::cout << data[i] << " ";
 //             }
-//         }
+//             std::cout << std::endl;
+//         });
 
 //         // Simulate doing something else
 //         std::this_thread::sleep_for(std::chrono::seconds(1));
@@ -6,6 +6,11 @@
 #include <thread>
 #include <chrono>
 #include <filesystem>
+#include <unordered_map>
+#include "argparse.hpp"
+#include <shm_ring.hpp>
+#include <segment_log.hpp>
+#include <socket_ingest.hpp>
 
 // Define a structure to hold each row's data
 struct UserData {
@@ -40,13 +45,14 @@ std::vector<UserData> read_csv(const std::string& filename) {
 // Function to write a log for each row into separate CSV files
 void write_logs(const std::vector<UserData>& data, const std::string& output_dir, int delay_ms) {
     // Create the output directory if it doesn't exist
-    std::__fs::filesystem::create_directories(output_dir);
+    std::filesystem::create_directories(output_dir);
 
     // Iterate over each row of data and write to a CSV file
     for (size_t i = 0; i < data.size(); ++i) {
-        // Construct the log file name
+        // Construct the log file name; the log is written under a temporary name and renamed into place,
+        // so a reader never sees log_N.csv half written
         std::string filename = output_dir + "/log_" + std::to_string(i) + ".csv";
-        std::ofstream log_file(filename);
+        std::ofstream log_file(filename + ".tmp");
 
         // Write the header (column names)
         log_file << "User_X,User_Y\n";
@@ -54,23 +60,209 @@ void write_logs(const std::vector<UserData>& data, const std::string& output_dir
         // Write the values of the current row
         log_file << data[i].User_X << "," << data[i].User_Y << "\n";
 
-        // Close the file
+        // Close the file and publish it
         log_file.close();
+        std::filesystem::rename(filename + ".tmp", filename);
 
         // Delay for the specified time (in milliseconds)
         std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
     }
 }
 
-int main() {
+// Read a CSV into sample records by column name; columns the file does not have stay zero
+std::vector<SampleRecord> read_records(const std::string& filename) {
+    std::vector<SampleRecord> records;
+    std::ifstream file(filename);
+    std::string line;
+    std::unordered_map<std::string, size_t> columns;
+    if (std::getline(file, line)) {
+        std::stringstream ss(line);
+        std::string name;
+        for (size_t i = 0; std::getline(ss, name, ','); i++) columns[name] = i;
+    }
+    auto column = [&](const char* name) {
+        auto it = columns.find(name);
+        return it == columns.end() ? -1 : static_cast<int>(it->second);
+    };
+    const int user_x = column("User_X"), user_y = column("User_Y"), gaze_x = column("GazeDirection_X"),
+              gaze_y = column("GazeDirection_Y"), gaze_z = column("GazeDirection_Z"), agv_x = column("AGV_X"),
+              agv_y = column("AGV_Y"), timestamp = column("TimestampID");
+
+    std::vector<std::string> values;
+    while (std::getline(file, line)) {
+        values.clear();
+        std::stringstream ss(line);
+        std::string value;
+        while (std::getline(ss, value, ',')) values.push_back(value);
+        auto field = [&](int index) {
+            return index >= 0 && index < static_cast<int>(values.size()) ? std::stof(values[index]) : 0.0f;
+        };
+
+        SampleRecord record;
+        record.timestamp = timestamp >= 0 ? static_cast<int64_t>(field(timestamp)) : static_cast<int64_t>(records.size());
+        record.user_x = field(user_x);
+        record.user_y = field(user_y);
+        record.gaze_x = field(gaze_x);
+        record.gaze_y = field(gaze_y);
+        record.gaze_z = field(gaze_z);
+        record.agv_x = field(agv_x);
+        record.agv_y = field(agv_y);
+        records.push_back(record);
+    }
+    return records;
+}
+
+// Stream the records through a shared-memory ring instead of one file per sample
+void write_ring(const std::vector<SampleRecord>& records, const std::string& ring_name, uint32_t capacity, int delay_ms) {
+    ShmRingWriter ring(ring_name, capacity);
+    std::cout << "Writing " << records.size() << " samples to shared memory " << ring.name() << " ("
+              << ring.capacity() << " slots)" << std::endl;
+    for (const auto& record : records) {
+        ring.push(record);  // Waits while the reader is a full ring behind
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+    }
+    ring.close();
+}
+
+// Append the records to one rotating segment log instead of one file per sample
+void write_segments(const std::vector<SampleRecord>& records, const std::string& dir, uint32_t records_per_segment,
+                    uint32_t keep_segments, int delay_ms) {
+    SegmentLogWriter log(dir, records_per_segment, keep_segments);
+    std::cout << "Writing " << records.size() << " samples to segments in " << dir << " (" << records_per_segment
+              << " records per segment, " << keep_segments << " kept)" << std::endl;
+    for (const auto& record : records) {
+        log.append(record);
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+    }
+    log.close();
+}
+
+// Stand-in simulator for the socket ingest: every sample goes out once per user, as one datagram per
+// time step carrying all users' records (split at RECORDS_PER_DATAGRAM)
+void send_records(const std::vector<SampleRecord>& records, const std::string& endpoint, uint32_t users, int delay_ms) {
+    SocketSender sender(endpoint);
+    std::cout << "Sending " << records.size() << " samples for " << users << " users to " << endpoint << std::endl;
+    std::vector<SampleRecord> step;
+    size_t failed = 0;
+    for (const auto& record : records) {
+        step.assign(users, record);
+        for (uint32_t user = 0; user < users; user++) step[user].user = user;
+        for (size_t first = 0; first < step.size(); first += SocketIngest::RECORDS_PER_DATAGRAM) {
+            size_t count = std::min(SocketIngest::RECORDS_PER_DATAGRAM, step.size() - first);
+            if (!sender.send(step.data() + first, count)) failed++;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+    }
+    SampleRecord end;
+    end.flags = SampleRecord::END_OF_STREAM;
+    if (!sender.send(&end)) failed++;
+    if (failed) std::cerr << failed << " datagrams could not be sent" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    argparse::ArgumentParser program("Log Writer");
+
+    program.add_argument("--input")
+        .help("CSV to replay as UE samples")
+        .default_value(std::string("/Users/shawn/Documents/UMSI/Boeing_Project/UE-integrated-pipeline/tra_pred_model_onnx/data/demo/feature_model/0.csv"));
+
+    program.add_argument("--output_dir")
+        .help("Directory for the log_N.csv files")
+        .default_value(std::string("./data/demo/feature_cvm/logs"));
+
+    program.add_argument("--delay_ms")
+        .help("Delay between samples, in milliseconds")
+        .default_value(20)
+        .scan<'i', int>();
+
+    program.add_argument("--shm")
+        .help("Write samples to this shared-memory ring (read with main_logsim --log_dir shm:<name>) instead of files")
+        .default_value(std::string(""));
+
+    program.add_argument("--shm_capacity")
+        .help("Slots in the shared-memory ring")
+        .default_value(1024)
+        .scan<'i', int>();
+
+    program.add_argument("--segments")
+        .help("Append samples to rotating segment files in this directory (read with main_logsim --log_dir segments:<dir>)")
+        .default_value(std::string(""));
+
+    program.add_argument("--segment_records")
+        .help("Samples per segment file")
+        .default_value(65536)
+        .scan<'i', int>();
+
+    program.add_argument("--keep_segments")
+        .help("Segment files kept on disk; older ones are deleted")
+        .default_value(4)
+        .scan<'i', int>();
+
+    program.add_argument("--send")
+        .help("Send samples as datagrams to udp:[host:]<port> or unix:<path> (main_logsim --log_dir with the same endpoint)")
+        .default_value(std::string(""));
+
+    program.add_argument("--users")
+        .help("Pedestrians to simulate when sending: every sample is sent once per user id")
+        .default_value(1)
+        .scan<'i', int>();
+
+    try {
+        program.parse_args(argc, argv);
+    } catch (const std::runtime_error& err) {
+        std::cout << err.what() << std::endl;
+        std::cout << program;
+        exit(0);
+    }
+
     // File path of the CSV
-    std::string input_file = "/Users/shawn/Documents/UMSI/Boeing_Project/UE-integrated-pipeline/tra_pred_model_onnx/data/demo/feature_model/0.csv";
+    std::string input_file = program.get<std::string>("--input");
 
     // Output directory for the log files
-    std::string output_dir = "./data/demo/feature_cvm/logs";
+    std::string output_dir = program.get<std::string>("--output_dir");
 
     // Delay between writing each log file (in milliseconds)
-    int delay_ms = 20;  // 1 second delay
+    int delay_ms = program.get<int>("--delay_ms");
+
+    std::string ring_name = program.get<std::string>("--shm");
+    if (!ring_name.empty()) {
+        try {
+            uint32_t capacity = static_cast<uint32_t>(std::max(program.get<int>("--shm_capacity"), 1));
+            write_ring(read_records(input_file), ring_name, capacity, delay_ms);
+        } catch (const std::exception& err) {
+            std::cerr << "Error writing shared memory: " << err.what() << std::endl;
+            exit(-1);
+        }
+        std::cout << "Samples have been written successfully!" << std::endl;
+        return 0;
+    }
+
+    std::string endpoint = program.get<std::string>("--send");
+    if (!endpoint.empty()) {
+        try {
+            send_records(read_records(input_file), endpoint, static_cast<uint32_t>(std::max(program.get<int>("--users"), 1)),
+                         delay_ms);
+        } catch (const std::exception& err) {
+            std::cerr << "Error sending samples: " << err.what() << std::endl;
+            exit(-1);
+        }
+        std::cout << "Samples have been sent successfully!" << std::endl;
+        return 0;
+    }
+
+    std::string segment_dir = program.get<std::string>("--segments");
+    if (!segment_dir.empty()) {
+        try {
+            write_segments(read_records(input_file), segment_dir,
+                           static_cast<uint32_t>(std::max(program.get<int>("--segment_records"), 1)),
+                           static_cast<uint32_t>(std::max(program.get<int>("--keep_segments"), 2)), delay_ms);
+        } catch (const std::exception& err) {
+            std::cerr << "Error writing segments: " << err.what() << std::endl;
+            exit(-1);
+        }
+        std::cout << "Samples have been written successfully!" << std::endl;
+        return 0;
+    }
 
     // Read data from the CSV file
     std::vector<UserData> data = read_csv(input_file);
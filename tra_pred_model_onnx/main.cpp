@@ -4,62 +4,151 @@
 #include <deque>
 #include <vector>
 #include <thread>
+#include <cstring>
+#include <cmath>
 #include "argparse.hpp"
 #include <onnxruntime/core/session/onnxruntime_cxx_api.h>
+#include "onnx_session.hpp"
+#include "batch_server.hpp"
+#include "model_pool.hpp"
+#include "inference_pipeline.hpp"
+#include "stateful_session.hpp"
+#include "model_reloader.hpp"
+#include <session_snapshot.hpp>
+#include <feature_extraction.hpp>
+#include <feature_schema.hpp>
+#include <inference_scheduler.hpp>
+#include <model_cascade.hpp>
+#include <cvm_predictor.hpp>
+#include <process_memory.hpp>
+#include <feature_session.hpp>
+#include "../fam/FiniteAutomationMachine.hpp"
+#include <sliding_window.hpp>
+#include <latency_stats.hpp>
+#include <backend_benchmark.hpp>
 
 
 class ModelRunner {
 private:
-    Ort::Env env;
-    Ort::SessionOptions session_options;
-    Ort::Session session;
-    std::vector<std::string> input_node_names;
-    std::vector<std::string> output_node_names;
+    std::unique_ptr<OnnxSession> session;
+    std::unique_ptr<StatefulSession> stateful;  // Set for past_* / present_* exports: one timestep per frame
     std::string filename;
     int feature_dim;
-    std::deque<std::vector<float>> buffer;
+    SlidingWindow buffer;        // Latest `capacity` rows, contiguous for the input tensor
     size_t capacity;
     int cnt = 0;
+    size_t lines_read = 0;       // Data lines consumed from the file, restored on resume
+    std::string snapshot_path;
+    size_t snapshot_interval = 0;
+    std::unique_ptr<PredictionSink> sink = std::make_unique<StdoutPredictionSink>();
+    TrajectoryPrediction prediction;  // Decoded in place every frame
+
+    // Raw input: rows go through feature extraction and the column mapping, no feature CSV in between
+    std::unique_ptr<FeatureAssembler> assembler;
+    Row prev_row;
+    bool has_prev_row = false;
+    WaitTimeState wait_state;
+
+    // FAM-gated scheduling of raw input: the FAM state picks how often the model runs
+    std::unique_ptr<InferenceScheduler> scheduler;
+    std::unique_ptr<FiniteAutomationMachine> fam;
+    bool schedule_eval = false;        // Also run the model on reused frames to measure their error
+    TrajectoryPrediction reference;    // The model's prediction on a reused frame, when evaluating
+
+    // Model hot swap: a changed model file is loaded in the background and swapped in between frames,
+    // optionally after a shadow period in which it runs next to the current model
+    std::unique_ptr<ModelReloader> reloader;
+    std::unique_ptr<OnnxSession> candidate;
+    size_t shadow_frames = 0;
+    size_t shadow_left = 0;
+    double shadow_max_diff = 0.0;
+    double shadow_sum_diff = 0.0;
+    size_t shadow_values = 0;
     
 
 public:
-    ModelRunner(const std::string& model_path, const std::string& filename, int feature_dim, size_t capacity)
-        : filename(filename), feature_dim(feature_dim), capacity(capacity),
-          env(ORT_LOGGING_LEVEL_WARNING, "ModelRunner"),
-          session_options(), session(nullptr) {
-        // Set session options if needed
-        session_options.SetIntraOpNumThreads(1);
-
+    ModelRunner(const std::string& model_path, const std::string& filename, int feature_dim, size_t capacity,
+                const OnnxSessionOptions& session_options = OnnxSessionOptions())
+        : filename(filename), feature_dim(feature_dim), buffer(capacity, feature_dim), capacity(capacity) {
         // Load the model
         try {
-            session = Ort::Session(env, model_path.c_str(), session_options);
-
-            // Get input and output node names
-            size_t num_input_nodes = session.GetInputCount();
-            size_t num_output_nodes = session.GetOutputCount();
-            Ort::AllocatorWithDefaultOptions allocator;
-
-            // Get input node names
-            for (size_t i = 0; i < num_input_nodes; i++) {
-                Ort::AllocatedStringPtr input_name = session.GetInputNameAllocated(i, allocator);
-                input_node_names.push_back(input_name.get());
-            }
-
-            // Get output node names
-            for (size_t i = 0; i < num_output_nodes; i++) {
-                Ort::AllocatedStringPtr output_name = session.GetOutputNameAllocated(i, allocator);
-                output_node_names.push_back(output_name.get());
-            }
-
+            session = std::make_unique<OnnxSession>(model_path, session_options);
             std::cout << "Model loaded successfully." << std::endl;
+            session->startup_timing().print(std::cout);
+            if (StatefulSession::isStateful(*session)) {
+                stateful = std::make_unique<StatefulSession>(*session, feature_dim);
+                std::cout << "Stateful model: " << stateful->state_count() << " state tensors, one timestep per frame."
+                          << std::endl;
+            }
         } catch (const Ort::Exception& exception) {
             std::cerr << "Error loading the model: " << exception.what() << std::endl;
             exit(-1);
+        } catch (const std::runtime_error& err) {
+            std::cerr << "Error loading the model: " << err.what() << std::endl;
+            exit(-1);
+        }
+    }
+
+    bool is_stateful() const { return stateful != nullptr; }
+
+    // Watch model_path and swap a changed model in between frames. With shadow > 0 the new model first runs on
+    // that many frames next to the current one, which keeps serving, and the output differences are reported.
+    void watchModel(const std::string& model_path, const OnnxSessionOptions& options, std::chrono::milliseconds interval,
+                    size_t shadow) {
+        reloader = std::make_unique<ModelReloader>(model_path, options, capacity, feature_dim, interval);
+        shadow_frames = shadow;
+    }
+
+    // Between frames: pick up a session the reloader has ready
+    void checkModelUpdate() {
+        if (!reloader) return;
+        std::unique_ptr<OnnxSession> next = reloader->take();
+        if (!next) return;
+        // A stateful model's carried state would differ between the two; swap those directly
+        if (shadow_frames == 0 || stateful || StatefulSession::isStateful(*next)) {
+            adoptSession(std::move(next));
+            return;
         }
+        candidate = std::move(next);
+        shadow_left = shadow_frames;
+        shadow_max_diff = shadow_sum_diff = 0.0;
+        shadow_values = 0;
+        std::cout << "Shadowing the new model for " << shadow_frames << " frames" << std::endl;
     }
 
-    std::vector<float> convertLineToVector(const std::string& line) {
-        std::vector<float> vec(feature_dim, 0.0f);
+    // Replace the session. The input window is kept, a stateful model rebuilds its state from it.
+    void adoptSession(std::unique_ptr<OnnxSession> next) {
+        stateful.reset();
+        session = std::move(next);
+        if (StatefulSession::isStateful(*session)) {
+            stateful = std::make_unique<StatefulSession>(*session, feature_dim);
+            for (size_t row = 0; row < buffer.size(); row++) stateful->step(prediction.pedestrian, buffer.row(row));
+        }
+        std::cout << "Swapped in the new model after " << this->cnt << " predictions" << std::endl;
+    }
+
+    // Run the shadow model on the window the current model just predicted from
+    void shadowCompare(const std::vector<int64_t>& input_shape) {
+        candidate->run(buffer.data(), input_shape);
+        size_t n = std::min(candidate->output_size(0), session->output_size(0));
+        const float* current = session->output(0);
+        const float* next = candidate->output(0);
+        for (size_t i = 0; i < n; i++) {
+            double diff = std::abs(static_cast<double>(current[i]) - next[i]);
+            shadow_max_diff = std::max(shadow_max_diff, diff);
+            shadow_sum_diff += diff;
+        }
+        shadow_values += n;
+        if (--shadow_left > 0) return;
+        std::cout << "Shadow period done: max abs diff " << shadow_max_diff << ", mean abs diff "
+                  << (shadow_values ? shadow_sum_diff / shadow_values : 0.0) << " over " << shadow_frames << " frames"
+                  << std::endl;
+        adoptSession(std::move(candidate));
+    }
+
+    // Parse a CSV line straight into the next window slot
+    void convertLineToRow(const std::string& line, float* vec) {
+        std::fill(vec, vec + feature_dim, 0.0f);
         std::stringstream ss(line);
         std::string item;
         int index = 0;
@@ -71,61 +160,204 @@ public:
                 vec[index++] = 0.0f; // Handle error by setting to zero
             }
         }
-        return vec;
     }
 
     void feedModel() {
+        if (stateful) {
+            // Every row advances the carried state; predictions start once a window's worth has been seen,
+            // like the windowed model
+            stateful->step(prediction.pedestrian, buffer.row(buffer.size() - 1));
+            if (stateful->steps(prediction.pedestrian) < capacity) return;
+            prediction.frame = this->cnt++;
+            decodePrediction(*stateful, 0, prediction);
+            sink->write(prediction);
+            return;
+        }
         if (buffer.size() < capacity) return;
 
-        size_t batch_size = buffer.size();
-        size_t input_tensor_size = batch_size * feature_dim;
-        std::vector<float> input_tensor_values;
-        input_tensor_values.reserve(input_tensor_size);
+        size_t batch_size = 1;  // One pedestrian; cross-pedestrian batching goes through processFileBatched
+
+        // Input shape must be [batch_size, sequence_length, feature_dim]
+        std::vector<int64_t> input_shape = {static_cast<int64_t>(batch_size), static_cast<int64_t>(buffer.size()), feature_dim};
+
+        // Run the model on the bound window; outputs land in the session's preallocated buffers
+        session->run(buffer.data(), input_shape);
 
-        for (const auto& vec : buffer) {
-            input_tensor_values.insert(input_tensor_values.end(), vec.begin(), vec.end());
+        prediction.frame = this->cnt++;
+        decodePrediction(*session, 0, prediction);
+        sink->write(prediction);
+        if (candidate) shadowCompare(input_shape);
+    }
+
+    void updateBuffer(const std::vector<float>& newVector) {
+        buffer.push(newVector);  // Overwrites the oldest row once the window is full
+    }
+
+    // Feed raw rows (User_X, ..., TimestampID) instead of feature rows. schema_path is a schema file or a feature
+    // CSV; empty takes the column order from the model metadata. trip_start / trip_end are the pedestrian's
+    // station ids for the start_station / end_station columns, -1 leaves them at zero.
+    void setFeatureSchema(const std::string& schema_path, int trip_start, int trip_end, size_t rolling_window) {
+        FeatureSchema schema = schema_path.empty() ? modelFeatureSchema(*session) : loadFeatureSchema(schema_path);
+        if (schema.size() != static_cast<size_t>(feature_dim)) {
+            throw std::runtime_error("Feature schema has " + std::to_string(schema.size()) + " columns, the model takes " +
+                                     std::to_string(feature_dim));
         }
+        assembler = std::make_unique<FeatureAssembler>(schema, rolling_window);
+        if (trip_start >= 0 && trip_end >= 0) assembler->setTrip(trip_start, trip_end);
+    }
 
-        std::vector<int64_t> input_shape = {static_cast<int64_t>(batch_size), feature_dim};
+    // One raw frame: extract its features, write them into the next window slot in model column order, predict
+    void feedRow(Row row) {
+        Features features = extract_features(row, has_prev_row ? &prev_row : nullptr);
+        assembler->applyTrip(features);
+        update_wait_time(features, wait_state);
+        assembler->write(features, &row, buffer.next_row());
+        buffer.commit_row();
+        prev_row = std::move(row);
+        has_prev_row = true;
+        if (scheduler) {
+            fam->run(features);
+            feedScheduled(features, stateIdFromName(fam->getCurrentStateName()));
+        } else {
+            feedModel();
+        }
+    }
 
-        Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-        Ort::Value input_tensor = Ort::Value::CreateTensor<float>(
-            memory_info, input_tensor_values.data(), input_tensor_size, input_shape.data(), input_shape.size());
+    // Run the model only on the frames the scheduler picks; the others reuse the last prediction
+    void setSchedule(const SchedulePolicy& policy, bool evaluate) {
+        if (stateful) {
+            throw std::runtime_error("Stateful models need every frame, they cannot be scheduled");
+        }
+        scheduler = std::make_unique<InferenceScheduler>(policy);
+        fam = std::make_unique<FiniteAutomationMachine>(Features());
+        schedule_eval = evaluate;
+    }
 
-        // Prepare input and output node names
-        const char* input_names[] = {input_node_names[0].c_str()};
-        const char* output_names[] = {output_node_names[0].c_str()};
+    void feedScheduled(const Features& features, uint8_t state_id) {
+        if (!buffer.full()) return;
+        std::vector<int64_t> input_shape = {1, static_cast<int64_t>(buffer.size()), feature_dim};
+        bool infer = scheduler->shouldInfer(prediction.pedestrian, state_id, features.User_speed,
+                                            features.possible_interaction);
+        if (infer) {
+            session->run(buffer.data(), input_shape);
+            decodePrediction(*session, 0, prediction);
+            scheduler->record(prediction);
+            // The shadow period counts the frames the current model actually ran on
+            if (candidate) shadowCompare(input_shape);
+        } else {
+            scheduler->reuse(prediction.pedestrian, prediction);
+            if (schedule_eval) {
+                session->run(buffer.data(), input_shape);
+                decodePrediction(*session, 0, reference);
+                scheduler->evaluate(prediction, reference);
+            }
+        }
+        prediction.frame = this->cnt++;
+        sink->write(prediction);
+    }
 
-        // Run the model
-        auto output_tensors = session.Run(
-            Ort::RunOptions{nullptr}, input_names, &input_tensor, 1, output_names, 1);
+    void processRawFile(const std::string& spec_filename) {
+        auto start = std::chrono::high_resolution_clock::now();
 
-        // Get output tensor
-        float* output_data = output_tensors[0].GetTensorMutableData<float>();
+        std::string effectiveFilename = spec_filename.empty() ? this->filename : spec_filename;
+        std::cout << "Processing raw file: " << effectiveFilename << std::endl;
+        std::ifstream file(effectiveFilename);
+        std::string line;
+        std::vector<std::string> headers;
+        if (std::getline(file, line)) {
+            std::stringstream header_stream(line);
+            std::string header;
+            while (std::getline(header_stream, header, ',')) headers.push_back(header);
+        }
 
-        // Get output shape
-        Ort::TensorTypeAndShapeInfo output_info = output_tensors[0].GetTensorTypeAndShapeInfo();
-        std::vector<int64_t> output_shape = output_info.GetShape();
+        // Skip the lines already consumed before a resume
+        for (size_t i = 0; i < lines_read && std::getline(file, line); i++) {}
 
-        // Output the shape and data
-        std::cout << "Model output " << this->cnt + 1 << ": ";
-        this->cnt++;
-        for (auto s : output_shape) std::cout << s << " ";
-        std::cout << std::endl;
+        while (std::getline(file, line)) {
+            checkModelUpdate();
+            feedRow(parseCSVLine(line, headers));
+            lines_read++;
+            if (!snapshot_path.empty() && snapshot_interval > 0 && lines_read % snapshot_interval == 0) {
+                saveSnapshot(snapshot_path);
+            }
+        }
+        if (!snapshot_path.empty()) {
+            saveSnapshot(snapshot_path);
+        }
+        sink->flush();
+        if (scheduler) scheduler->report().print(std::cout);
+
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+        std::cout << "\n\n";
+        std::cout << "Elapsed time: " << elapsed.count() << " seconds." << std::endl;
+        std::cout << "Processed " << this->cnt << " lines." << std::endl;
+        std::cout << "Speed: " << this->cnt / elapsed.count() << " lines per second.\n\n" << std::endl;
+    }
+
+    // Where predictions go: "stdout" (default), "none", "csv:<path>" or "bin:<path>"
+    void setOutput(const std::string& spec) {
+        sink = makePredictionSink(spec);
+    }
 
-        size_t output_size = output_info.GetElementCount();
-        std::cout << "Output data: ";
-        for (size_t i = 0; i < output_size; i++) {
-            std::cout << output_data[i] << " ";
+    // Write a session snapshot every `interval` lines (0 = only when the file is done)
+    void setSnapshot(const std::string& path, size_t interval) {
+        snapshot_path = path;
+        snapshot_interval = interval;
+    }
+
+    void saveSnapshot(const std::string& path) {
+        SessionSnapshot snapshot;
+        PedestrianSnapshot ped;
+        ped.window_rows = static_cast<uint32_t>(buffer.size());
+        ped.window_cols = static_cast<uint32_t>(feature_dim);
+        ped.window.assign(buffer.data(), buffer.data() + buffer.element_count());
+        ped.source_offset = lines_read;
+        if (assembler) {
+            // Raw input also carries the previous row (speeds) and the wait-time flags between frames
+            ped.has_prev_row = has_prev_row;
+            if (has_prev_row) ped.prev_row = RowState::fromRow(prev_row);
+            ped.has_wait_time = true;
+            ped.wait_time = wait_state;
         }
-        std::cout << std::endl;
+        if (fam) {
+            ped.has_fam = true;
+            ped.fam = fam->snapshot();
+        }
+        snapshot.pedestrians.push_back(std::move(ped));
+        writeSessionSnapshot(path, snapshot);
     }
 
-    void updateBuffer(const std::vector<float>& newVector) {
-        if (buffer.size() >= capacity) {
-            buffer.pop_front();  // Remove the oldest vector if we are at capacity
+    // Restore the input window and file position, so the first line after the snapshot is predicted
+    // without waiting for the window to fill again. In raw mode (after setFeatureSchema / setSchedule) the
+    // previous row, wait-time flags and FAM state are restored too.
+    void restoreSnapshot(const std::string& path) {
+        auto start = std::chrono::high_resolution_clock::now();
+        SessionSnapshot snapshot = readSessionSnapshot(path);
+        if (snapshot.pedestrians.empty()) return;
+        const PedestrianSnapshot& ped = snapshot.pedestrians.front();
+        if (ped.window_cols != static_cast<uint32_t>(feature_dim)) {
+            throw std::runtime_error("Snapshot feature dimension does not match the model");
+        }
+        buffer.clear();
+        for (size_t row = 0; row < ped.window_rows; row++) {
+            buffer.push(ped.window.data() + row * ped.window_cols);
+        }
+        lines_read = ped.source_offset;
+        if (ped.has_prev_row) {
+            prev_row = ped.prev_row.toRow();
+            has_prev_row = true;
+        }
+        if (ped.has_wait_time) wait_state = ped.wait_time;
+        if (ped.has_fam && fam) fam->restore(ped.fam);
+        if (stateful) {
+            // The carried state is not in the snapshot; rebuild it from the restored window
+            stateful->reset(prediction.pedestrian);
+            for (size_t row = 0; row < buffer.size(); row++) stateful->step(prediction.pedestrian, buffer.row(row));
         }
-        buffer.push_back(newVector);  // Add the new vector to the buffer
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::high_resolution_clock::now() - start;
+        std::cout << "Resumed at line " << lines_read << " with " << buffer.size() << " buffered rows in "
+                  << elapsed.count() << " us" << std::endl;
     }
 
     void processFile(const std::string& spec_filename) {
@@ -137,11 +369,23 @@ public:
         std::string line;
         if (std::getline(file, line)) {} // Optionally handle header
 
+        // Skip the lines already consumed before a resume
+        for (size_t i = 0; i < lines_read && std::getline(file, line); i++) {}
+
         while (std::getline(file, line)) {
-            auto vec = convertLineToVector(line);
-            updateBuffer(vec);    // Update the buffer with each new line
+            checkModelUpdate();
+            convertLineToRow(line, buffer.next_row());
+            buffer.commit_row();  // Update the buffer with each new line
             feedModel();          // Run the model on every new line
+            lines_read++;
+            if (!snapshot_path.empty() && snapshot_interval > 0 && lines_read % snapshot_interval == 0) {
+                saveSnapshot(snapshot_path);
+            }
+        }
+        if (!snapshot_path.empty()) {
+            saveSnapshot(snapshot_path);
         }
+        sink->flush();
 
         auto end = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double> elapsed = end - start;
@@ -151,6 +395,382 @@ public:
         std::cout << "Speed: " << this->cnt / elapsed.count() << " lines per second.\n\n" << std::endl;
     }
 
+    // Offline re-scoring of a whole recorded session: every sliding window of the file, in order, run as
+    // [batch_windows, sequence_length, feature_dim] batches so the session's intra-op pool has enough work
+    // per call to keep all cores busy
+    void processFileOffline(const std::string& spec_filename, size_t batch_windows) {
+        auto start = std::chrono::high_resolution_clock::now();
+        std::string effectiveFilename = spec_filename.empty() ? this->filename : spec_filename;
+        std::cout << "Processing file offline: " << effectiveFilename << ", " << batch_windows << " windows per batch"
+                  << std::endl;
+
+        FeatureSession recording(effectiveFilename, feature_dim);
+        auto parsed = std::chrono::high_resolution_clock::now();
+        size_t windows = recording.window_count(capacity);
+        std::vector<float> batch(batch_windows * capacity * feature_dim);
+
+        double gather_seconds = 0.0, model_seconds = 0.0;
+        size_t batches = 0;
+        for (size_t first = 0; first < windows; first += batch_windows) {
+            size_t count = std::min(batch_windows, windows - first);
+            auto gather_start = std::chrono::high_resolution_clock::now();
+            recording.gatherWindows(first, count, capacity, batch.data());
+            auto run_start = std::chrono::high_resolution_clock::now();
+            session->run(batch.data(), {static_cast<int64_t>(count), static_cast<int64_t>(capacity), feature_dim});
+            auto run_end = std::chrono::high_resolution_clock::now();
+            gather_seconds += std::chrono::duration<double>(run_start - gather_start).count();
+            model_seconds += std::chrono::duration<double>(run_end - run_start).count();
+            batches++;
+
+            for (size_t i = 0; i < count; i++) {
+                prediction.frame = this->cnt++;
+                decodePrediction(*session, i, prediction);
+                sink->write(prediction);
+            }
+        }
+        sink->flush();
+
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+        std::cout << "\n\n";
+        std::cout << "Elapsed time: " << elapsed.count() << " seconds." << std::endl;
+        std::cout << "Processed " << windows << " windows of " << recording.row_count() << " rows in " << batches
+                  << " batches." << std::endl;
+        std::cout << "Parse " << std::chrono::duration<double>(parsed - start).count() << " s, gather "
+                  << gather_seconds << " s, model " << model_seconds << " s." << std::endl;
+        std::cout << "Speed: " << windows / elapsed.count() << " windows per second.\n\n" << std::endl;
+    }
+
+    // Pipelined processFile: the model runs on frame t on its own thread while this thread parses frame t+1,
+    // and a third stage prints frame t-1. Outputs are printed in frame order.
+    void processFilePipelined(const std::string& spec_filename, size_t depth) {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        std::string effectiveFilename = spec_filename.empty() ? this->filename : spec_filename;
+        std::cout << "Processing file: " << effectiveFilename << " (pipelined, depth " << depth << ")" << std::endl;
+        std::ifstream file(effectiveFilename);
+        std::string line;
+        if (std::getline(file, line)) {} // Optionally handle header
+
+        LatencyStats parse_latency, infer_latency, emit_latency, frame_latency;
+        InferencePipeline pipeline(*session, capacity, feature_dim, depth, [&](const InferencePipeline::Completion& done) {
+            auto emit_start = std::chrono::high_resolution_clock::now();
+            prediction.frame = static_cast<int64_t>(done.frame);
+            decodeTrajectory(done.output, done.output_shape, 0, prediction);
+            sink->write(prediction);
+            auto emit_end = std::chrono::high_resolution_clock::now();
+            infer_latency.add(done.infer_us);
+            emit_latency.add(std::chrono::duration<double, std::micro>(emit_end - emit_start).count());
+            frame_latency.add(std::chrono::duration<double, std::micro>(emit_end - done.started).count());
+        });
+
+        size_t frames = 0;
+        while (true) {
+            auto parse_start = std::chrono::high_resolution_clock::now();
+            if (!std::getline(file, line)) break;
+            convertLineToRow(line, buffer.next_row());
+            buffer.commit_row();
+            lines_read++;
+            if (!buffer.full()) continue;
+            parse_latency.add(std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - parse_start).count());
+            float* input = pipeline.acquire();  // Waits while `depth` frames are in flight
+            std::memcpy(input, buffer.data(), buffer.element_count() * sizeof(float));
+            pipeline.submit(frames++, parse_start);
+        }
+        pipeline.finish();
+        sink->flush();
+        this->cnt = static_cast<int>(frames);
+
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+        std::cout << "\n\n";
+        std::cout << "Elapsed time: " << elapsed.count() << " seconds." << std::endl;
+        std::cout << "Processed " << this->cnt << " lines." << std::endl;
+        std::cout << "Speed: " << this->cnt / elapsed.count() << " lines per second." << std::endl;
+        std::cout << "Stage means: parse " << parse_latency.mean() << " us, infer " << infer_latency.mean() << " us, emit "
+                  << emit_latency.mean() << " us (sum " << parse_latency.mean() + infer_latency.mean() + emit_latency.mean()
+                  << " us, frame interval " << (this->cnt ? elapsed.count() * 1e6 / this->cnt : 0.0) << " us)" << std::endl;
+        std::cout << "Frame latency: ";
+        frame_latency.print(std::cout);
+        std::cout << "\n\n" << std::endl;
+    }
+
+    // Run this model and a second variant (e.g. the INT8 build of the same model) on the same windows and
+    // report their latency, throughput and how far the candidate's predictions drift from this model's
+    void processFileCompare(const std::string& spec_filename, const std::string& compare_model_path,
+                            const OnnxSessionOptions& session_options) {
+        std::unique_ptr<OnnxSession> candidate;
+        try {
+            candidate = std::make_unique<OnnxSession>(compare_model_path, session_options);
+            std::cout << "Comparison model loaded successfully." << std::endl;
+            candidate->startup_timing().print(std::cout);
+        } catch (const Ort::Exception& exception) {
+            std::cerr << "Error loading the comparison model: " << exception.what() << std::endl;
+            exit(-1);
+        }
+
+        std::string effectiveFilename = spec_filename.empty() ? this->filename : spec_filename;
+        std::cout << "Comparing on file: " << effectiveFilename << std::endl;
+        std::ifstream file(effectiveFilename);
+        std::string line;
+        std::getline(file, line);  // Header
+
+        std::vector<int64_t> input_shape = {1, static_cast<int64_t>(capacity), feature_dim};
+        LatencyStats reference_latency, candidate_latency;
+        double max_abs = 0.0, sum_abs = 0.0, sum_ade = 0.0, sum_fde = 0.0, max_fde = 0.0;
+        size_t values = 0, windows = 0;
+        bool warmed_up = false;
+
+        while (std::getline(file, line)) {
+            convertLineToRow(line, buffer.next_row());
+            buffer.commit_row();
+            if (!buffer.full()) continue;
+
+            if (!warmed_up) {
+                // The first run of a shape also sizes the outputs, keep it out of the latency figures
+                session->run(buffer.data(), input_shape);
+                candidate->run(buffer.data(), input_shape);
+                warmed_up = true;
+            }
+
+            auto start = std::chrono::high_resolution_clock::now();
+            session->run(buffer.data(), input_shape);
+            auto middle = std::chrono::high_resolution_clock::now();
+            candidate->run(buffer.data(), input_shape);
+            auto end = std::chrono::high_resolution_clock::now();
+            reference_latency.add(std::chrono::duration<double, std::micro>(middle - start).count());
+            candidate_latency.add(std::chrono::duration<double, std::micro>(end - middle).count());
+
+            const float* expected = session->output(0);
+            const float* actual = candidate->output(0);
+            size_t output_size = std::min(session->output_size(0), candidate->output_size(0));
+            for (size_t i = 0; i < output_size; i++) {
+                double diff = std::abs(static_cast<double>(expected[i]) - actual[i]);
+                max_abs = std::max(max_abs, diff);
+                sum_abs += diff;
+            }
+            values += output_size;
+
+            // [.., steps, 2] outputs are trajectories: average and final displacement between the two
+            const std::vector<int64_t>& shape = session->output_shape(0);
+            if (!shape.empty() && shape.back() == 2 && output_size >= 2) {
+                size_t steps = output_size / 2;
+                double ade = 0.0, fde = 0.0;
+                for (size_t k = 0; k < steps; k++) {
+                    fde = std::hypot(expected[2 * k] - actual[2 * k], expected[2 * k + 1] - actual[2 * k + 1]);
+                    ade += fde;
+                }
+                sum_ade += ade / steps;
+                sum_fde += fde;
+                max_fde = std::max(max_fde, fde);
+            }
+            windows++;
+        }
+
+        if (windows == 0) {
+            std::cout << "No full window in " << effectiveFilename << ", nothing to compare." << std::endl;
+            return;
+        }
+        double reference_seconds = reference_latency.total() / 1e6, candidate_seconds = candidate_latency.total() / 1e6;
+        std::cout << "\n\n";
+        std::cout << "Compared " << windows << " windows." << std::endl;
+        std::cout << "Reference latency: ";
+        reference_latency.print(std::cout);
+        std::cout << ", " << windows / reference_seconds << " windows per second" << std::endl;
+        std::cout << "Candidate latency: ";
+        candidate_latency.print(std::cout);
+        std::cout << ", " << windows / candidate_seconds << " windows per second" << std::endl;
+        std::cout << "Speedup: " << reference_seconds / candidate_seconds << "x" << std::endl;
+        std::cout << "Prediction delta: max abs " << max_abs << ", mean abs " << sum_abs / std::max<size_t>(values, 1)
+                  << ", ADE " << sum_ade / windows << ", FDE " << sum_fde / windows << ", max FDE " << max_fde
+                  << "\n\n" << std::endl;
+    }
+
+    // Replay the file as `num_pedestrians` concurrent pedestrians, each with its own window, and serve
+    // their predictions through one BatchServer
+    void processFileBatched(const std::string& spec_filename, size_t num_pedestrians, size_t max_batch_size,
+                            std::chrono::microseconds max_queue_delay) {
+        std::string effectiveFilename = spec_filename.empty() ? this->filename : spec_filename;
+        std::cout << "Processing file: " << effectiveFilename << " as " << num_pedestrians << " pedestrians, max batch "
+                  << max_batch_size << ", max queue delay " << max_queue_delay.count() << " us" << std::endl;
+
+        std::vector<std::string> lines;
+        {
+            std::ifstream file(effectiveFilename);
+            std::string line;
+            std::getline(file, line);  // Header
+            while (std::getline(file, line)) lines.push_back(line);
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        BatchServer server(*session, capacity, feature_dim, max_batch_size, max_queue_delay);
+        std::vector<size_t> predictions(num_pedestrians, 0);
+        std::vector<std::thread> pedestrians;
+        std::mutex sink_mutex;
+        for (size_t p = 0; p < num_pedestrians; p++) {
+            pedestrians.emplace_back([&, p] {
+                SlidingWindow window(capacity, feature_dim);
+                TrajectoryPrediction pedestrian_prediction;
+                pedestrian_prediction.pedestrian = static_cast<uint32_t>(p);
+                for (const auto& line : lines) {
+                    convertLineToRow(line, window.next_row());
+                    window.commit_row();
+                    if (!window.full()) continue;
+                    // Each pedestrian waits for its prediction before taking the next frame
+                    BatchServer::Result result = server.submit(static_cast<uint32_t>(p), window.data()).get();
+                    pedestrian_prediction.frame = static_cast<int64_t>(predictions[p]++);
+                    decodePrediction(result, 0, pedestrian_prediction);
+                    std::lock_guard<std::mutex> lock(sink_mutex);
+                    sink->write(pedestrian_prediction);
+                }
+            });
+        }
+        for (auto& pedestrian : pedestrians) pedestrian.join();
+        server.stop();
+        sink->flush();
+
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+        const BatchServer::Stats& stats = server.statistics();
+        size_t total = 0;
+        for (size_t count : predictions) total += count;
+        this->cnt = static_cast<int>(total);
+
+        std::cout << "\n\n";
+        std::cout << "Elapsed time: " << elapsed.count() << " seconds." << std::endl;
+        std::cout << "Processed " << total << " windows in " << stats.batches << " batches ("
+                  << (stats.batches ? static_cast<double>(stats.requests) / stats.batches : 0.0) << " per batch, "
+                  << stats.full_batches << " full)." << std::endl;
+        std::cout << "Model time: " << stats.run_seconds << " seconds." << std::endl;
+        std::cout << "Speed: " << total / elapsed.count() << " windows per second.\n\n" << std::endl;
+    }
+
+    // Crowd replay through the CVM-first cascade: every pedestrian gets the native CVM prediction and only the
+    // escalated ones go to the model, together, in batches of up to max_batch_size. With `evaluate` the model
+    // also runs on the CVM-served frames to report how far the CVM was from it there.
+    void processFileCascade(const std::string& spec_filename, size_t num_pedestrians, size_t max_batch_size,
+                            const FeatureSchema& schema, const CascadePolicy& policy, bool evaluate) {
+        std::string effectiveFilename = spec_filename.empty() ? this->filename : spec_filename;
+        std::cout << "Processing file: " << effectiveFilename << " as " << num_pedestrians
+                  << " pedestrians through the CVM cascade, max batch " << max_batch_size << std::endl;
+
+        std::vector<std::string> lines;
+        {
+            std::ifstream file(effectiveFilename);
+            std::string line;
+            std::getline(file, line);  // Header
+            while (std::getline(file, line)) lines.push_back(line);
+        }
+
+        const size_t T = capacity, F = static_cast<size_t>(feature_dim);
+        CvmPredictor cvm;
+        const size_t H = cvm.output_horizon();
+        CascadeMonitor monitor(schema, policy);
+        CascadeReport report;
+
+        // Pedestrians start at staggered lines so the crowd is not in lockstep
+        std::vector<SlidingWindow> windows(num_pedestrians, SlidingWindow(T, F));
+        std::vector<size_t> first_line(num_pedestrians);
+        for (size_t p = 0; p < num_pedestrians; p++) first_line[p] = lines.size() / 2 * p / num_pedestrians;
+
+        std::vector<size_t> ready, escalated, served;
+        std::vector<float> positions(num_pedestrians * T * 2), cvm_output(cvm.output_size(num_pedestrians));
+        std::vector<float> batch(max_batch_size * T * F);
+        std::vector<int64_t> cvm_shape = {0, static_cast<int64_t>(H), 2};
+        TrajectoryPrediction reference;
+
+        // Model runs over ready[indices], max_batch_size windows at a time; emit(j, i) sees sample j of each run.
+        // Evaluation runs are not part of the cascade's cost and stay out of the report.
+        auto runModel = [&](const std::vector<size_t>& indices, bool counted, const std::function<void(size_t, size_t)>& emit) {
+            for (size_t first = 0; first < indices.size(); first += max_batch_size) {
+                size_t count = std::min(max_batch_size, indices.size() - first);
+                for (size_t j = 0; j < count; j++) {
+                    std::memcpy(batch.data() + j * T * F, windows[ready[indices[first + j]]].data(), T * F * sizeof(float));
+                }
+                auto model_start = std::chrono::high_resolution_clock::now();
+                session->run(batch.data(), {static_cast<int64_t>(count), static_cast<int64_t>(T), static_cast<int64_t>(F)});
+                if (counted) {
+                    report.model_seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - model_start).count();
+                    report.model_batches++;
+                }
+                for (size_t j = 0; j < count; j++) emit(j, indices[first + j]);
+            }
+        };
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t tick = 0;; tick++) {
+            bool active = false;
+            ready.clear();
+            for (size_t p = 0; p < num_pedestrians; p++) {
+                size_t line = first_line[p] + tick;
+                if (line >= lines.size()) continue;
+                active = true;
+                convertLineToRow(lines[line], windows[p].next_row());
+                windows[p].commit_row();
+                if (windows[p].full()) ready.push_back(p);
+            }
+            if (!active) break;
+            if (ready.empty()) continue;
+
+            auto cvm_start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < ready.size(); i++) {
+                monitor.positions(windows[ready[i]].data(), T, F, positions.data() + i * T * 2);
+            }
+            cvm.predict(positions.data(), ready.size(), T, 2, cvm_output.data());
+            report.cvm_seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - cvm_start).count();
+            cvm_shape[0] = static_cast<int64_t>(ready.size());
+
+            escalated.clear();
+            served.clear();
+            for (size_t i = 0; i < ready.size(); i++) {
+                uint32_t pedestrian = static_cast<uint32_t>(ready[i]);
+                EscalationReason reason = monitor.update(pedestrian, positions.data() + i * T * 2, T,
+                                                         windows[ready[i]].row(T - 1), cvm_output.data() + i * H * 2, H);
+                report.record(reason);
+                if (reason != EscalationReason::None) {
+                    escalated.push_back(i);
+                    continue;
+                }
+                served.push_back(i);
+                prediction.pedestrian = pedestrian;
+                prediction.frame = static_cast<int64_t>(tick);
+                decodeTrajectory(cvm_output.data(), cvm_shape, i, prediction);
+                decodeVqOutputs(nullptr, nullptr, prediction);
+                sink->write(prediction);
+            }
+
+            runModel(escalated, true, [&](size_t j, size_t i) {
+                prediction.pedestrian = static_cast<uint32_t>(ready[i]);
+                prediction.frame = static_cast<int64_t>(tick);
+                decodePrediction(*session, j, prediction);
+                sink->write(prediction);
+            });
+
+            if (evaluate) {
+                runModel(served, false, [&](size_t j, size_t i) {
+                    decodePrediction(*session, j, reference);
+                    decodeTrajectory(cvm_output.data(), cvm_shape, i, prediction);
+                    auto [ade, fde] = trajectoryError(prediction, reference);
+                    report.evaluated++;
+                    report.ade_sum += ade;
+                    report.fde_sum += fde;
+                });
+            }
+        }
+        sink->flush();
+
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+        this->cnt = static_cast<int>(report.frames);
+        std::cout << "\n\n";
+        std::cout << "Elapsed time: " << elapsed.count() << " seconds." << std::endl;
+        std::cout << "Processed " << report.frames << " windows." << std::endl;
+        report.print(std::cout);
+        std::cout << "Speed: " << report.frames / elapsed.count() << " windows per second.\n\n" << std::endl;
+    }
+
+    const OnnxSession& model() const { return *session; }
+
     void start(const std::string& filename = "") {
         this->cnt = 0;
         std::thread worker(&ModelRunner::processFile, this, filename);
@@ -158,6 +778,61 @@ public:
     }
 };
 
+// Serve the file's windows from model pools of 1..max_replicas replicas (or max_replicas only) and report
+// throughput and tail latency per pool size. Two closed-loop clients per replica keep every replica busy.
+void runPoolScaling(const std::string& model_path, const std::string& file_path, size_t sequence_length, int feature_dim,
+                    size_t max_replicas, size_t cores_per_replica, bool scaling, size_t repeats,
+                    const OnnxSessionOptions& session_options) {
+    std::vector<float> windows = loadFeatureWindows(file_path, sequence_length, feature_dim);
+    size_t window_size = sequence_length * feature_dim;
+    size_t num_windows = windows.size() / window_size;
+    if (num_windows == 0) {
+        std::cout << "No full window in " << file_path << std::endl;
+        return;
+    }
+    std::cout << "Pool benchmark on " << num_windows << " windows x " << repeats << " passes, " << cores_per_replica
+              << " cores per replica, " << hardwareCores() << " cores available" << std::endl;
+
+    for (size_t replicas = scaling ? 1 : max_replicas; replicas <= max_replicas; replicas++) {
+        ModelPool::Options options;
+        options.replicas = replicas;
+        options.cores_per_replica = cores_per_replica;
+        options.session = session_options;
+        ModelPool pool(model_path, feature_dim, options);
+
+        // Warm up every replica so first-run output sizing stays out of the figures
+        std::vector<std::future<std::vector<float>>> warmup;
+        for (size_t i = 0; i < replicas * 2; i++) warmup.push_back(pool.submit(windows.data(), sequence_length));
+        for (auto& future : warmup) future.get();
+
+        size_t clients = replicas * 2;
+        std::vector<LatencyStats> latencies(clients);
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::thread> threads;
+        for (size_t c = 0; c < clients; c++) {
+            threads.emplace_back([&, c] {
+                for (size_t pass = 0; pass < repeats; pass++) {
+                    for (size_t w = c; w < num_windows; w += clients) {
+                        auto sent = std::chrono::high_resolution_clock::now();
+                        pool.submit(windows.data() + w * window_size, sequence_length).get();
+                        latencies[c].add(std::chrono::duration<double, std::micro>(
+                            std::chrono::high_resolution_clock::now() - sent).count());
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+        LatencyStats latency;
+        for (const auto& client : latencies) latency.merge(client);
+        std::cout << replicas << " replicas (" << pool.pinned_replicas() << " pinned): "
+                  << latency.count() / elapsed.count() << " windows per second, ";
+        latency.print(std::cout);
+        std::cout << std::endl;
+    }
+}
+
 int main(int argc, char** argv) {
     argparse::ArgumentParser program("FAM Benchmarking Program");
 
@@ -167,7 +842,7 @@ int main(int argc, char** argv) {
         .default_value(std::string("data/demo/feature_model/0.csv"));
 
     program.add_argument("-b", "--batch_size")
-        .help("Size of bach for processing")
+        .help("Window length (sequence length) fed to the model")
         .default_value(40)
         .scan<'i', size_t>(); // Scanning as size_t; 
 
@@ -180,6 +855,177 @@ int main(int argc, char** argv) {
         .default_value(32)
         .scan<'i', int>();
 
+    program.add_argument("--num_pedestrians")
+        .help("Replay the file as this many concurrent pedestrians through the batching server")
+        .default_value(1)
+        .scan<'i', int>();
+
+    program.add_argument("--max_batch_size")
+        .help("Most windows packed into one model run")
+        .default_value(1)
+        .scan<'i', int>();
+
+    program.add_argument("--max_queue_delay_us")
+        .help("Longest a window waits for its batch to fill, in microseconds")
+        .default_value(2000)
+        .scan<'i', int>();
+
+    program.add_argument("--intra_op_threads")
+        .help("Intra-op threads of the ONNX Runtime session")
+        .default_value(1)
+        .scan<'i', int>();
+
+    program.add_argument("--model_cache_dir")
+        .help("Directory for the optimized model cache, defaults to the model's directory")
+        .default_value(std::string(""));
+
+    program.add_argument("--no_model_cache")
+        .help("Optimize the model on every start instead of using the optimized model cache")
+        .flag();
+
+    program.add_argument("--mmap_model")
+        .help("Load the model from a shared read-only memory map, so processes running the same model share its pages "
+              "(weights only when they are external, see externalize_model.py)")
+        .flag();
+
+    program.add_argument("--pipelined")
+        .help("Run inference on its own thread while the next line is parsed")
+        .flag();
+
+    program.add_argument("--pipeline_depth")
+        .help("Frames in flight in pipelined mode")
+        .default_value(3)
+        .scan<'i', int>();
+
+    program.add_argument("--pool_replicas")
+        .help("Serve the file from a pool of this many pinned model replicas and report throughput and latency")
+        .default_value(0)
+        .scan<'i', int>();
+
+    program.add_argument("--cores_per_replica")
+        .help("Cores (and ORT intra-op threads) per pool replica")
+        .default_value(1)
+        .scan<'i', int>();
+
+    program.add_argument("--scaling_bench")
+        .help("Run the pool benchmark for every replica count from 1 to --pool_replicas")
+        .flag();
+
+    program.add_argument("--pool_repeats")
+        .help("Passes over the file per pool benchmark")
+        .default_value(5)
+        .scan<'i', int>();
+
+    program.add_argument("--offline")
+        .help("Re-score the whole file in large batches of sliding windows, using every core")
+        .flag();
+
+    program.add_argument("--offline_batch")
+        .help("Windows per model call in offline mode")
+        .default_value(256)
+        .scan<'i', int>();
+
+    program.add_argument("--compare_model_path")
+        .help("Run this second model (e.g. model.int8.onnx) on the same windows and report latency and prediction deltas")
+        .default_value(std::string(""));
+
+    program.add_argument("--output")
+        .help("Prediction output: stdout, none, csv:<path> or bin:<path>")
+        .default_value(std::string("stdout"));
+
+    program.add_argument("--raw_input")
+        .help("The file holds raw rows (User_X, ..., TimestampID); extract features and map them into the model input")
+        .flag();
+
+    program.add_argument("--feature_schema")
+        .help("Model input columns for --raw_input and --cascade: a schema file (name[,mean,std] per line) or a feature CSV; "
+              "defaults to the model's feature_columns metadata, else the feature_model layout")
+        .default_value(std::string(""));
+
+    program.add_argument("--trip")
+        .help("Start and end station ids of the pedestrian for --raw_input, e.g. 1,2")
+        .default_value(std::string(""));
+
+    program.add_argument("--rolling_window")
+        .help("Frames in the rolling_avg column for --raw_input")
+        .default_value(35)
+        .scan<'i', int>();
+
+    program.add_argument("--schedule")
+        .help("With --raw_input, run the FAM and infer only every n-th frame while the pedestrian is calm, "
+              "reusing the last prediction in between")
+        .flag();
+
+    program.add_argument("--moving_stride")
+        .help("Frames per model run while walking along the sidewalk or to the target station")
+        .default_value(2)
+        .scan<'i', int>();
+
+    program.add_argument("--stationary_stride")
+        .help("Frames per model run while At Station or Wait and not moving")
+        .default_value(10)
+        .scan<'i', int>();
+
+    program.add_argument("--stationary_speed")
+        .help("User_speed below which a pedestrian counts as not moving")
+        .default_value(0.1)
+        .scan<'g', double>();
+
+    program.add_argument("--schedule_eval")
+        .help("Also run the model on reused frames and report the error the schedule introduces")
+        .flag();
+
+    program.add_argument("--cascade")
+        .help("Predict every pedestrian with the native CVM and run the model only for escalated ones; "
+              "uses --num_pedestrians and --max_batch_size")
+        .flag();
+
+    program.add_argument("--cascade_residual")
+        .help("CVM miss (position units, 10 frames ahead) that escalates a pedestrian")
+        .default_value(100.0)
+        .scan<'g', double>();
+
+    program.add_argument("--cascade_agv_distance")
+        .help("AGV distance (feature units) below which a pedestrian is escalated")
+        .default_value(5.0)
+        .scan<'g', double>();
+
+    program.add_argument("--cascade_heading_deg")
+        .help("Turn of the walking direction, in degrees, that escalates a pedestrian")
+        .default_value(30.0)
+        .scan<'g', double>();
+
+    program.add_argument("--cascade_eval")
+        .help("Also run the model on CVM-served frames and report the CVM's distance to it")
+        .flag();
+
+    program.add_argument("--watch_model")
+        .help("Reload the model in the background when its file changes and swap it in between frames")
+        .flag();
+
+    program.add_argument("--watch_interval_ms")
+        .help("How often the model file is checked for changes")
+        .default_value(500)
+        .scan<'i', int>();
+
+    program.add_argument("--shadow_frames")
+        .help("Run a reloaded model next to the current one for this many frames before swapping, 0 to swap at once")
+        .default_value(0)
+        .scan<'i', int>();
+
+    program.add_argument("--snapshot_path")
+        .help("Write a session snapshot (input window and file position; raw input adds the previous row, wait-time and FAM state) to this file")
+        .default_value(std::string(""));
+
+    program.add_argument("--snapshot_interval")
+        .help("Lines between snapshots, 0 to snapshot only at the end")
+        .default_value(0)
+        .scan<'i', int>();
+
+    program.add_argument("--resume")
+        .help("Restore the input window and file position from a session snapshot")
+        .default_value(std::string(""));
+
     try {
         program.parse_args(argc, argv);
     } catch (const std::runtime_error& err) {
@@ -195,10 +1041,147 @@ int main(int argc, char** argv) {
     int feature_dim = program.get<int>("--feature_dim");
 
 
+    OnnxSessionOptions session_options;
+    session_options.intra_op_threads = program.get<int>("--intra_op_threads");
+    session_options.model_cache_dir = program.get<std::string>("--model_cache_dir");
+    session_options.use_model_cache = !program.get<bool>("--no_model_cache");
+    session_options.mmap_model = program.get<bool>("--mmap_model");
+    if (program.get<bool>("--offline") && !program.is_used("--intra_op_threads")) {
+        session_options.intra_op_threads = static_cast<int>(hardwareCores());  // Offline mode owns the machine
+    }
+
+    int pool_replicas = program.get<int>("--pool_replicas");
+    if (pool_replicas > 0) {
+        try {
+            runPoolScaling(model_path, file_path, batch_size, feature_dim, pool_replicas,
+                           std::max(program.get<int>("--cores_per_replica"), 1), program.get<bool>("--scaling_bench"),
+                           std::max(program.get<int>("--pool_repeats"), 1), session_options);
+        } catch (const std::exception& err) {
+            std::cerr << "Error in pool benchmark: " << err.what() << std::endl;
+            exit(-1);
+        }
+        return 0;
+    }
+
+    ResidentMemory memory_before_load = residentMemory();
     ModelRunner runner(model_path,
                        file_path,
                        feature_dim, // Feature dimension
-                       batch_size); // Capacity or batch size
+                       batch_size, // Capacity or batch size
+                       session_options);
+    memory_before_load.print(std::cout, "before model load");
+    residentMemory().print(std::cout, "after model load");
+
+    try {
+        runner.setOutput(program.get<std::string>("--output"));
+    } catch (const std::runtime_error& err) {
+        std::cerr << err.what() << std::endl;
+        exit(-1);
+    }
+    if (program.get<bool>("--watch_model")) {
+        runner.watchModel(model_path, session_options,
+                          std::chrono::milliseconds(std::max(program.get<int>("--watch_interval_ms"), 1)),
+                          std::max(program.get<int>("--shadow_frames"), 0));
+    }
+    runner.setSnapshot(program.get<std::string>("--snapshot_path"), program.get<int>("--snapshot_interval"));
+    bool raw_input = program.get<bool>("--raw_input");
+    if (raw_input) {
+        try {
+            int trip_start = -1, trip_end = -1;
+            std::string trip = program.get<std::string>("--trip");
+            if (!trip.empty()) {
+                std::vector<std::string> stations = splitSchemaList(trip);
+                if (stations.size() != 2) throw std::runtime_error("--trip takes <start>,<end>");
+                trip_start = std::stoi(stations[0]);
+                trip_end = std::stoi(stations[1]);
+            }
+            runner.setFeatureSchema(program.get<std::string>("--feature_schema"), trip_start, trip_end,
+                                    std::max(program.get<int>("--rolling_window"), 1));
+            if (program.get<bool>("--schedule")) {
+                SchedulePolicy policy;
+                policy.moving_stride = std::max(program.get<int>("--moving_stride"), 1);
+                policy.stationary_stride = std::max(program.get<int>("--stationary_stride"), 1);
+                policy.stationary_speed = program.get<double>("--stationary_speed");
+                runner.setSchedule(policy, program.get<bool>("--schedule_eval"));
+            }
+        } catch (const std::exception& err) {
+            std::cerr << "Error in raw input setup: " << err.what() << std::endl;
+            exit(-1);
+        }
+    }
+
+    std::string resume_path = program.get<std::string>("--resume");
+    if (!resume_path.empty()) {
+        try {
+            runner.restoreSnapshot(resume_path);
+        } catch (const std::runtime_error& err) {
+            std::cerr << "Error resuming session: " << err.what() << std::endl;
+            exit(-1);
+        }
+    }
+
+    if (raw_input) {
+        runner.processRawFile(file_path);
+        return 0;
+    }
+
+    bool windowed_mode = !program.get<std::string>("--compare_model_path").empty() || program.get<bool>("--pipelined") ||
+                         program.get<int>("--num_pedestrians") > 1 || program.get<int>("--max_batch_size") > 1 ||
+                         program.get<bool>("--cascade") || program.get<bool>("--offline");
+    if (runner.is_stateful() && windowed_mode) {
+        std::cerr << "Stateful models run in the streaming mode only (no compare, pipelined, batched, cascade or offline mode)" << std::endl;
+        exit(-1);
+    }
+
+    if (program.get<bool>("--offline")) {
+        try {
+            runner.processFileOffline(file_path, std::max(program.get<int>("--offline_batch"), 1));
+        } catch (const std::exception& err) {
+            std::cerr << "Error in offline mode: " << err.what() << std::endl;
+            exit(-1);
+        }
+        return 0;
+    }
+
+    std::string compare_model_path = program.get<std::string>("--compare_model_path");
+    if (!compare_model_path.empty()) {
+        runner.processFileCompare(file_path, compare_model_path, session_options);
+        return 0;
+    }
+
+    if (program.get<bool>("--pipelined")) {
+        try {
+            runner.processFilePipelined(file_path, std::max(program.get<int>("--pipeline_depth"), 1));
+        } catch (const std::exception& err) {
+            std::cerr << "Error in pipelined mode: " << err.what() << std::endl;
+            exit(-1);
+        }
+        return 0;
+    }
+
+    int num_pedestrians = program.get<int>("--num_pedestrians");
+    int max_batch_size = program.get<int>("--max_batch_size");
+    if (program.get<bool>("--cascade")) {
+        try {
+            std::string schema_path = program.get<std::string>("--feature_schema");
+            FeatureSchema schema = schema_path.empty() ? modelFeatureSchema(runner.model()) : loadFeatureSchema(schema_path);
+            CascadePolicy policy;
+            policy.residual_threshold = static_cast<float>(program.get<double>("--cascade_residual"));
+            policy.agv_distance = static_cast<float>(program.get<double>("--cascade_agv_distance"));
+            policy.heading_change_deg = static_cast<float>(program.get<double>("--cascade_heading_deg"));
+            runner.processFileCascade(file_path, std::max(num_pedestrians, 1), std::max(max_batch_size, 1), schema,
+                                      policy, program.get<bool>("--cascade_eval"));
+        } catch (const std::runtime_error& err) {
+            std::cerr << "Error in cascade: " << err.what() << std::endl;
+            exit(-1);
+        }
+        return 0;
+    }
+    if (num_pedestrians > 1 || max_batch_size > 1) {
+        runner.processFileBatched(file_path, std::max(num_pedestrians, 1), std::max(max_batch_size, 1),
+                                  std::chrono::microseconds(program.get<int>("--max_queue_delay_us")));
+        return 0;
+    }
 
     runner.start(file_path);
     return 0;
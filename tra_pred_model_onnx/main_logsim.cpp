@@ -4,136 +4,184 @@
 #include <deque>
 #include <vector>
 #include <thread>
+#include <cmath>
 #include "argparse.hpp"
 #include <onnxruntime/core/session/onnxruntime_cxx_api.h>
+#include "onnx_backend.hpp"
 #include "log_reader.hpp"
+#include <session_snapshot.hpp>
+#include <inference_backend.hpp>
+#include <process_memory.hpp>
 
 class ModelRunner {
 private:
-    Ort::Env env;
-    Ort::SessionOptions session_options;
-    Ort::Session session;
-    std::vector<std::string> input_node_names;
-    std::vector<std::string> output_node_names;
+    std::unique_ptr<InferenceBackend> model;   // The selected backend
+    std::unique_ptr<OnnxBackend> reference;    // ONNX model the native backend is validated against
+    std::unique_ptr<WindowPredictor> predictor;
+    std::unique_ptr<WindowPredictor> reference_predictor;
+    TrajectoryPrediction reference_prediction;
     int feature_dim;
-    std::deque<std::vector<float>> buffer;
     size_t capacity;
     int cnt = 0;
     LogReader log_reader;
+    std::string backend;
+    bool validate_backend = false;
+    double predict_ns = 0.0;          // Total time in the backend
+    double max_validation_diff = 0.0;
     int processed_lines = 0;
     std::chrono::duration<double> elapsed;
-    
+    std::string snapshot_path;
+    size_t snapshot_interval = 0;
+    std::unique_ptr<PredictionSink> sink = std::make_unique<StdoutPredictionSink>();
+    TrajectoryPrediction prediction;  // Decoded in place every frame
     
 
 public:
-    ModelRunner(const std::string& model_path, int feature_dim, size_t capacity, const std::string& log_dir)
-        : feature_dim(feature_dim), capacity(capacity), log_reader(log_dir),
-          env(ORT_LOGGING_LEVEL_WARNING, "ModelRunner"),
-          session_options(), session(nullptr) {
-        // Set session options if needed
-        session_options.SetIntraOpNumThreads(1);
-
-        // Load the model
-        try {
-            session = Ort::Session(env, model_path.c_str(), session_options);
-
-            // Get input and output node names
-            size_t num_input_nodes = session.GetInputCount();
-            size_t num_output_nodes = session.GetOutputCount();
-            Ort::AllocatorWithDefaultOptions allocator;
-
-            // Get input node names
-            for (size_t i = 0; i < num_input_nodes; i++) {
-                Ort::AllocatedStringPtr input_name = session.GetInputNameAllocated(i, allocator);
-                input_node_names.push_back(input_name.get());
-            }
+    ModelRunner(const std::string& model_path, int feature_dim, size_t capacity, const std::string& log_dir,
+                const OnnxSessionOptions& session_options = OnnxSessionOptions(),
+                const std::string& backend = "onnx", bool validate_backend = false)
+        : feature_dim(feature_dim), capacity(capacity), log_reader(log_dir, capacity, feature_dim),
+          backend(backend), validate_backend(validate_backend) {
+        if (backend == "cvm-native") {
+            model = std::make_unique<CvmBackend>();
+            std::cout << "Using the native constant-velocity backend." << std::endl;
+        } else if (backend != "onnx") {
+            std::cerr << "Unknown backend: " << backend << std::endl;
+            exit(-1);
+        }
 
-            // Get output node names
-            for (size_t i = 0; i < num_output_nodes; i++) {
-                Ort::AllocatedStringPtr output_name = session.GetOutputNameAllocated(i, allocator);
-                output_node_names.push_back(output_name.get());
+        // Load the model; with the native backend it is only needed as the reference
+        if (backend == "onnx" || validate_backend) {
+            try {
+                auto onnx = std::make_unique<OnnxBackend>(model_path, session_options);
+                std::cout << "Model loaded successfully." << std::endl;
+                onnx->onnx_session().startup_timing().print(std::cout);
+                if (backend == "onnx") {
+                    model = std::move(onnx);
+                } else {
+                    reference = std::move(onnx);
+                    reference_predictor = std::make_unique<WindowPredictor>(*reference, feature_dim);
+                }
+            } catch (const Ort::Exception& exception) {
+                std::cerr << "Error loading the model: " << exception.what() << std::endl;
+                exit(-1);
             }
-
-            std::cout << "Model loaded successfully." << std::endl;
-        } catch (const Ort::Exception& exception) {
-            std::cerr << "Error loading the model: " << exception.what() << std::endl;
-            exit(-1);
         }
+        predictor = std::make_unique<WindowPredictor>(*model, feature_dim);
     }
 
     void feedModel() {
         printf("Checking for new data\n");
-        if (!log_reader.has_new_data()) return;
+        if (!log_reader.has_new_data()) {
+            sink->flush();  // Idle: push buffered predictions out
+            return;
+        }
         printf("New data available\n");
         auto start = std::chrono::high_resolution_clock::now();
-        
-        size_t batch_size = 1;  // Add a batch dimension of 1
 
-        buffer = log_reader._newest_data();
+        // The reader's windows are already contiguous, the tensor is created directly over them. A socket
+        // source can have several pedestrians with a new window.
+        size_t windows = log_reader.consume_ready(
+            [this](uint32_t pedestrian, const float* window, size_t sequence_length, size_t) {
+                prediction.pedestrian = pedestrian;
+                runWindow(window, sequence_length);
+            });
+        if (windows == 0) return;
 
-        size_t sequence_length = buffer.size();
-        size_t input_tensor_size = batch_size * sequence_length * feature_dim;
-        std::vector<float> input_tensor_values;
-        input_tensor_values.reserve(input_tensor_size);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed_this = end - start;
+        this->elapsed += elapsed_this;
+        size_t before = static_cast<size_t>(this->processed_lines);
+        this->processed_lines += static_cast<int>(windows);
 
-        for (const auto& vec : buffer) {
-            input_tensor_values.insert(input_tensor_values.end(), vec.begin(), vec.end());
+        if (!snapshot_path.empty() && snapshot_interval > 0 &&
+            before / snapshot_interval != static_cast<size_t>(this->processed_lines) / snapshot_interval) {
+            saveSnapshot(snapshot_path);
         }
+    }
 
-        // Correct input shape must be [batch_size, sequence_length, feature_dim]
-        std::vector<int64_t> input_shape = {static_cast<int64_t>(batch_size), static_cast<int64_t>(sequence_length), feature_dim};
-
-        Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-        Ort::Value input_tensor = Ort::Value::CreateTensor<float>(
-            memory_info, input_tensor_values.data(), input_tensor_size, input_shape.data(), input_shape.size());
-
-        // Prepare input and output node names
-        const char* input_names[] = {input_node_names[0].c_str()};
-        const char* output_names[] = {output_node_names[0].c_str()};
-
-        auto output_tensors = session.Run(
-            Ort::RunOptions{nullptr}, input_names, &input_tensor, 1, output_names, 1);
+    // One [1, sequence_length, feature_dim] window through the selected backend; the window is read in place
+    void runWindow(const float* window, size_t sequence_length) {
+        auto start = std::chrono::high_resolution_clock::now();
+        prediction.frame = this->cnt++;
+        predictor->predict(window, sequence_length, prediction);
+        predict_ns += std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count();
+        sink->write(prediction);
 
-        // Get output tensor
-        float* output_data = output_tensors[0].GetTensorMutableData<float>();
+        if (reference) validateNative(window, sequence_length);
+    }
 
-        // Get output shape
-        Ort::TensorTypeAndShapeInfo output_info = output_tensors[0].GetTensorTypeAndShapeInfo();
-        std::vector<int64_t> output_shape = output_info.GetShape();
+    // Run the ONNX model on the same window and check the native prediction against it
+    void validateNative(const float* window, size_t sequence_length) {
+        reference_predictor->predict(window, sequence_length, reference_prediction);
+        const float* expected = reference_predictor->output();
+        const float* native_output = predictor->output();
+        if (reference_predictor->output_size() != predictor->output_size()) {
+            std::cerr << "Validation failed: ONNX output has " << reference_predictor->output_size()
+                      << " values, native has " << predictor->output_size() << std::endl;
+            exit(-1);
+        }
+        double max_diff = 0.0;
+        for (size_t i = 0; i < predictor->output_size(); i++) {
+            double diff = std::abs(static_cast<double>(expected[i]) - native_output[i]);
+            // Float rounding differs between the telescoped and the averaged velocity
+            if (diff > 1e-2 + 1e-5 * std::abs(expected[i])) {
+                std::cerr << "Validation failed at output " << i << ": ONNX " << expected[i] << ", native "
+                          << native_output[i] << std::endl;
+                exit(-1);
+            }
+            max_diff = std::max(max_diff, diff);
+        }
+        max_validation_diff = std::max(max_validation_diff, max_diff);
+        std::cout << "Validated against ONNX, max abs diff " << max_diff << std::endl;
+    }
 
-        // Output the shape and data
-        std::cout << "Model output " << this->cnt + 1 << ": ";
-        this->cnt++;
-        for (auto s : output_shape) std::cout << s << " ";
-        std::cout << std::endl;
+    // Where predictions go: "stdout" (default), "none", "csv:<path>" or "bin:<path>"
+    void setOutput(const std::string& spec) {
+        sink = makePredictionSink(spec);
+    }
 
-        size_t output_size = output_info.GetElementCount();
-        std::cout << "Output data: ";
-        for (size_t i = 0; i < output_size; i++) {
-            std::cout << output_data[i] << " ";
-        }
-        std::cout << std::endl;
+    // Write a session snapshot every `interval` inferences
+    void setSnapshot(const std::string& path, size_t interval) {
+        snapshot_path = path;
+        snapshot_interval = interval;
+    }
 
-        auto end = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> elapsed_this = end - start;
-        this->elapsed += elapsed_this;
-        this->processed_lines += 1;
+    void saveSnapshot(const std::string& path) {
+        SessionSnapshot snapshot;
+        PedestrianSnapshot ped;
+        size_t rows = 0, cols = 0;
+        ped.window = log_reader.window_copy(rows, cols);
+        ped.window_rows = static_cast<uint32_t>(rows);
+        ped.window_cols = static_cast<uint32_t>(cols);
+        ped.source_offset = log_reader.next_log_index();
+        snapshot.pedestrians.push_back(std::move(ped));
+        writeSessionSnapshot(path, snapshot);
     }
 
-    void updateBuffer(const std::vector<float>& newVector) {
-        if (buffer.size() >= capacity) {
-            buffer.pop_front();  // Remove the oldest vector if we are at capacity
+    // Restore the log window and the next log index, so the next log file is predicted immediately
+    void restoreSnapshot(const std::string& path) {
+        auto start = std::chrono::high_resolution_clock::now();
+        SessionSnapshot snapshot = readSessionSnapshot(path);
+        if (snapshot.pedestrians.empty()) return;
+        const PedestrianSnapshot& ped = snapshot.pedestrians.front();
+        if (ped.window_cols != static_cast<uint32_t>(feature_dim)) {
+            throw std::runtime_error("Snapshot feature dimension does not match the model");
         }
-        buffer.push_back(newVector);  // Add the new vector to the buffer
+        log_reader.restore(ped.window.data(), ped.window_rows, ped.window_cols, static_cast<int>(ped.source_offset));
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::high_resolution_clock::now() - start;
+        std::cout << "Resumed at log " << ped.source_offset << " with " << ped.window_rows << " buffered rows in "
+                  << elapsed.count() << " us" << std::endl;
     }
 
     void processFile() {
         auto start = std::chrono::high_resolution_clock::now();
 
-        // feedModel();          // Run the model on every new line
-        while(true) {
+        // Run the model as soon as the reader has a new window; idle waits cost no CPU
+        while (true) {
+            if (!log_reader.has_new_data()) sink->flush();  // Idle: push buffered predictions out
+            if (!log_reader.wait_for_new_data()) break;
             feedModel();
-            std::this_thread::sleep_for(std::chrono::milliseconds(20));
         }
 
         auto end = std::chrono::high_resolution_clock::now();
@@ -143,6 +191,11 @@ public:
         std::cout << "Elapsed time: " << this->elapsed.count() << " seconds." << std::endl;
         std::cout << "Processed " << this->processed_lines << " lines." << std::endl;
         std::cout << "Speed: " << this->processed_lines / this->elapsed.count() << " lines per second.\n\n" << std::endl;
+        if (this->cnt > 0) {
+            std::cout << "Backend " << model->name() << ": " << predict_ns / this->cnt << " ns per window";
+            if (reference) std::cout << ", max abs diff to ONNX " << max_validation_diff;
+            std::cout << std::endl;
+        }
     }
 
     void start(const std::string& filename = "") {
@@ -162,7 +215,7 @@ int main(int argc, char** argv) {
 
     program.add_argument("-s", "--sequence_length")
         .help("sqeuence length")
-        .default_value(40)
+        .default_value(30)
         .scan<'i', size_t>(); // Scanning as size_t; 
 
     program.add_argument("-m", "--model_path")
@@ -175,9 +228,53 @@ int main(int argc, char** argv) {
         .scan<'i', int>();
 
     program.add_argument("--log_dir")
-        .help("Path to the directory containing log files")
+        .help("Directory of log_N.csv files, shm:<name> (shared-memory ring), segments:<dir> (segment log), "
+              "udp:[host:]<port> or unix:<path> (datagram ingest)")
         .default_value(std::string("logs"));
 
+    program.add_argument("--intra_op_threads")
+        .help("Intra-op threads of the ONNX Runtime session")
+        .default_value(1)
+        .scan<'i', int>();
+
+    program.add_argument("--model_cache_dir")
+        .help("Directory for the optimized model cache, defaults to the model's directory")
+        .default_value(std::string(""));
+
+    program.add_argument("--no_model_cache")
+        .help("Optimize the model on every start instead of using the optimized model cache")
+        .flag();
+
+    program.add_argument("--mmap_model")
+        .help("Load the model from a shared read-only memory map, so processes running the same model share its pages "
+              "(weights only when they are external, see externalize_model.py)")
+        .flag();
+
+    program.add_argument("--backend")
+        .help("Predictor backend: onnx or cvm-native (constant velocity without ONNX Runtime)")
+        .default_value(std::string("onnx"));
+
+    program.add_argument("--validate_backend")
+        .help("Also run the ONNX model and check the native backend against it")
+        .flag();
+
+    program.add_argument("--output")
+        .help("Prediction output: stdout, none, csv:<path> or bin:<path>")
+        .default_value(std::string("stdout"));
+
+    program.add_argument("--snapshot_path")
+        .help("Write a session snapshot (log window and next log index) to this file; log directories only")
+        .default_value(std::string(""));
+
+    program.add_argument("--snapshot_interval")
+        .help("Inferences between snapshots")
+        .default_value(100)
+        .scan<'i', int>();
+
+    program.add_argument("--resume")
+        .help("Restore the log window and next log index from a session snapshot; log directories only")
+        .default_value(std::string(""));
+
     try {
         program.parse_args(argc, argv);
     } catch (const std::runtime_error& err) {
@@ -193,13 +290,48 @@ int main(int argc, char** argv) {
     int feature_dim = program.get<int>("--feature_dim");
     std::string log_dir = program.get<std::string>("--log_dir");
     // LogReader log_reader(log_dir);
+    // A snapshot holds one window and a log index; a stream source has per-pedestrian windows and no index to resume at
+    if ((!program.get<std::string>("--snapshot_path").empty() || !program.get<std::string>("--resume").empty()) &&
+        LogReader::is_stream_source(log_dir)) {
+        std::cerr << "--snapshot_path and --resume need a log directory, not " << log_dir << std::endl;
+        exit(-1);
+    }
 
 
 
+    OnnxSessionOptions session_options;
+    session_options.intra_op_threads = program.get<int>("--intra_op_threads");
+    session_options.model_cache_dir = program.get<std::string>("--model_cache_dir");
+    session_options.use_model_cache = !program.get<bool>("--no_model_cache");
+    session_options.mmap_model = program.get<bool>("--mmap_model");
+
+    ResidentMemory memory_before_load = residentMemory();
     ModelRunner runner(model_path,
                        feature_dim, // Feature dimension
                        sequence_length, 
-                       log_dir); // Capacity or batch size
+                       log_dir, // Capacity or batch size
+                       session_options,
+                       program.get<std::string>("--backend"),
+                       program.get<bool>("--validate_backend"));
+    memory_before_load.print(std::cout, "before model load");
+    residentMemory().print(std::cout, "after model load");
+
+    try {
+        runner.setOutput(program.get<std::string>("--output"));
+    } catch (const std::runtime_error& err) {
+        std::cerr << err.what() << std::endl;
+        exit(-1);
+    }
+    runner.setSnapshot(program.get<std::string>("--snapshot_path"), program.get<int>("--snapshot_interval"));
+    std::string resume_path = program.get<std::string>("--resume");
+    if (!resume_path.empty()) {
+        try {
+            runner.restoreSnapshot(resume_path);
+        } catch (const std::runtime_error& err) {
+            std::cerr << "Error resuming session: " << err.what() << std::endl;
+            exit(-1);
+        }
+    }
 
     runner.start();
     return 0;
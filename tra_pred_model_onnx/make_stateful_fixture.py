@@ -0,0 +1,134 @@
+"""Build a minimal stateful (past_* / present_*) ONNX model to exercise the runner's streaming path.
+
+    python make_stateful_fixture.py --output model/model_stateful.onnx --check
+
+The model takes one timestep `input` [1, F] and two states:
+  past_cache  [1, past_len, F]  the last --window timesteps; past_len grows from 0 and is then capped,
+                                like cached encoder activations
+  past_hidden [1, 2]            an exponentially smoothed position, a fixed-shape recurrent state
+and returns `output` [1, horizon, 2], a constant-velocity extrapolation over the cached window, plus
+`smoothed` [1, 2] and the two present_* states. --check steps it through a demo file the way
+StatefulSession does (empty cache first, every present_* fed back as the next past_*) and compares the
+result against numpy.
+"""
+import argparse
+import glob
+import os
+
+import numpy as np
+import onnx
+import pandas as pd
+from onnx import TensorProto, helper
+
+
+def build(feature_dim, window, horizon, smoothing):
+    def const(name, values, dtype=np.int64):
+        return helper.make_node("Constant", [], [name], value=helper.make_tensor(
+            name + "_value", TensorProto.INT64 if dtype == np.int64 else TensorProto.FLOAT,
+            [len(values)], np.asarray(values, dtype=dtype).tolist()))
+
+    nodes = [
+        const("axis1", [1]),
+        const("keep_start", [-window]),
+        const("keep_end", [np.iinfo(np.int64).max]),
+        const("xy_start", [0]),
+        const("xy_end", [2]),
+        const("axis2", [2]),
+        const("first", [0]),
+        const("last_start", [-1]),
+        const("one", [1.0], np.float32),
+        const("alpha", [smoothing], np.float32),
+        const("keep", [1.0 - smoothing], np.float32),
+        const("steps", np.arange(1, horizon + 1, dtype=np.float32).reshape(-1).tolist(), np.float32),
+        const("steps_shape", [1, horizon, 1]),
+        # present_cache = last `window` rows of concat(past_cache, input)
+        helper.make_node("Unsqueeze", ["input", "axis1"], ["row"]),
+        helper.make_node("Concat", ["past_cache", "row"], ["cache"], axis=1),
+        helper.make_node("Slice", ["cache", "keep_start", "keep_end", "axis1"], ["present_cache"]),
+        # velocity = (last_xy - first_xy) / max(len - 1, 1)
+        helper.make_node("Slice", ["present_cache", "xy_start", "xy_end", "axis2"], ["xy"]),
+        helper.make_node("Gather", ["xy", "first"], ["first_xy"], axis=1),
+        helper.make_node("Slice", ["xy", "last_start", "keep_end", "axis1"], ["last_xy"]),
+        helper.make_node("Shape", ["present_cache"], ["cache_shape"], start=1, end=2),
+        helper.make_node("Cast", ["cache_shape"], ["cache_len"], to=TensorProto.FLOAT),
+        helper.make_node("Sub", ["cache_len", "one"], ["spans"]),
+        helper.make_node("Max", ["spans", "one"], ["divisor"]),
+        helper.make_node("Sub", ["last_xy", "first_xy"], ["displacement"]),
+        helper.make_node("Div", ["displacement", "divisor"], ["velocity"]),
+        helper.make_node("Reshape", ["steps", "steps_shape"], ["step_index"]),
+        helper.make_node("Mul", ["step_index", "velocity"], ["offsets"]),
+        helper.make_node("Add", ["last_xy", "offsets"], ["output"]),
+        # present_hidden = keep * past_hidden + alpha * input[:, :2]
+        helper.make_node("Slice", ["input", "xy_start", "xy_end", "axis1"], ["input_xy"]),
+        helper.make_node("Mul", ["past_hidden", "keep"], ["kept"]),
+        helper.make_node("Mul", ["input_xy", "alpha"], ["added"]),
+        helper.make_node("Add", ["kept", "added"], ["present_hidden"]),
+        helper.make_node("Identity", ["present_hidden"], ["smoothed"]),
+    ]
+    graph = helper.make_graph(
+        nodes, "stateful_fixture",
+        [helper.make_tensor_value_info("input", TensorProto.FLOAT, [1, feature_dim]),
+         helper.make_tensor_value_info("past_cache", TensorProto.FLOAT, [1, "past_len", feature_dim]),
+         helper.make_tensor_value_info("past_hidden", TensorProto.FLOAT, [1, 2])],
+        [helper.make_tensor_value_info("output", TensorProto.FLOAT, [1, horizon, 2]),
+         helper.make_tensor_value_info("smoothed", TensorProto.FLOAT, [1, 2]),
+         helper.make_tensor_value_info("present_cache", TensorProto.FLOAT, [1, "present_len", feature_dim]),
+         helper.make_tensor_value_info("present_hidden", TensorProto.FLOAT, [1, 2])])
+    model = helper.make_model(graph, opset_imports=[helper.make_opsetid("", 17)], producer_name="make_stateful_fixture")
+    model.ir_version = 8
+    onnx.checker.check_model(model)
+    return model
+
+
+def check(path, data_dir, feature_dim, window, smoothing):
+    import onnxruntime as ort
+
+    session = ort.InferenceSession(path)
+    rows = pd.read_csv(sorted(glob.glob(os.path.join(data_dir, "*.csv")))[0])
+    rows = rows.select_dtypes(include=[np.number]).to_numpy(dtype=np.float32)[:, :feature_dim]
+
+    cache = ort.OrtValue.ortvalue_from_numpy(np.zeros((1, 0, feature_dim), dtype=np.float32))
+    hidden = np.zeros((1, 2), dtype=np.float32)
+    expected_hidden = hidden.copy()
+    max_diff = 0.0
+    for step, row in enumerate(rows):
+        binding = session.io_binding()
+        binding.bind_cpu_input("input", row[np.newaxis])
+        binding.bind_ortvalue_input("past_cache", cache)
+        binding.bind_cpu_input("past_hidden", hidden)
+        for name in ("output", "smoothed", "present_cache", "present_hidden"):
+            binding.bind_output(name, "cpu")
+        session.run_with_iobinding(binding)
+        output, smoothed, cache, present_hidden = binding.get_outputs()
+        hidden = present_hidden.numpy()
+
+        recent = rows[max(0, step + 1 - window):step + 1, :2]
+        velocity = (recent[-1] - recent[0]) / np.float32(max(len(recent) - 1, 1))
+        steps = np.arange(1, output.shape()[1] + 1, dtype=np.float32)[:, np.newaxis]
+        trajectory = recent[-1] + steps * velocity
+        expected_hidden = np.float32(1.0 - smoothing) * expected_hidden + np.float32(smoothing) * row[:2]
+        max_diff = max(max_diff, float(np.abs(output.numpy()[0] - trajectory).max()),
+                       float(np.abs(smoothed.numpy() - expected_hidden).max()))
+        assert cache.shape() == [1, min(step + 1, window), feature_dim], cache.shape()
+    print(f"Stepped {len(rows)} rows, cache capped at {cache.shape()[1]} rows, max abs diff to numpy {max_diff}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--output", default="model/model_stateful.onnx")
+    parser.add_argument("--feature_dim", type=int, default=32)
+    parser.add_argument("--window", type=int, default=30, help="Timesteps kept in the cache state")
+    parser.add_argument("--horizon", type=int, default=40)
+    parser.add_argument("--smoothing", type=float, default=0.2)
+    parser.add_argument("--data", default="data/demo/feature_model")
+    parser.add_argument("--check", action="store_true", help="Step the model through the first file in --data")
+    args = parser.parse_args()
+
+    onnx.save_model(build(args.feature_dim, args.window, args.horizon, args.smoothing), args.output)
+    print(f"Wrote {args.output}")
+    if args.check:
+        check(args.output, args.data, args.feature_dim, args.window, args.smoothing)
+
+
+if __name__ == "__main__":
+    main()
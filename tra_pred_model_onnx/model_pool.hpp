@@ -0,0 +1,132 @@
+#ifndef MODEL_POOL_HPP
+#define MODEL_POOL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <mpmc_queue.hpp>
+#include <cpu_affinity.hpp>
+#include "onnx_session.hpp"
+
+// N replicas of one model, each on its own worker thread pinned to its own core set, with the session's
+// intra-op threads matching the set. Windows go through a lock-free queue and are taken by whichever
+// replica is idle. Replicas share the process-wide Env and prepacked weights (see OnnxRuntime).
+class ModelPool {
+public:
+    struct Options {
+        size_t replicas = 1;
+        size_t cores_per_replica = 1;
+        size_t first_core = 0;
+        bool pin = true;
+        size_t queue_capacity = 1024;  // Power of two
+        OnnxSessionOptions session;
+    };
+
+private:
+    struct Job {
+        const float* window;  // Caller-owned, valid until the result is ready
+        size_t sequence_length;
+        std::promise<std::vector<float>> result;
+    };
+
+    size_t feature_dim;
+    Options options;
+    MpmcQueue<Job*> queue;
+    std::atomic<bool> stopping{false};
+    std::atomic<size_t> ready{0};
+    std::atomic<size_t> pinned{0};
+    std::vector<std::thread> workers;
+    std::exception_ptr load_error;
+    std::mutex load_error_mutex;
+
+    void serve(size_t replica, const std::string& model_path) {
+        // Pin before creating the session so the ORT intra-op threads inherit the core set
+        if (options.pin && pinCurrentThread(coreRange(static_cast<unsigned>(options.first_core + replica * options.cores_per_replica),
+                                                      static_cast<unsigned>(options.cores_per_replica)))) {
+            pinned++;
+        }
+        std::unique_ptr<OnnxSession> session;
+        try {
+            OnnxSessionOptions session_options = options.session;
+            session_options.intra_op_threads = static_cast<int>(options.cores_per_replica);
+            session = std::make_unique<OnnxSession>(model_path, session_options);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(load_error_mutex);
+            if (!load_error) load_error = std::current_exception();
+        }
+        ready++;
+        if (!session) return;
+
+        std::vector<int64_t> shape = {1, 0, static_cast<int64_t>(feature_dim)};
+        size_t idle_polls = 0;
+        Job* job = nullptr;
+        while (true) {
+            if (!queue.try_pop(job)) {
+                if (stopping.load(std::memory_order_acquire)) return;
+                // Spin briefly, then yield, then back off to sleeping so idle replicas leave their cores alone
+                if (++idle_polls < 64) continue;
+                if (idle_polls < 256) {
+                    std::this_thread::yield();
+                } else {
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                }
+                continue;
+            }
+            idle_polls = 0;
+            shape[1] = static_cast<int64_t>(job->sequence_length);
+            try {
+                session->run(job->window, shape);
+                job->result.set_value(std::vector<float>(session->output(0), session->output(0) + session->output_size(0)));
+            } catch (...) {
+                job->result.set_exception(std::current_exception());
+            }
+            delete job;
+        }
+    }
+
+public:
+    // Loads every replica before returning; rethrows the first load error
+    ModelPool(const std::string& model_path, size_t feature_dim, const Options& options)
+        : feature_dim(feature_dim), options(options), queue(options.queue_capacity) {
+        size_t replicas = std::max<size_t>(options.replicas, 1);
+        for (size_t replica = 0; replica < replicas; replica++) {
+            workers.emplace_back(&ModelPool::serve, this, replica, model_path);
+        }
+        while (ready.load() < replicas) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (load_error) {
+            stop();
+            std::rethrow_exception(load_error);
+        }
+    }
+
+    ~ModelPool() { stop(); }
+
+    ModelPool(const ModelPool&) = delete;
+    ModelPool& operator=(const ModelPool&) = delete;
+
+    // Queue a [1, sequence_length, feature_dim] window; the first model output comes back through the future
+    std::future<std::vector<float>> submit(const float* window, size_t sequence_length) {
+        Job* job = new Job{window, sequence_length, {}};
+        std::future<std::vector<float>> future = job->result.get_future();
+        while (!queue.try_push(job)) std::this_thread::yield();  // Full: wait for a replica to drain it
+        return future;
+    }
+
+    // Finish the queued windows and join the replicas
+    void stop() {
+        stopping.store(true, std::memory_order_release);
+        for (auto& worker : workers) {
+            if (worker.joinable()) worker.join();
+        }
+    }
+
+    size_t replicas() const { return workers.size(); }
+    size_t pinned_replicas() const { return pinned.load(); }
+};
+
+#endif // MODEL_POOL_HPP
@@ -0,0 +1,121 @@
+#ifndef MODEL_RELOADER_HPP
+#define MODEL_RELOADER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "onnx_session.hpp"
+#include "stateful_session.hpp"
+
+// Watches a model file and prepares its replacement off the frame path. When the file changes (and has
+// stopped changing for one poll, so a copy in progress is not picked up), a background thread builds a new
+// OnnxSession and warms it with one run on a zero window. The frame loop collects the ready session with
+// take() between frames, so a model update never stalls a frame on session creation.
+class ModelReloader {
+private:
+    struct FileSignature {
+        bool exists = false;
+        uintmax_t size = 0;
+        std::filesystem::file_time_type modified;
+
+        bool operator==(const FileSignature& other) const {
+            return exists == other.exists && size == other.size && modified == other.modified;
+        }
+        bool operator!=(const FileSignature& other) const { return !(*this == other); }
+    };
+
+    std::string model_path;
+    OnnxSessionOptions options;
+    size_t sequence_length;
+    size_t feature_dim;
+    std::chrono::milliseconds interval;
+
+    std::mutex mutex;
+    std::unique_ptr<OnnxSession> pending;  // Built and warmed, waiting for take()
+    std::atomic<bool> ready{false};
+    std::atomic<bool> stopping{false};
+    std::thread watcher;
+
+    static FileSignature signature(const std::string& path) {
+        FileSignature sig;
+        std::error_code error;
+        sig.size = std::filesystem::file_size(path, error);
+        if (error) return sig;
+        sig.modified = std::filesystem::last_write_time(path, error);
+        sig.exists = !error;
+        return sig;
+    }
+
+    std::unique_ptr<OnnxSession> build() {
+        auto start = std::chrono::high_resolution_clock::now();
+        auto session = std::make_unique<OnnxSession>(model_path, options);
+        // The first run allocates outputs and finishes lazy initialization; do it here, not on a live frame
+        if (StatefulSession::isStateful(*session)) {
+            StatefulSession warmup(*session, feature_dim);
+            std::vector<float> row(feature_dim, 0.0f);
+            warmup.step(0, row.data());
+        } else {
+            std::vector<float> window(sequence_length * feature_dim, 0.0f);
+            session->run(window.data(), {1, static_cast<int64_t>(sequence_length), static_cast<int64_t>(feature_dim)});
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        std::cout << "Reloaded " << model_path << " in the background in " << elapsed.count() << " ms" << std::endl;
+        return session;
+    }
+
+    void watch() {
+        FileSignature loaded = signature(model_path);
+        FileSignature seen = loaded;
+        while (!stopping) {
+            std::this_thread::sleep_for(interval);
+            FileSignature current = signature(model_path);
+            bool settled = current == seen;
+            seen = current;
+            if (!current.exists || current == loaded || !settled) continue;
+
+            try {
+                std::unique_ptr<OnnxSession> session = build();
+                std::lock_guard<std::mutex> lock(mutex);
+                pending = std::move(session);  // A newer build replaces one that was never taken
+                ready = true;
+            } catch (const std::exception& exception) {
+                std::cerr << "Keeping the current model, cannot load " << model_path << ": " << exception.what() << std::endl;
+            }
+            loaded = current;
+        }
+    }
+
+public:
+    ModelReloader(const std::string& model_path, const OnnxSessionOptions& options, size_t sequence_length,
+                  size_t feature_dim, std::chrono::milliseconds interval = std::chrono::milliseconds(500))
+        : model_path(model_path), options(options), sequence_length(sequence_length), feature_dim(feature_dim),
+          interval(interval) {
+        watcher = std::thread(&ModelReloader::watch, this);
+    }
+
+    ~ModelReloader() { stop(); }
+
+    ModelReloader(const ModelReloader&) = delete;
+    ModelReloader& operator=(const ModelReloader&) = delete;
+
+    // The new session if one is ready, else nullptr. A single atomic load when nothing changed.
+    std::unique_ptr<OnnxSession> take() {
+        if (!ready.load(std::memory_order_acquire)) return nullptr;
+        std::lock_guard<std::mutex> lock(mutex);
+        ready = false;
+        return std::move(pending);
+    }
+
+    void stop() {
+        stopping = true;
+        if (watcher.joinable()) watcher.join();
+    }
+};
+
+#endif // MODEL_RELOADER_HPP
@@ -0,0 +1,65 @@
+#ifndef ONNX_BACKEND_HPP
+#define ONNX_BACKEND_HPP
+
+#include <map>
+#include <cstring>
+#include <inference_backend.hpp>
+#include "onnx_session.hpp"
+
+// InferenceBackend over an OnnxSession; the first output is the prediction
+class OnnxBackend : public InferenceBackend {
+private:
+    OnnxSession session;
+    std::string label;
+    std::map<std::vector<int64_t>, std::vector<int64_t>> output_shapes;  // By input dims
+    std::vector<int64_t> input_dims{0, 0, 0};  // Refilled in place, no allocation per run
+
+    void run(const float* input, const WindowShape& shape) {
+        input_dims[0] = static_cast<int64_t>(shape.batch);
+        input_dims[1] = static_cast<int64_t>(shape.sequence_length);
+        input_dims[2] = static_cast<int64_t>(shape.feature_dim);
+        session.run(input, input_dims);
+    }
+
+public:
+    OnnxBackend(const std::string& model_path, const OnnxSessionOptions& options = OnnxSessionOptions())
+        : session(model_path, options), label("onnx:" + model_path) {}
+
+    std::string name() const override { return label; }
+
+    // ORT only knows dynamic output dims after a run, so size them once per input shape on zeros
+    std::vector<int64_t> outputShape(const WindowShape& shape) override {
+        std::vector<int64_t> dims = shape.dims();
+        auto it = output_shapes.find(dims);
+        if (it == output_shapes.end()) {
+            std::vector<float> zeros(shape.element_count(), 0.0f);
+            session.run(zeros.data(), dims);
+            it = output_shapes.emplace(dims, session.output_shape(0)).first;
+        }
+        return it->second;
+    }
+
+    void infer(const float* input, const WindowShape& shape, float* output) override {
+        run(input, shape);
+        std::memcpy(output, session.output(0), session.output_size(0) * sizeof(float));
+    }
+
+    // The shape is known after the run, no zero run to size the output
+    void inferResized(const float* input, const WindowShape& shape, std::vector<float>& output,
+                      std::vector<int64_t>& dims) override {
+        run(input, shape);
+        dims = session.output_shape(0);
+        output.assign(session.output(0), session.output(0) + session.output_size(0));
+    }
+
+    bool vqOutputs(float& vq_loss, float& perplexity) const override {
+        if (session.output_count() < 3 || session.output_size(1) != 1 || session.output_size(2) != 1) return false;
+        vq_loss = *session.output(1);
+        perplexity = *session.output(2);
+        return true;
+    }
+
+    OnnxSession& onnx_session() { return session; }
+};
+
+#endif // ONNX_BACKEND_HPP
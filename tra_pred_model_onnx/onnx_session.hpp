@@ -0,0 +1,367 @@
+#ifndef ONNX_SESSION_HPP
+#define ONNX_SESSION_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <unordered_map>
+#include <onnxruntime/core/session/onnxruntime_cxx_api.h>
+#include <trajectory_prediction.hpp>
+#include <feature_schema.hpp>
+#include <mapped_file.hpp>
+
+// Process-wide ORT state shared by every session: one Env and one prepacked-weights container, so
+// several sessions of the same model pack their weights once instead of once per session.
+class OnnxRuntime {
+private:
+    Ort::Env ort_env;
+    Ort::PrepackedWeightsContainer prepacked;
+    double creation_ms;
+
+    static std::chrono::high_resolution_clock::time_point now() { return std::chrono::high_resolution_clock::now(); }
+
+    OnnxRuntime(std::chrono::high_resolution_clock::time_point start)
+        : ort_env(ORT_LOGGING_LEVEL_WARNING, "ModelRunner"), prepacked(),
+          creation_ms(std::chrono::duration<double, std::milli>(now() - start).count()) {}
+
+public:
+    static OnnxRuntime& shared() {
+        static OnnxRuntime runtime(now());
+        return runtime;
+    }
+
+    Ort::Env& env() { return ort_env; }
+    Ort::PrepackedWeightsContainer& prepacked_weights() { return prepacked; }
+    double env_creation_ms() const { return creation_ms; }
+};
+
+struct OnnxSessionOptions {
+    int intra_op_threads = 1;
+    bool use_model_cache = true;
+    std::string model_cache_dir;  // Where optimized graphs are cached, empty = next to the model
+    bool mmap_model = false;      // Parse the model from a shared read-only mapping instead of reading the file
+};
+
+// Where the startup time of a session went
+struct StartupTiming {
+    double env_ms = 0.0;       // Shared Env, paid by the first session only
+    double session_ms = 0.0;   // Parse, optimize and initialize the graph
+    double metadata_ms = 0.0;  // Node names and the binding
+    bool cache_hit = false;
+    bool mapped = false;
+    std::string cache_path;
+
+    double total_ms() const { return env_ms + session_ms + metadata_ms; }
+
+    void print(std::ostream& out) const {
+        out << std::fixed << std::setprecision(2) << "Startup: env " << env_ms << " ms, session " << session_ms
+            << " ms, metadata " << metadata_ms << " ms, total " << total_ms() << " ms";
+        if (!cache_path.empty()) out << " (optimized model cache " << (cache_hit ? "hit" : "miss") << ": " << cache_path << ")";
+        if (mapped) out << " (memory-mapped)";
+        out << std::defaultfloat << std::endl;
+    }
+};
+
+// Level the cached graph is optimized at. ORT_ENABLE_ALL adds layout transforms for the CPU it runs on
+// (e.g. NCHWc), which must not be saved into a file other machines may share; they are applied when the
+// cached graph is loaded instead.
+constexpr GraphOptimizationLevel CACHED_OPTIMIZATION_LEVEL = ORT_ENABLE_EXTENDED;
+
+// Cache file for the optimized graph of a model. The name carries the model size, modification time, the
+// ORT version and the optimization level, so editing the model or upgrading ORT picks a new file instead
+// of a stale graph.
+inline std::string optimizedModelCachePath(const std::string& model_path, const std::string& cache_dir) {
+    namespace fs = std::filesystem;
+    fs::path model(model_path);
+    std::error_code error;
+    uintmax_t size = fs::file_size(model, error);
+    if (error) return "";  // Let the session report the missing model
+    std::stringstream key;
+    key << size << ':' << fs::last_write_time(model, error).time_since_epoch().count() << ':'
+        << Ort::GetVersionString() << ':' << static_cast<int>(CACHED_OPTIMIZATION_LEVEL);
+    std::stringstream name;
+    name << model.stem().string() << '.' << std::hex << std::hash<std::string>{}(key.str()) << ".opt.onnx";
+    fs::path dir = cache_dir.empty() ? model.parent_path() : fs::path(cache_dir);
+    return (dir / name.str()).string();
+}
+
+// Remove the cached graphs of earlier versions of the model next to `cache_path` (<stem>.<hash>.opt.onnx
+// with another hash, and its .data weights), so a model that is replaced again and again does not fill its
+// directory
+inline void pruneOptimizedModelCache(const std::string& cache_path) {
+    namespace fs = std::filesystem;
+    const std::string suffix = ".opt.onnx";
+    fs::path current(cache_path);
+    std::string name = current.filename().string();
+    std::string stem = name.substr(0, name.rfind('.', name.size() - suffix.size() - 1) + 1);  // "<stem>."
+    std::error_code error;
+    for (const auto& entry : fs::directory_iterator(current.parent_path().empty() ? "." : current.parent_path(), error)) {
+        std::string other = entry.path().filename().string();
+        if (other == name || other.size() <= stem.size() + suffix.size() || other.rfind(stem, 0) != 0 ||
+            other.compare(other.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            continue;
+        }
+        std::string hash = other.substr(stem.size(), other.size() - stem.size() - suffix.size());
+        if (hash.find_first_not_of("0123456789abcdef") != std::string::npos) continue;  // Another model's stem
+        fs::remove(entry.path(), error);
+        fs::remove(entry.path().string() + ".data", error);
+    }
+}
+
+// ONNX Runtime session with a steady-state allocation-free Run.
+// Inputs and outputs are bound once per input shape through Ort::IoBinding: the input tensor wraps the
+// caller's buffer, the outputs are preallocated here, and every frame calls Run with the binding.
+class OnnxSession {
+private:
+    std::unique_ptr<MappedFile> model_bytes;  // Declared first: ORT may keep pointing into it for the session's lifetime
+    Ort::SessionOptions session_options;
+    Ort::Session session;
+    std::vector<std::string> input_node_names;
+    std::vector<std::string> output_node_names;
+
+    // Reused across runs
+    Ort::MemoryInfo memory_info;
+    Ort::RunOptions run_options;
+    Ort::IoBinding binding;
+
+    // Input tensors over caller buffers, keyed by data pointer and shape, so callers that alternate batch
+    // sizes keep theirs. A sliding window moves through at most `rows` positions of its backing store, so
+    // this settles after one pass over the window; callers with ever new buffers do not grow it past the cap.
+    static constexpr size_t MAX_INPUT_VALUES = 4096;
+    std::map<std::pair<const float*, std::vector<int64_t>>, Ort::Value> input_values;
+    const float* bound_input = nullptr;
+    std::vector<int64_t> bound_shape;
+
+    // Outputs preallocated for one input shape
+    struct OutputBinding {
+        std::vector<std::vector<float>> buffers;
+        std::vector<std::vector<int64_t>> shapes;
+        std::vector<Ort::Value> values;
+    };
+    // Every shape seen so far, so a batch size that comes back rebinds without resizing
+    std::map<std::vector<int64_t>, OutputBinding> output_bindings;
+    OutputBinding* outputs = nullptr;
+
+    // First run for a shape: let ORT allocate the outputs to learn their shapes, then bind our own buffers
+    void bindOutputs(OutputBinding& target) {
+        binding.ClearBoundOutputs();
+        for (const auto& name : output_node_names) {
+            binding.BindOutput(name.c_str(), memory_info);
+        }
+        session.Run(run_options, binding);
+
+        std::vector<Ort::Value> allocated = binding.GetOutputValues();
+        for (auto& value : allocated) {
+            Ort::TensorTypeAndShapeInfo info = value.GetTensorTypeAndShapeInfo();
+            target.shapes.push_back(info.GetShape());
+            const float* data = value.GetTensorData<float>();
+            target.buffers.emplace_back(data, data + info.GetElementCount());
+        }
+        for (size_t i = 0; i < output_node_names.size(); i++) {
+            target.values.push_back(Ort::Value::CreateTensor<float>(
+                memory_info, target.buffers[i].data(), target.buffers[i].size(),
+                target.shapes[i].data(), target.shapes[i].size()));
+        }
+        rebindOutputs(target);
+    }
+
+    StartupTiming timing;
+
+    // From a shared read-only mapping when `mapped`: no read into a private buffer, and ORT resolves
+    // external weight files next to the model and maps them itself. ORT-format models also keep their
+    // initializers in the mapped bytes instead of copying them. The inline initializers of a protobuf
+    // .onnx are still copied; externalize_model.py moves them to a .data file that is shared. Prepacking
+    // is off, since prepacked weights would be private copies of the shared pages.
+    Ort::Session openSession(OnnxRuntime& runtime, const std::string& path, const Ort::SessionOptions& load_options,
+                             bool mapped) {
+        if (!mapped) return Ort::Session(runtime.env(), path.c_str(), load_options, runtime.prepacked_weights());
+        auto file = std::make_unique<MappedFile>(path);
+        Ort::SessionOptions mapped_options = load_options.Clone();
+        std::string folder = std::filesystem::path(path).parent_path().string();
+        mapped_options.AddConfigEntry("session.model_external_initializers_file_folder_path",
+                                      folder.empty() ? "." : folder.c_str());
+        mapped_options.AddConfigEntry("session.use_ort_model_bytes_directly", "1");
+        mapped_options.AddConfigEntry("session.use_ort_model_bytes_for_initializers", "1");
+        mapped_options.AddConfigEntry("session.disable_prepacking", "1");
+        Ort::Session created(runtime.env(), file->data(), file->size(), mapped_options, runtime.prepacked_weights());
+        model_bytes = std::move(file);
+        timing.mapped = true;
+        return created;
+    }
+
+    // Load the cached optimized graph when there is one; otherwise optimize the model and save the result.
+    // A cached graph that fails to load is dropped and rebuilt from the model.
+    void createSession(OnnxRuntime& runtime, const std::string& model_path, const OnnxSessionOptions& options) {
+        session_options.SetGraphOptimizationLevel(ORT_ENABLE_ALL);
+        if (!options.use_model_cache) {
+            session = openSession(runtime, model_path, session_options, options.mmap_model);
+            return;
+        }
+
+        timing.cache_path = optimizedModelCachePath(model_path, options.model_cache_dir);
+        if (timing.cache_path.empty()) {
+            session = openSession(runtime, model_path, session_options, options.mmap_model);
+            return;
+        }
+        if (std::filesystem::exists(timing.cache_path)) {
+            // Already optimized up to CACHED_OPTIMIZATION_LEVEL; ORT_ENABLE_ALL adds the local layout transforms
+            Ort::SessionOptions cached_options = session_options.Clone();
+            try {
+                session = openSession(runtime, timing.cache_path, cached_options, options.mmap_model);
+                timing.cache_hit = true;
+                return;
+            } catch (const Ort::Exception& exception) {
+                std::cerr << "Ignoring optimized model cache " << timing.cache_path << ": " << exception.what() << std::endl;
+                std::filesystem::remove(timing.cache_path);
+                std::filesystem::remove(timing.cache_path + ".data");
+            }
+        }
+
+        std::error_code error;
+        if (!options.model_cache_dir.empty()) std::filesystem::create_directories(options.model_cache_dir, error);
+        Ort::SessionOptions caching_options = session_options.Clone();
+        caching_options.SetGraphOptimizationLevel(CACHED_OPTIMIZATION_LEVEL);
+        caching_options.SetOptimizedModelFilePath(timing.cache_path.c_str());
+        // Weights go to <cache>.data, so a cached graph loaded with mmap_model shares them like the model's own
+        std::string cache_data = std::filesystem::path(timing.cache_path).filename().string() + ".data";
+        caching_options.AddConfigEntry("session.optimized_model_external_initializers_file_name", cache_data.c_str());
+        caching_options.AddConfigEntry("session.optimized_model_external_initializers_min_size_in_bytes", "1024");
+        try {
+            session = openSession(runtime, model_path, caching_options, options.mmap_model);
+            pruneOptimizedModelCache(timing.cache_path);
+        } catch (const Ort::Exception& exception) {
+            // Typically an unwritable cache directory; run without the cache
+            std::cerr << "Cannot write optimized model cache " << timing.cache_path << ": " << exception.what() << std::endl;
+            timing.cache_path.clear();
+            session = openSession(runtime, model_path, session_options, options.mmap_model);
+        }
+    }
+
+    static OnnxSessionOptions threadOptions(int intra_op_threads) {
+        OnnxSessionOptions options;
+        options.intra_op_threads = intra_op_threads;
+        return options;
+    }
+
+    void rebindOutputs(OutputBinding& target) {
+        binding.ClearBoundOutputs();
+        for (size_t i = 0; i < output_node_names.size(); i++) {
+            binding.BindOutput(output_node_names[i].c_str(), target.values[i]);
+        }
+    }
+
+public:
+    OnnxSession(const std::string& model_path, const OnnxSessionOptions& options = OnnxSessionOptions())
+        : session_options(), session(nullptr),
+          memory_info(Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault)),
+          run_options(), binding(nullptr) {
+        // Replicas are built concurrently (ModelPool); exactly one of them reports the Env creation
+        static std::atomic<bool> env_reported{false};
+        OnnxRuntime& runtime = OnnxRuntime::shared();
+        if (!env_reported.exchange(true)) {
+            timing.env_ms = runtime.env_creation_ms();  // Only the first session pays for the Env
+        }
+        auto start = std::chrono::high_resolution_clock::now();
+        session_options.SetIntraOpNumThreads(options.intra_op_threads);
+        createSession(runtime, model_path, options);
+        auto created = std::chrono::high_resolution_clock::now();
+        timing.session_ms = std::chrono::duration<double, std::milli>(created - start).count();
+
+        binding = Ort::IoBinding(session);
+
+        // Get input and output node names
+        Ort::AllocatorWithDefaultOptions allocator;
+        for (size_t i = 0; i < session.GetInputCount(); i++) {
+            input_node_names.push_back(session.GetInputNameAllocated(i, allocator).get());
+        }
+        for (size_t i = 0; i < session.GetOutputCount(); i++) {
+            output_node_names.push_back(session.GetOutputNameAllocated(i, allocator).get());
+        }
+        timing.metadata_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - created).count();
+    }
+
+    OnnxSession(const std::string& model_path, int intra_op_threads)
+        : OnnxSession(model_path, threadOptions(intra_op_threads)) {}
+
+    const StartupTiming& startup_timing() const { return timing; }
+
+    // Run the model on input[shape]. The input buffer must stay valid and unchanged until run() returns;
+    // results stay valid until the next run().
+    void run(const float* input, const std::vector<int64_t>& shape) {
+        bool shape_changed = shape != bound_shape;
+        if (shape_changed || input != bound_input) {
+            auto key = std::make_pair(input, shape);
+            auto it = input_values.find(key);
+            if (it == input_values.end()) {
+                // The binding holds its own reference to the bound tensor, so dropping the cache is safe
+                if (input_values.size() >= MAX_INPUT_VALUES) input_values.clear();
+                size_t element_count = 1;
+                for (int64_t dim : shape) element_count *= static_cast<size_t>(dim);
+                // ORT only reads from input tensors
+                it = input_values.emplace(std::move(key), Ort::Value::CreateTensor<float>(
+                    memory_info, const_cast<float*>(input), element_count, shape.data(), shape.size())).first;
+            }
+            binding.BindInput(input_node_names[0].c_str(), it->second);
+            bound_input = input;
+            bound_shape = shape;
+        }
+
+        if (shape_changed) {
+            auto found = output_bindings.find(shape);
+            if (found == output_bindings.end()) {
+                outputs = &output_bindings[shape];
+                bindOutputs(*outputs);  // Runs the model once to size the outputs
+                return;
+            }
+            outputs = &found->second;
+            rebindOutputs(*outputs);
+        }
+        session.Run(run_options, binding);
+    }
+
+    const float* output(size_t index = 0) const { return outputs->buffers[index].data(); }
+    size_t output_size(size_t index = 0) const { return outputs->buffers[index].size(); }
+    const std::vector<int64_t>& output_shape(size_t index = 0) const { return outputs->shapes[index]; }
+    size_t output_count() const { return outputs ? outputs->buffers.size() : 0; }
+
+    const std::vector<std::string>& input_names() const { return input_node_names; }
+    const std::vector<std::string>& output_names() const { return output_node_names; }
+
+    // The underlying ORT session, for callers that bind their own tensors (StatefulSession)
+    Ort::Session& ort_session() { return session; }
+
+    // Custom metadata of the model file, "" when the key is absent
+    std::string custom_metadata(const std::string& key) const {
+        Ort::AllocatorWithDefaultOptions allocator;
+        Ort::ModelMetadata metadata = session.GetModelMetadata();
+        Ort::AllocatedStringPtr value = metadata.LookupCustomMetadataMapAllocated(key.c_str(), allocator);
+        return value ? std::string(value.get()) : std::string();
+    }
+};
+
+// Input layout the model was exported with ("feature_columns", optional "feature_mean" / "feature_std"
+// metadata), or the data/demo/feature_model layout when the model does not say
+inline FeatureSchema modelFeatureSchema(const OnnxSession& session) {
+    std::string columns = session.custom_metadata("feature_columns");
+    if (columns.empty()) return defaultFeatureSchema();
+    return parseFeatureSchema(columns, session.custom_metadata("feature_mean"), session.custom_metadata("feature_std"));
+}
+
+// Decode sample `index` of the last run: the trajectory from the first output, and the scalar vq_loss and
+// perplexity outputs of the TFT model when it has them. Works on OnnxSession and StatefulSession.
+template <typename Session>
+inline void decodePrediction(const Session& session, size_t index, TrajectoryPrediction& prediction) {
+    decodeTrajectory(session.output(0), session.output_shape(0), index, prediction);
+    bool has_vq = session.output_count() >= 3 && session.output_size(1) == 1 && session.output_size(2) == 1;
+    decodeVqOutputs(has_vq ? session.output(1) : nullptr, has_vq ? session.output(2) : nullptr, prediction);
+}
+
+#endif // ONNX_SESSION_HPP
@@ -0,0 +1,83 @@
+"""Static INT8 (QDQ) quantization of the trajectory model, calibrated on demo feature windows.
+
+    python quantize_model.py --model model/model.onnx --data data/demo/feature_model --output model/model.int8.onnx
+
+Compare the result against the float model with the runner's comparison mode:
+
+    ./main --model_path model/model.onnx --compare_model_path model/model.int8.onnx --batch_size 30
+"""
+import argparse
+import glob
+import os
+
+import numpy as np
+import pandas as pd
+from onnxruntime.quantization import CalibrationDataReader, CalibrationMethod, QuantFormat, QuantType, quantize_static
+from onnxruntime.quantization.shape_inference import quant_pre_process
+
+
+class FeatureWindowReader(CalibrationDataReader):
+    """Feeds [1, lookback, feature_dim] windows slid over every CSV in a feature_model directory."""
+
+    def __init__(self, data_dir, input_name, lookback, feature_dim, stride, max_windows):
+        windows = []
+        for path in sorted(glob.glob(os.path.join(data_dir, "*.csv"))):
+            values = pd.read_csv(path).select_dtypes(include=[np.number]).to_numpy(dtype=np.float32)
+            values = values[:, :feature_dim]
+            for start in range(0, len(values) - lookback + 1, stride):
+                windows.append(values[start:start + lookback][np.newaxis])
+        if not windows:
+            raise ValueError(f"No {lookback}-row windows found in {data_dir}")
+        if max_windows and len(windows) > max_windows:
+            picks = np.linspace(0, len(windows) - 1, max_windows).astype(int)
+            windows = [windows[i] for i in picks]
+        print(f"Calibrating on {len(windows)} windows from {data_dir}")
+        self.input_name = input_name
+        self.windows = iter(windows)
+
+    def get_next(self):
+        window = next(self.windows, None)
+        return None if window is None else {self.input_name: window}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--model", default="model/model.onnx")
+    parser.add_argument("--data", default="data/demo/feature_model")
+    parser.add_argument("--output", default="model/model.int8.onnx")
+    parser.add_argument("--input_name", default="input")
+    parser.add_argument("--lookback", type=int, default=30)
+    parser.add_argument("--feature_dim", type=int, default=32)
+    parser.add_argument("--stride", type=int, default=5)
+    parser.add_argument("--max_windows", type=int, default=200)
+    parser.add_argument("--calibration", choices=["minmax", "entropy", "percentile"], default="minmax")
+    parser.add_argument("--per_channel", action="store_true", help="Per-channel weight scales")
+    args = parser.parse_args()
+
+    # Shape inference and graph cleanup make more ops quantizable
+    preprocessed = os.path.splitext(args.output)[0] + ".pre.onnx"
+    quant_pre_process(args.model, preprocessed)
+
+    methods = {
+        "minmax": CalibrationMethod.MinMax,
+        "entropy": CalibrationMethod.Entropy,
+        "percentile": CalibrationMethod.Percentile,
+    }
+    reader = FeatureWindowReader(args.data, args.input_name, args.lookback, args.feature_dim, args.stride, args.max_windows)
+    quantize_static(
+        preprocessed,
+        args.output,
+        reader,
+        quant_format=QuantFormat.QDQ,
+        activation_type=QuantType.QUInt8,
+        weight_type=QuantType.QInt8,
+        per_channel=args.per_channel,
+        calibrate_method=methods[args.calibration],
+    )
+    os.remove(preprocessed)
+    print(f"Wrote {args.output} ({os.path.getsize(args.output) / 1e6:.1f} MB, float model "
+          f"{os.path.getsize(args.model) / 1e6:.1f} MB)")
+
+
+if __name__ == "__main__":
+    main()
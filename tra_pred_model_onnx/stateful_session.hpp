@@ -0,0 +1,244 @@
+#ifndef STATEFUL_SESSION_HPP
+#define STATEFUL_SESSION_HPP
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <stdexcept>
+#include "onnx_session.hpp"
+
+// Streaming execution of a stateful model export. Besides the newest timestep ([1, 1, F]) the model takes
+// `past_<name>` state inputs and returns the matching `present_<name>` outputs (recurrent hidden state or
+// cached encoder activations). The state is carried per pedestrian, so a frame costs one timestep of model
+// work instead of a whole window. A new pedestrian starts from all-zero state.
+// A state whose shape is fixed apart from the batch dimension is double-buffered in place. A state with a
+// dynamic dimension past the batch (a cache that grows with every step, e.g. [1, past_len, D]) starts with
+// that dimension 0, ORT allocates each present_* output, and it becomes the next step's past_* input.
+// make_stateful_fixture.py builds a small model with one state of each kind.
+class StatefulSession {
+public:
+    static constexpr const char* PAST_PREFIX = "past_";
+    static constexpr const char* PRESENT_PREFIX = "present_";
+
+private:
+    // Two copies of every fixed-shape state tensor: the run reads `current` and writes `next`, then they swap.
+    // A growing state only uses current_values, holding the present_* value ORT returned last step.
+    struct StreamState {
+        std::vector<std::vector<float>> current;
+        std::vector<std::vector<float>> next;
+        std::vector<Ort::Value> current_values;
+        std::vector<Ort::Value> next_values;
+        size_t steps = 0;
+    };
+
+    OnnxSession& model;
+    Ort::MemoryInfo memory_info;
+    Ort::RunOptions run_options;
+    Ort::IoBinding binding;
+
+    std::string step_input_name;
+    std::vector<float> step_input;  // The newest timestep is copied here, the tensor over it is made once
+    std::vector<int64_t> step_shape;
+    Ort::Value step_value;
+
+    std::vector<std::string> past_names;
+    std::vector<std::string> present_names;  // present_names[i] feeds past_names[i] on the next step
+    std::vector<std::vector<int64_t>> state_shapes;  // Initial shapes: batch 1, growing dimensions 0
+    std::vector<bool> growing;                        // State has a dynamic dimension past the batch
+    bool has_growing = false;
+
+    // Model outputs other than the state, allocated on the first step
+    std::vector<std::string> result_names;
+    std::vector<std::vector<float>> result_buffers;
+    std::vector<std::vector<int64_t>> result_shapes;
+    std::vector<Ort::Value> result_values;
+
+    std::unordered_map<uint32_t, StreamState> streams;
+
+    static bool startsWith(const std::string& text, const char* prefix) {
+        return text.rfind(prefix, 0) == 0;
+    }
+
+    // A dynamic batch dimension is 1 for a single pedestrian; any other dynamic dimension is a cache length
+    // that starts empty. Sets `grows` when there is one.
+    static std::vector<int64_t> initialShape(std::vector<int64_t> shape, bool& grows) {
+        grows = false;
+        for (size_t i = 0; i < shape.size(); i++) {
+            if (shape[i] > 0) continue;
+            grows = grows || i > 0;
+            shape[i] = i == 0 ? 1 : 0;
+        }
+        return shape;
+    }
+
+    StreamState& stream(uint32_t pedestrian) {
+        auto it = streams.find(pedestrian);
+        if (it != streams.end()) return it->second;
+
+        StreamState& state = streams[pedestrian];
+        Ort::AllocatorWithDefaultOptions allocator;
+        for (size_t i = 0; i < state_shapes.size(); i++) {
+            const std::vector<int64_t>& shape = state_shapes[i];
+            if (growing[i]) {
+                state.current.emplace_back();
+                state.next.emplace_back();
+                state.current_values.push_back(Ort::Value::CreateTensor<float>(allocator, shape.data(), shape.size()));
+                state.next_values.emplace_back(nullptr);
+                continue;
+            }
+            size_t count = elementCount(shape);
+            state.current.emplace_back(count, 0.0f);
+            state.next.emplace_back(count, 0.0f);
+            state.current_values.push_back(Ort::Value::CreateTensor<float>(
+                memory_info, state.current[i].data(), count, shape.data(), shape.size()));
+            state.next_values.push_back(Ort::Value::CreateTensor<float>(
+                memory_info, state.next[i].data(), count, shape.data(), shape.size()));
+        }
+        return state;
+    }
+
+    // After a run: the present_* values ORT allocated for the growing states are the next step's past_*
+    void takeGrowingStates(StreamState& state) {
+        std::vector<Ort::Value> values = binding.GetOutputValues();
+        std::vector<std::string> names = binding.GetOutputNames();
+        for (size_t i = 0; i < past_names.size(); i++) {
+            if (!growing[i]) continue;
+            for (size_t j = 0; j < names.size(); j++) {
+                if (names[j] == present_names[i]) state.current_values[i] = std::move(values[j]);
+            }
+        }
+    }
+
+    static size_t elementCount(const std::vector<int64_t>& shape) {
+        size_t count = 1;
+        for (int64_t dim : shape) count *= static_cast<size_t>(dim);
+        return count;
+    }
+
+    // First step: ORT allocates the result outputs so their shapes are known, then they get our own buffers
+    void bindResults() {
+        for (const auto& name : result_names) binding.BindOutput(name.c_str(), memory_info);
+        model.ort_session().Run(run_options, binding);
+
+        std::vector<Ort::Value> allocated = binding.GetOutputValues();
+        std::vector<std::string> bound_names = binding.GetOutputNames();
+        for (const auto& name : result_names) {
+            size_t index = 0;
+            while (index < bound_names.size() && bound_names[index] != name) index++;
+            Ort::TensorTypeAndShapeInfo info = allocated[index].GetTensorTypeAndShapeInfo();
+            const float* data = allocated[index].GetTensorData<float>();
+            result_shapes.push_back(info.GetShape());
+            result_buffers.emplace_back(data, data + info.GetElementCount());
+        }
+        for (size_t i = 0; i < result_names.size(); i++) {
+            result_values.push_back(Ort::Value::CreateTensor<float>(
+                memory_info, result_buffers[i].data(), result_buffers[i].size(), result_shapes[i].data(),
+                result_shapes[i].size()));
+            binding.BindOutput(result_names[i].c_str(), result_values[i]);
+        }
+    }
+
+public:
+    // True when the model has at least one past_* input with a matching present_* output
+    static bool isStateful(const OnnxSession& session) {
+        for (const auto& input : session.input_names()) {
+            if (!startsWith(input, PAST_PREFIX)) continue;
+            std::string present = PRESENT_PREFIX + input.substr(std::strlen(PAST_PREFIX));
+            for (const auto& output : session.output_names()) {
+                if (output == present) return true;
+            }
+        }
+        return false;
+    }
+
+    StatefulSession(OnnxSession& session, size_t feature_dim)
+        : model(session), memory_info(Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault)),
+          run_options(), binding(session.ort_session()), step_input(feature_dim, 0.0f), step_value(nullptr) {
+        Ort::Session& ort_session = session.ort_session();
+        const auto& inputs = session.input_names();
+        for (size_t i = 0; i < inputs.size(); i++) {
+            std::vector<int64_t> shape = ort_session.GetInputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape();
+            if (!startsWith(inputs[i], PAST_PREFIX)) {
+                if (!step_input_name.empty()) {
+                    throw std::runtime_error("Stateful model has more than one non-state input: " + inputs[i]);
+                }
+                step_input_name = inputs[i];
+                step_shape = shape.size() == 2 ? std::vector<int64_t>{1, static_cast<int64_t>(feature_dim)}
+                                               : std::vector<int64_t>{1, 1, static_cast<int64_t>(feature_dim)};
+                continue;
+            }
+            past_names.push_back(inputs[i]);
+            present_names.push_back(PRESENT_PREFIX + inputs[i].substr(std::strlen(PAST_PREFIX)));
+            bool grows = false;
+            state_shapes.push_back(initialShape(shape, grows));
+            growing.push_back(grows);
+            has_growing = has_growing || grows;
+        }
+        for (const auto& output : session.output_names()) {
+            bool is_state = false;
+            for (const auto& present : present_names) is_state = is_state || output == present;
+            if (!is_state) result_names.push_back(output);
+        }
+        for (const auto& present : present_names) {
+            bool found = false;
+            for (const auto& output : session.output_names()) found = found || output == present;
+            if (!found) throw std::runtime_error("Stateful model has no " + present + " output");
+        }
+        if (step_input_name.empty()) {
+            throw std::runtime_error("Stateful model has no timestep input");
+        }
+
+        step_value = Ort::Value::CreateTensor<float>(memory_info, step_input.data(), step_input.size(),
+                                                     step_shape.data(), step_shape.size());
+        binding.BindInput(step_input_name.c_str(), step_value);
+    }
+
+    StatefulSession(const StatefulSession&) = delete;
+    StatefulSession& operator=(const StatefulSession&) = delete;
+
+    // Advance `pedestrian` by one timestep (feature_dim floats). Results stay valid until the next step.
+    void step(uint32_t pedestrian, const float* row) {
+        std::memcpy(step_input.data(), row, step_input.size() * sizeof(float));
+        StreamState& state = stream(pedestrian);
+        for (size_t i = 0; i < past_names.size(); i++) {
+            binding.BindInput(past_names[i].c_str(), state.current_values[i]);
+            if (growing[i]) {
+                binding.BindOutput(present_names[i].c_str(), memory_info);  // Its shape changes from step to step
+            } else {
+                binding.BindOutput(present_names[i].c_str(), state.next_values[i]);
+            }
+        }
+        if (result_values.empty()) {
+            bindResults();
+        } else {
+            model.ort_session().Run(run_options, binding);
+        }
+        if (has_growing) takeGrowingStates(state);
+        for (size_t i = 0; i < past_names.size(); i++) {
+            if (growing[i]) continue;
+            state.current[i].swap(state.next[i]);
+            std::swap(state.current_values[i], state.next_values[i]);
+        }
+        state.steps++;
+    }
+
+    // Timesteps `pedestrian` has been fed since it started or was reset
+    size_t steps(uint32_t pedestrian) const {
+        auto it = streams.find(pedestrian);
+        return it == streams.end() ? 0 : it->second.steps;
+    }
+
+    // Drop the carried state, e.g. when the pedestrian leaves
+    void reset(uint32_t pedestrian) { streams.erase(pedestrian); }
+
+    size_t state_count() const { return past_names.size(); }
+
+    const float* output(size_t index = 0) const { return result_buffers[index].data(); }
+    size_t output_size(size_t index = 0) const { return result_buffers[index].size(); }
+    const std::vector<int64_t>& output_shape(size_t index = 0) const { return result_shapes[index]; }
+    size_t output_count() const { return result_buffers.size(); }
+};
+
+#endif // STATEFUL_SESSION_HPP